@@ -0,0 +1,106 @@
+#include <benchmark/benchmark.h>
+#include "battle_queue.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Битвы одного тика: state.range(0) разных пар
+static std::vector<ThreadBattle> makeTickBattles(size_t count, std::uint32_t generation) {
+    std::vector<ThreadBattle> battles(count);
+    for (size_t i = 0; i < count; ++i) {
+        battles[i].attacker = {static_cast<std::uint32_t>(2 * i), generation};
+        battles[i].defender = {static_cast<std::uint32_t>(2 * i + 1), generation};
+    }
+    return battles;
+}
+
+// Старая схема: мьютекс и notify_one на каждую битву, pop по одной
+static void BM_MutexQueueProducerConsumer(benchmark::State& state) {
+    size_t perTick = static_cast<size_t>(state.range(0));
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::queue<ThreadBattle> queue;
+    std::atomic<bool> running{true};
+    std::atomic<size_t> consumed{0};
+
+    std::thread consumer([&]() {
+        while (running) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (cv.wait_for(lock, std::chrono::milliseconds(1), [&]() { return !queue.empty(); })) {
+                queue.pop();
+                consumed.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+
+    std::uint32_t tick = 0;
+    size_t produced = 0;
+    for (auto _ : state) {
+        auto battles = makeTickBattles(perTick, ++tick);
+        for (const auto& battle : battles) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queue.push(battle);
+            }
+            cv.notify_one();
+        }
+        produced += perTick;
+        while (consumed.load(std::memory_order_relaxed) < produced) {
+            std::this_thread::yield();
+        }
+    }
+    running = false;
+    consumer.join();
+    state.SetItemsProcessed(static_cast<int64_t>(produced));
+}
+BENCHMARK(BM_MutexQueueProducerConsumer)->Arg(16)->Arg(256)->UseRealTime();
+
+// Новая схема: пакетная вставка тика и пакетное извлечение
+static void BM_BattleQueueProducerConsumer(benchmark::State& state) {
+    size_t perTick = static_cast<size_t>(state.range(0));
+    BattleQueue queue(1024, BackpressurePolicy::Block);
+    std::atomic<bool> running{true};
+    std::atomic<size_t> consumed{0};
+
+    std::thread consumer([&]() {
+        ThreadBattle batch[64];
+        while (running) {
+            size_t count = queue.waitPopBatch(batch, 64, std::chrono::milliseconds(1));
+            consumed.fetch_add(count, std::memory_order_relaxed);
+        }
+    });
+
+    std::uint32_t tick = 0;
+    size_t produced = 0;
+    for (auto _ : state) {
+        auto battles = makeTickBattles(perTick, ++tick);
+        produced += queue.pushBatch(battles);
+        while (consumed.load(std::memory_order_relaxed) < produced) {
+            std::this_thread::yield();
+        }
+    }
+    running = false;
+    queue.close();
+    consumer.join();
+    state.SetItemsProcessed(static_cast<int64_t>(produced));
+}
+BENCHMARK(BM_BattleQueueProducerConsumer)->Arg(16)->Arg(256)->UseRealTime();
+
+// Повторная постановка тех же пар, пока потребитель отстает: они схлопываются
+static void BM_BattleQueueCoalescing(benchmark::State& state) {
+    BattleQueue queue(1024, BackpressurePolicy::DropOldest);
+    auto battles = makeTickBattles(256, 1);
+    queue.pushBatch(battles);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(queue.pushBatch(battles));
+    }
+    auto stats = queue.stats();
+    state.counters["coalesced"] = static_cast<double>(stats.coalesced);
+    state.counters["depth"] = static_cast<double>(stats.depth);
+    state.SetItemsProcessed(state.iterations() * battles.size());
+}
+BENCHMARK(BM_BattleQueueCoalescing);
@@ -0,0 +1,155 @@
+#include <benchmark/benchmark.h>
+#include "npcs.h"
+#include "npc_store.h"
+#include "spatial_grid.h"
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Плотность как в игре: 50 NPC на карте 100x100
+static constexpr float NPC_DENSITY = 50.0f / (100.0f * 100.0f);
+static constexpr float KILL_DISTANCE = 10.0f;
+
+struct Population {
+    std::vector<std::unique_ptr<NPC>> npcs;
+    std::vector<NPC*> alive;
+    NPCStore store;
+    int mapSize = 0;
+};
+
+static Population makePopulation(int count) {
+    Population pop;
+    pop.mapSize = static_cast<int>(std::sqrt(count / NPC_DENSITY));
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> typeDist(0, 2);
+    std::uniform_real_distribution<float> posDist(0.0f, static_cast<float>(pop.mapSize - 1));
+
+    for (int i = 0; i < count; ++i) {
+        std::string name = "NPC_" + std::to_string(i);
+        float x = posDist(gen);
+        float y = posDist(gen);
+        switch (typeDist(gen)) {
+            case 0: pop.npcs.push_back(std::make_unique<Orc>(name, x, y)); break;
+            case 1: pop.npcs.push_back(std::make_unique<Knight>(name, x, y)); break;
+            default: pop.npcs.push_back(std::make_unique<Bear>(name, x, y)); break;
+        }
+        pop.alive.push_back(pop.npcs.back().get());
+        pop.store.add(*pop.npcs.back());
+    }
+    return pop;
+}
+
+// Цикл из GameManager до перехода на сетку: O(n^2) и строковый id на каждую пару.
+// При 10k NPC множество пар занимает несколько гигабайт, поэтому только 1k
+static void BM_LegacyPairScan(benchmark::State& state) {
+    auto pop = makePopulation(static_cast<int>(state.range(0)));
+    size_t battles = 0;
+
+    for (auto _ : state) {
+        std::unordered_set<std::string> checkedPairs;
+        battles = 0;
+        for (size_t i = 0; i < pop.alive.size(); ++i) {
+            NPC* npc1 = pop.alive[i];
+            for (size_t j = i + 1; j < pop.alive.size(); ++j) {
+                NPC* npc2 = pop.alive[j];
+                std::string pairId = std::to_string(reinterpret_cast<uintptr_t>(npc1)) +
+                                     "-" +
+                                     std::to_string(reinterpret_cast<uintptr_t>(npc2));
+                if (checkedPairs.find(pairId) != checkedPairs.end()) continue;
+                checkedPairs.insert(pairId);
+
+                if (npc1->distanceTo(*npc2) <= KILL_DISTANCE &&
+                    (npc1->canAttack(*npc2) || npc2->canAttack(*npc1))) {
+                    ++battles;
+                }
+            }
+        }
+        benchmark::DoNotOptimize(battles);
+    }
+    state.counters["battles"] = static_cast<double>(battles);
+}
+BENCHMARK(BM_LegacyPairScan)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+// Тот же O(n^2) перебор без строк - нижняя оценка старого цикла для больших n
+static void BM_BruteForcePairScan(benchmark::State& state) {
+    auto pop = makePopulation(static_cast<int>(state.range(0)));
+    size_t battles = 0;
+
+    for (auto _ : state) {
+        battles = 0;
+        for (size_t i = 0; i < pop.alive.size(); ++i) {
+            NPC* npc1 = pop.alive[i];
+            for (size_t j = i + 1; j < pop.alive.size(); ++j) {
+                NPC* npc2 = pop.alive[j];
+                if (npc1->distanceTo(*npc2) <= KILL_DISTANCE &&
+                    (npc1->canAttack(*npc2) || npc2->canAttack(*npc1))) {
+                    ++battles;
+                }
+            }
+        }
+        benchmark::DoNotOptimize(battles);
+    }
+    state.counters["battles"] = static_cast<double>(battles);
+}
+BENCHMARK(BM_BruteForcePairScan)->Arg(1000)->Arg(10000)->Arg(100000)
+    ->Unit(benchmark::kMillisecond)->Iterations(1);
+
+static void BM_GridPairScan(benchmark::State& state) {
+    auto pop = makePopulation(static_cast<int>(state.range(0)));
+    NPCStore& npcs = pop.store;
+    SpatialGrid grid(KILL_DISTANCE);
+    for (NPCStore::Index i = 0; i < npcs.size(); ++i) {
+        grid.insert(i, npcs.getX(i), npcs.getY(i));
+    }
+    size_t battles = 0;
+
+    for (auto _ : state) {
+        battles = 0;
+        grid.forEachPairInRange(KILL_DISTANCE, npcs.xData(), npcs.yData(),
+                                [&](NPCStore::Index a, NPCStore::Index b) {
+            if (npcs.canAttack(a, b) || npcs.canAttack(b, a)) {
+                ++battles;
+            }
+        });
+        benchmark::DoNotOptimize(battles);
+    }
+    state.counters["battles"] = static_cast<double>(battles);
+}
+BENCHMARK(BM_GridPairScan)->Arg(1000)->Arg(10000)->Arg(100000)
+    ->Unit(benchmark::kMillisecond);
+
+// Полный тик потока перемещения: шаг всех NPC, обновление клеток и поиск пар
+static void BM_GridMoveAndScan(benchmark::State& state) {
+    auto pop = makePopulation(static_cast<int>(state.range(0)));
+    NPCStore& npcs = pop.store;
+    SpatialGrid grid(KILL_DISTANCE);
+    for (NPCStore::Index i = 0; i < npcs.size(); ++i) {
+        grid.insert(i, npcs.getX(i), npcs.getY(i));
+    }
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<> dirDist(-1, 1);
+    size_t battles = 0;
+
+    for (auto _ : state) {
+        for (NPCStore::Index i = 0; i < npcs.size(); ++i) {
+            float oldX = npcs.getX(i);
+            float oldY = npcs.getY(i);
+            npcs.move(i, dirDist(gen), dirDist(gen), pop.mapSize, pop.mapSize);
+            grid.update(i, oldX, oldY, npcs.getX(i), npcs.getY(i));
+        }
+        battles = 0;
+        grid.forEachPairInRange(KILL_DISTANCE, npcs.xData(), npcs.yData(),
+                                [&](NPCStore::Index a, NPCStore::Index b) {
+            if (npcs.canAttack(a, b) || npcs.canAttack(b, a)) {
+                ++battles;
+            }
+        });
+        benchmark::DoNotOptimize(battles);
+    }
+}
+BENCHMARK(BM_GridMoveAndScan)->Arg(1000)->Arg(10000)->Arg(100000)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,225 @@
+#include <benchmark/benchmark.h>
+#include "npcs.h"
+#include "npc_store.h"
+#include "factory.h"
+#include "dungeon_editor.h"
+#include "philox.h"
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Базовые горячие пути игры: геометрия и проверки атаки, фабрика и
+// сериализация, сохранение и загрузка, выборка живых, бой редактора и
+// перемещение. state.range(0) - число NPC
+
+static const char* TYPE_NAMES[] = {"Orc", "Knight", "Bear"};
+
+static std::vector<std::unique_ptr<NPC>> makeNPCs(int count, int mapSize) {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> posDist(0.0f, mapSize - 1.0f);
+    std::vector<std::unique_ptr<NPC>> npcs;
+    for (int i = 0; i < count; ++i) {
+        npcs.push_back(NPCFactory::createNPC(TYPE_NAMES[i % 3], "NPC_" + std::to_string(i),
+                                             posDist(gen), posDist(gen)));
+    }
+    return npcs;
+}
+
+static void fillStore(NPCStore& store, int count, int mapSize) {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> posDist(0.0f, mapSize - 1.0f);
+    for (int i = 0; i < count; ++i) {
+        store.add(static_cast<NPCType>(i % NPC_TYPE_COUNT), "NPC_" + std::to_string(i),
+                  posDist(gen), posDist(gen));
+    }
+}
+
+// Бой редактора печатает в std::cout; на время замера вывод отключается
+class SilentCout {
+public:
+    SilentCout() : saved(std::cout.rdbuf(sink.rdbuf())) {}
+    ~SilentCout() { std::cout.rdbuf(saved); }
+
+private:
+    std::ostringstream sink;
+    std::streambuf* saved;
+};
+
+// Все пары: distanceTo и isInRange у объектов NPC
+static void BM_NPCDistance(benchmark::State& state) {
+    auto npcs = makeNPCs(static_cast<int>(state.range(0)), 500);
+    for (auto _ : state) {
+        size_t inRange = 0;
+        float total = 0.0f;
+        for (size_t i = 0; i < npcs.size(); ++i) {
+            for (size_t j = i + 1; j < npcs.size(); ++j) {
+                total += npcs[i]->distanceTo(*npcs[j]);
+                inRange += npcs[i]->isInRange(*npcs[j], 10.0f);
+            }
+        }
+        benchmark::DoNotOptimize(total);
+        benchmark::DoNotOptimize(inRange);
+    }
+    auto pairs = npcs.size() * (npcs.size() - 1) / 2;
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * pairs));
+}
+BENCHMARK(BM_NPCDistance)->Arg(100)->Arg(1000);
+
+// То же через NPCView поверх NPCStore
+static void BM_NPCViewDistance(benchmark::State& state) {
+    NPCStore store;
+    fillStore(store, static_cast<int>(state.range(0)), 500);
+    for (auto _ : state) {
+        size_t inRange = 0;
+        for (NPCStore::Index i = 0; i < store.size(); ++i) {
+            NPCView a = store.view(i);
+            for (NPCStore::Index j = i + 1; j < store.size(); ++j) {
+                inRange += a.isInRange(store.view(j), 10.0f);
+            }
+        }
+        benchmark::DoNotOptimize(inRange);
+    }
+    auto pairs = store.size() * (store.size() - 1) / 2;
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * pairs));
+}
+BENCHMARK(BM_NPCViewDistance)->Arg(100)->Arg(1000);
+
+// Цепочка проверок боя: canAttack в обе стороны для каждой пары
+static void BM_CanAttackChain(benchmark::State& state) {
+    auto npcs = makeNPCs(static_cast<int>(state.range(0)), 500);
+    for (auto _ : state) {
+        size_t battles = 0;
+        for (size_t i = 0; i < npcs.size(); ++i) {
+            for (size_t j = i + 1; j < npcs.size(); ++j) {
+                battles += npcs[i]->canAttack(*npcs[j]) || npcs[i]->canBeAttackedBy(*npcs[j]);
+            }
+        }
+        benchmark::DoNotOptimize(battles);
+    }
+    auto pairs = npcs.size() * (npcs.size() - 1) / 2;
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * pairs));
+}
+BENCHMARK(BM_CanAttackChain)->Arg(100)->Arg(1000);
+
+static void BM_FactoryCreateNPC(benchmark::State& state) {
+    int i = 0;
+    for (auto _ : state) {
+        auto npc = NPCFactory::createNPC(TYPE_NAMES[i % 3], "Hero", 10.0f, 20.0f);
+        benchmark::DoNotOptimize(npc.get());
+        ++i;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FactoryCreateNPC);
+
+static void BM_FactoryCreateNPCFromString(benchmark::State& state) {
+    std::vector<std::string> lines;
+    for (auto& npc : makeNPCs(64, 500)) {
+        lines.push_back(NPCFactory::serializeNPC(*npc));
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        auto npc = NPCFactory::createNPCFromString(lines[i++ % lines.size()]);
+        benchmark::DoNotOptimize(npc.get());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FactoryCreateNPCFromString);
+
+static void BM_SerializeNPC(benchmark::State& state) {
+    auto npcs = makeNPCs(64, 500);
+    size_t i = 0;
+    for (auto _ : state) {
+        std::string line = NPCFactory::serializeNPC(*npcs[i++ % npcs.size()]);
+        benchmark::DoNotOptimize(line.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SerializeNPC);
+
+static void fillEditor(DungeonEditor& editor, int count) {
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> posDist(0.0f, 499.0f);
+    for (int i = 0; i < count; ++i) {
+        editor.addNPC(TYPE_NAMES[i % 3], "NPC_" + std::to_string(i), posDist(gen), posDist(gen));
+    }
+}
+
+static const std::string SAVE_FILE = "bench_core_dungeon.txt";
+
+static void BM_EditorSaveToFile(benchmark::State& state) {
+    DungeonEditor editor;
+    fillEditor(editor, static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(editor.saveToFile(SAVE_FILE));
+    }
+    std::remove(SAVE_FILE.c_str());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EditorSaveToFile)->Arg(100)->Arg(10000);
+
+static void BM_EditorLoadFromFile(benchmark::State& state) {
+    DungeonEditor source;
+    fillEditor(source, static_cast<int>(state.range(0)));
+    source.saveToFile(SAVE_FILE);
+
+    DungeonEditor editor;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(editor.loadFromFile(SAVE_FILE));
+    }
+    std::remove(SAVE_FILE.c_str());
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EditorLoadFromFile)->Arg(100)->Arg(10000);
+
+static void BM_GetAliveNPCs(benchmark::State& state) {
+    DungeonEditor editor;
+    fillEditor(editor, static_cast<int>(state.range(0)));
+    // Каждый четвертый мертв
+    for (NPCStore::Index i = 0; i < editor.getNPCs().size(); i += 4) {
+        editor.getNPCs().kill(i);
+    }
+    for (auto _ : state) {
+        auto alive = editor.getAliveNPCs();
+        benchmark::DoNotOptimize(alive.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetAliveNPCs)->Arg(100)->Arg(10000)->Arg(100000);
+
+// Полный бой редактора до последнего выжившего. Наблюдатели редактора
+// остаются подключены: лог боя (log.txt) - часть измеряемой стоимости
+static void BM_StartBattle(benchmark::State& state) {
+    SilentCout silent;
+    for (auto _ : state) {
+        state.PauseTiming();
+        DungeonEditor editor;
+        fillEditor(editor, static_cast<int>(state.range(0)));
+        state.ResumeTiming();
+
+        editor.startBattle(10.0f);
+        benchmark::DoNotOptimize(editor.getNPCCount());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StartBattle)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+// Тело лямбды перемещения за один тик: направления Philox и пакетный сдвиг
+static void BM_MovementTick(benchmark::State& state) {
+    NPCStore store;
+    fillStore(store, static_cast<int>(state.range(0)), 500);
+    CounterRng rng(42);
+    std::vector<float> dirX(store.size()), dirY(store.size());
+    std::uint32_t tick = 0;
+    for (auto _ : state) {
+        rng.fillDirections(++tick, 0, store.size(), dirX.data(), dirY.data());
+        store.moveAll(dirX.data(), dirY.data(), 500, 500);
+        benchmark::DoNotOptimize(store.xData());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_MovementTick)->Arg(100)->Arg(10000)->Arg(100000);
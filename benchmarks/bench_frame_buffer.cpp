@@ -0,0 +1,101 @@
+#include <benchmark/benchmark.h>
+#include "frame_buffer.h"
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+static void fillStore(NPCStore& npcs, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        npcs.add(static_cast<NPCType>(i % NPC_TYPE_COUNT), "NPC_" + std::to_string(i),
+                 static_cast<float>(i % 500), static_cast<float>((i / 500) % 500));
+    }
+}
+
+// Один "тик" писателя: перемещение всех NPC
+static void moveStore(NPCStore& npcs, const std::vector<float>& dirX, const std::vector<float>& dirY) {
+    npcs.moveAll(dirX.data(), dirY.data(), 500, 500);
+}
+
+// Читатель: сумма координат живых NPC (как при выводе карты)
+template <typename Source>
+static float readAlive(const Source& source, size_t count) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        if (source.isAlive(static_cast<NPCStore::Index>(i))) sum += source.getX(i) + source.getY(i);
+    }
+    return sum;
+}
+
+struct FrameSource {
+    const WorldFrame& frame;
+    bool isAlive(size_t i) const { return frame.isAlive(i); }
+    float getX(size_t i) const { return frame.xs[i]; }
+    float getY(size_t i) const { return frame.ys[i]; }
+};
+
+// Старая схема: общий shared_mutex, писатель держит уникальную блокировку весь тик
+static void BM_SharedMutexReader(benchmark::State& state) {
+    size_t count = static_cast<size_t>(state.range(0));
+    NPCStore npcs;
+    fillStore(npcs, count);
+    std::vector<float> dirX(count, 1.0f), dirY(count, -1.0f);
+    std::shared_mutex mutex;
+    std::atomic<bool> running{true};
+    std::atomic<std::uint64_t> ticks{0};
+
+    std::thread writer([&]() {
+        while (running.load(std::memory_order_relaxed)) {
+            {
+                std::unique_lock<std::shared_mutex> lock(mutex);
+                moveStore(npcs, dirX, dirY);
+            }
+            ticks.fetch_add(1, std::memory_order_relaxed);
+            std::this_thread::yield();
+        }
+    });
+
+    for (auto _ : state) {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        benchmark::DoNotOptimize(readAlive(npcs, count));
+    }
+    running = false;
+    writer.join();
+    state.counters["writer_ticks"] = static_cast<double>(ticks.load());
+}
+BENCHMARK(BM_SharedMutexReader)->Arg(10000)->Arg(100000)->UseRealTime();
+
+// Двойной буфер: писатель публикует кадр, читатель закрепляет передний кадр
+static void BM_FrameBufferReader(benchmark::State& state) {
+    size_t count = static_cast<size_t>(state.range(0));
+    NPCStore npcs;
+    fillStore(npcs, count);
+    std::vector<float> dirX(count, 1.0f), dirY(count, -1.0f);
+    std::array<size_t, NPC_TYPE_COUNT> typeCounts{};
+    FrameBuffer frames;
+    frames.publish(npcs, 0, typeCounts, count);
+    std::atomic<bool> running{true};
+
+    std::thread writer([&]() {
+        std::uint32_t tick = 0;
+        while (running.load(std::memory_order_relaxed)) {
+            moveStore(npcs, dirX, dirY);
+            frames.publish(npcs, ++tick, typeCounts, count);
+            std::this_thread::yield();
+        }
+    });
+
+    for (auto _ : state) {
+        auto frame = frames.acquire();
+        benchmark::DoNotOptimize(readAlive(FrameSource{*frame}, count));
+    }
+    running = false;
+    writer.join();
+
+    FrameBufferStats stats = frames.stats();
+    state.counters["writer_ticks"] = static_cast<double>(stats.publishes);
+    state.counters["read_wait_max_ns"] = static_cast<double>(stats.readWaitMax.count());
+    state.counters["write_wait_max_ns"] = static_cast<double>(stats.writeWaitMax.count());
+}
+BENCHMARK(BM_FrameBufferReader)->Arg(10000)->Arg(100000)->UseRealTime();
@@ -0,0 +1,130 @@
+#include <benchmark/benchmark.h>
+#include "npcs.h"
+#include "npc_store.h"
+#include "spatial_grid.h"
+#include "alloc_tracker.h"
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Выделения памяти за время жизни счетчика. Считает глобальный
+// operator new из alloc_hook.cpp, пока AllocTracker включен
+class AllocationCounter {
+public:
+    AllocationCounter() : before(total()) { AllocTracker::setEnabled(true); }
+    ~AllocationCounter() { AllocTracker::setEnabled(false); }
+
+    std::uint64_t count() const { return total() - before; }
+
+private:
+    static std::uint64_t total() {
+        std::uint64_t sum = 0;
+        for (const auto& tag : AllocTracker::report().tags) {
+            sum += tag.allocations;
+        }
+        return sum;
+    }
+
+    std::uint64_t before;
+};
+
+static std::vector<std::unique_ptr<NPC>> makeMixedNPCs(int count) {
+    std::vector<std::unique_ptr<NPC>> npcs;
+    for (int i = 0; i < count; ++i) {
+        std::string name = "NPC_" + std::to_string(i);
+        switch (i % 3) {
+            case 0: npcs.push_back(std::make_unique<Orc>(name, 0, 0)); break;
+            case 1: npcs.push_back(std::make_unique<Knight>(name, 0, 0)); break;
+            default: npcs.push_back(std::make_unique<Bear>(name, 0, 0)); break;
+        }
+    }
+    return npcs;
+}
+
+// Проверка атаки в старом виде: сравнение строки из getType()
+static bool canAttackByName(const NPC& attacker, const NPC& defender) {
+    std::string type = attacker.getType();
+    if (type == "Orc") return defender.getType() == "Bear";
+    if (type == "Knight") return defender.getType() == "Orc";
+    return defender.getType() == "Knight";
+}
+
+static void BM_PairCheckStringTypes(benchmark::State& state) {
+    auto npcs = makeMixedNPCs(64);
+    size_t hits = 0;
+    size_t pairs = 0;
+    AllocationCounter allocations;
+
+    for (auto _ : state) {
+        for (auto& a : npcs) {
+            for (auto& b : npcs) {
+                hits += canAttackByName(*a, *b);
+            }
+        }
+        pairs += npcs.size() * npcs.size();
+    }
+    benchmark::DoNotOptimize(hits);
+    state.counters["allocs_per_pair"] =
+        static_cast<double>(allocations.count()) / pairs;
+    state.SetItemsProcessed(static_cast<int64_t>(pairs));
+}
+BENCHMARK(BM_PairCheckStringTypes);
+
+static void BM_PairCheckKillMatrix(benchmark::State& state) {
+    auto npcs = makeMixedNPCs(64);
+    size_t hits = 0;
+    size_t pairs = 0;
+    AllocationCounter allocations;
+
+    for (auto _ : state) {
+        for (auto& a : npcs) {
+            for (auto& b : npcs) {
+                hits += a->canAttack(*b);
+            }
+        }
+        pairs += npcs.size() * npcs.size();
+    }
+    benchmark::DoNotOptimize(hits);
+    state.counters["allocs_per_pair"] =
+        static_cast<double>(allocations.count()) / pairs;
+    state.SetItemsProcessed(static_cast<int64_t>(pairs));
+}
+BENCHMARK(BM_PairCheckKillMatrix);
+
+// Цикл столкновений потока перемещения: сетка + таблица совместимости
+static void BM_CollisionLoopAllocations(benchmark::State& state) {
+    int count = static_cast<int>(state.range(0));
+    float mapSize = std::sqrt(count / 0.005f);
+
+    NPCStore npcs;
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> posDist(0.0f, mapSize - 1);
+    for (int i = 0; i < count; ++i) {
+        npcs.add(static_cast<NPCType>(i % NPC_TYPE_COUNT), "NPC_" + std::to_string(i),
+                 posDist(gen), posDist(gen));
+    }
+
+    SpatialGrid grid(10.0f);
+    for (NPCStore::Index i = 0; i < npcs.size(); ++i) {
+        grid.insert(i, npcs.getX(i), npcs.getY(i));
+    }
+
+    size_t pairs = 0;
+    size_t battles = 0;
+    AllocationCounter allocations;
+
+    for (auto _ : state) {
+        grid.forEachPairInRange(10.0f, npcs.xData(), npcs.yData(),
+                                [&](NPCStore::Index a, NPCStore::Index b) {
+            ++pairs;
+            battles += npcs.canAttack(a, b) || npcs.canAttack(b, a);
+        });
+    }
+    benchmark::DoNotOptimize(battles);
+    state.counters["allocs"] = static_cast<double>(allocations.count());
+    state.counters["pairs"] = static_cast<double>(pairs);
+}
+BENCHMARK(BM_CollisionLoopAllocations)->Arg(1000)->Arg(10000);
@@ -0,0 +1,30 @@
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Точка входа бенчмарков. Кроме таблицы в консоли результаты пишутся в
+// JSON (по умолчанию benchmark_results.json), чтобы сравнивать прогоны
+// разных версий, например tools/compare.py из Google Benchmark.
+// Явные --benchmark_out и --benchmark_out_format имеют приоритет
+int main(int argc, char** argv) {
+    std::vector<char*> args(argv, argv + argc);
+    bool hasOut = false;
+    bool hasOutFormat = false;
+    for (int i = 1; i < argc; ++i) {
+        hasOut |= std::strncmp(argv[i], "--benchmark_out=", 16) == 0;
+        hasOutFormat |= std::strncmp(argv[i], "--benchmark_out_format=", 23) == 0;
+    }
+
+    std::string out = "--benchmark_out=benchmark_results.json";
+    std::string outFormat = "--benchmark_out_format=json";
+    if (!hasOut) args.push_back(&out[0]);
+    if (!hasOutFormat) args.push_back(&outFormat[0]);
+
+    int count = static_cast<int>(args.size());
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data())) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,39 @@
+#include <benchmark/benchmark.h>
+#include "philox.h"
+#include <random>
+#include <vector>
+
+// Старая схема: общий mt19937 и два uniform_int_distribution на NPC
+static void BM_Mt19937Directions(benchmark::State& state) {
+    size_t count = static_cast<size_t>(state.range(0));
+    std::vector<float> dirX(count), dirY(count);
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> dirDist(-1, 1);
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < count; ++i) {
+            dirX[i] = static_cast<float>(dirDist(gen));
+            dirY[i] = static_cast<float>(dirDist(gen));
+        }
+        benchmark::DoNotOptimize(dirX.data());
+        benchmark::DoNotOptimize(dirY.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+BENCHMARK(BM_Mt19937Directions)->Arg(10000)->Arg(100000);
+
+// Philox: направления без общего состояния, пакетом на весь массив
+static void BM_PhiloxDirections(benchmark::State& state) {
+    size_t count = static_cast<size_t>(state.range(0));
+    std::vector<float> dirX(count), dirY(count);
+    CounterRng rng(42);
+    std::uint32_t tick = 0;
+
+    for (auto _ : state) {
+        rng.fillDirections(++tick, 0, count, dirX.data(), dirY.data());
+        benchmark::DoNotOptimize(dirX.data());
+        benchmark::DoNotOptimize(dirY.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+BENCHMARK(BM_PhiloxDirections)->Arg(10000)->Arg(100000);
@@ -0,0 +1,79 @@
+#include <benchmark/benchmark.h>
+#include "simd_kernels.h"
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Проверка одного NPC против блока кандидатов: sqrt на каждую пару (как в
+// NPC::distanceTo) против пакетного ядра на каждом уровне
+static void BM_DistanceSqrtPerPair(benchmark::State& state) {
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> pos(0, 100);
+    std::vector<float> xs(4096), ys(4096);
+    for (auto& v : xs) v = pos(gen);
+    for (auto& v : ys) v = pos(gen);
+
+    size_t hits = 0;
+    for (auto _ : state) {
+        for (size_t k = 0; k < xs.size(); ++k) {
+            float dx = 50.0f - xs[k];
+            float dy = 50.0f - ys[k];
+            hits += std::sqrt(dx * dx + dy * dy) <= 10.0f;
+        }
+    }
+    benchmark::DoNotOptimize(hits);
+    state.SetItemsProcessed(state.iterations() * xs.size());
+}
+BENCHMARK(BM_DistanceSqrtPerPair);
+
+static void BM_WithinRadiusMask(benchmark::State& state) {
+    auto level = static_cast<SimdKernels::Level>(state.range(0));
+    SimdKernels::setLevel(level);
+    state.SetLabel(SimdKernels::levelName(SimdKernels::activeLevel()));
+
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> pos(0, 100);
+    std::vector<float> xs(4096), ys(4096);
+    for (auto& v : xs) v = pos(gen);
+    for (auto& v : ys) v = pos(gen);
+
+    std::uint64_t acc = 0;
+    for (auto _ : state) {
+        for (size_t start = 0; start < xs.size(); start += SimdKernels::MASK_BLOCK) {
+            acc ^= SimdKernels::withinRadiusMask(50.0f, 50.0f, xs.data() + start,
+                                                 ys.data() + start, SimdKernels::MASK_BLOCK, 10.0f);
+        }
+    }
+    benchmark::DoNotOptimize(acc);
+    state.SetItemsProcessed(state.iterations() * xs.size());
+    SimdKernels::setLevel(SimdKernels::bestSupportedLevel());
+}
+BENCHMARK(BM_WithinRadiusMask)->DenseRange(0, 2);
+
+static void BM_MoveBatch(benchmark::State& state) {
+    auto level = static_cast<SimdKernels::Level>(state.range(0));
+    SimdKernels::setLevel(level);
+    state.SetLabel(SimdKernels::levelName(SimdKernels::activeLevel()));
+
+    const size_t count = 100000;
+    std::mt19937 gen(2);
+    std::uniform_real_distribution<float> pos(0, 1000);
+    std::uniform_int_distribution<> dir(-1, 1);
+    std::vector<float> xs(count), ys(count), dirX(count), dirY(count), distance(count);
+    for (size_t i = 0; i < count; ++i) {
+        xs[i] = pos(gen);
+        ys[i] = pos(gen);
+        dirX[i] = static_cast<float>(dir(gen));
+        dirY[i] = static_cast<float>(dir(gen));
+        distance[i] = (i % 3 == 0) ? 20.0f : (i % 3 == 1 ? 30.0f : 5.0f);
+    }
+
+    for (auto _ : state) {
+        SimdKernels::moveBatch(xs.data(), ys.data(), dirX.data(), dirY.data(),
+                               distance.data(), count, 1000.0f, 1000.0f);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+    SimdKernels::setLevel(SimdKernels::bestSupportedLevel());
+}
+BENCHMARK(BM_MoveBatch)->DenseRange(0, 2);
@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+#include "simulation.h"
+#include <array>
+#include <cmath>
+#include <random>
+#include <string>
+
+// Тики симуляции на большой карте: state.range(0) NPC, state.range(1) потоков.
+// Плотность как в bench_broadphase, чтобы пар было много, но карта не вырождалась.
+// Число тиков фиксировано: NPC гибнут, и поздние тики дешевле ранних
+static void BM_SimulationTick(benchmark::State& state) {
+    int count = static_cast<int>(state.range(0));
+    auto workers = static_cast<size_t>(state.range(1));
+    int mapSize = static_cast<int>(std::sqrt(count / 0.005f));
+
+    NPCStore npcs;
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> posDist(0.0f, mapSize - 1.0f);
+    for (int i = 0; i < count; ++i) {
+        npcs.add(static_cast<NPCType>(i % NPC_TYPE_COUNT), "NPC_" + std::to_string(i),
+                 posDist(gen), posDist(gen));
+    }
+
+    JobSystem jobs(workers);
+    Simulation simulation(npcs, jobs, 7, mapSize, mapSize, 10.0f);
+    jobs.resetStats();
+
+    std::array<double, TickReport::PHASE_COUNT> phaseMs{};
+    size_t activeChunks = 0;
+    for (auto _ : state) {
+        const TickReport& report = simulation.step();
+        for (size_t p = 0; p < TickReport::PHASE_COUNT; ++p) {
+            phaseMs[p] += report.phaseTime[p].count() * 1e-6;
+        }
+        activeChunks += report.activeChunks;
+    }
+
+    double busy = 0;
+    for (const auto& worker : jobs.stats()) busy += worker.utilisation;
+    state.counters["ticks_per_sec"] = benchmark::Counter(
+        static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+    state.counters["avg_utilisation"] = busy / workers;
+    double ticks = static_cast<double>(state.iterations());
+    state.counters["move_ms"] = phaseMs[TickReport::Move] / ticks;
+    state.counters["broad_ms"] = phaseMs[TickReport::BroadPhase] / ticks;
+    state.counters["active_chunks"] = activeChunks / ticks;
+}
+BENCHMARK(BM_SimulationTick)
+    ->ArgsProduct({{10000, 100000}, {1, 2, 4}})
+    ->Iterations(30)
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
@@ -0,0 +1,78 @@
+#include <benchmark/benchmark.h>
+#include "npcs.h"
+#include "factory.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+static const char* const TYPE_NAMES[] = {"Orc", "Knight", "Bear"};
+
+// Виртуальный путь: accept() -> NPCVisitor::visit() -> canAttack()
+class CountingVisitor : public NPCVisitor {
+public:
+    const NPC* attacker = nullptr;
+    size_t kills = 0;
+
+    void visit(Orc& orc) override { kills += attacker->canAttack(orc); }
+    void visit(Knight& knight) override { kills += attacker->canAttack(knight); }
+    void visit(Bear& bear) override { kills += attacker->canAttack(bear); }
+};
+
+static void BM_VirtualVisitorDispatch(benchmark::State& state) {
+    std::vector<std::unique_ptr<NPC>> npcs;
+    for (int i = 0; i < state.range(0); ++i) {
+        npcs.push_back(NPCFactory::createNPC(TYPE_NAMES[(i * 7) % 3], "NPC_" + std::to_string(i), 0, 0));
+    }
+
+    CountingVisitor visitor;
+    for (auto _ : state) {
+        for (auto& a : npcs) {
+            visitor.attacker = a.get();
+            for (auto& d : npcs) {
+                d->accept(visitor);
+            }
+        }
+    }
+    benchmark::DoNotOptimize(visitor.kills);
+    state.SetItemsProcessed(state.iterations() * npcs.size() * npcs.size());
+}
+BENCHMARK(BM_VirtualVisitorDispatch)->Arg(256);
+
+// Статический путь: NPC по значению в std::vector<NPCVariant> и std::visit
+static void BM_VariantDispatch(benchmark::State& state) {
+    std::vector<NPCVariant> npcs;
+    for (int i = 0; i < state.range(0); ++i) {
+        npcs.push_back(NPCFactory::createNPCValue(TYPE_NAMES[(i * 7) % 3], "NPC_" + std::to_string(i), 0, 0));
+    }
+
+    size_t kills = 0;
+    for (auto _ : state) {
+        for (const auto& a : npcs) {
+            for (const auto& d : npcs) {
+                kills += canAttack(a, d);
+            }
+        }
+    }
+    benchmark::DoNotOptimize(kills);
+    state.SetItemsProcessed(state.iterations() * npcs.size() * npcs.size());
+}
+BENCHMARK(BM_VariantDispatch)->Arg(256);
+
+// Создание NPC: if-цепочка и make_unique против таблицы и значения
+static void BM_FactoryHeap(benchmark::State& state) {
+    int i = 0;
+    for (auto _ : state) {
+        auto npc = NPCFactory::createNPC(TYPE_NAMES[i++ % 3], "NPC", 1, 1);
+        benchmark::DoNotOptimize(npc);
+    }
+}
+BENCHMARK(BM_FactoryHeap);
+
+static void BM_FactoryValue(benchmark::State& state) {
+    int i = 0;
+    for (auto _ : state) {
+        auto npc = NPCFactory::createNPCValue(TYPE_NAMES[i++ % 3], "NPC", 1, 1);
+        benchmark::DoNotOptimize(npc);
+    }
+}
+BENCHMARK(BM_FactoryValue);
@@ -0,0 +1,93 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Подсистема, к которой относится выделение памяти
+enum class AllocTag : std::uint8_t {
+    Other,
+    Movement,
+    Battle,
+    Render,
+    Logging,
+    IO,
+    COUNT
+};
+
+constexpr size_t ALLOC_TAG_COUNT = static_cast<size_t>(AllocTag::COUNT);
+
+struct AllocTagStats {
+    std::uint64_t allocations = 0;
+    std::uint64_t frees = 0;
+    std::uint64_t bytes = 0;
+    std::int64_t liveBytes = 0;         // выделено и еще не освобождено
+    std::int64_t peakLiveBytes = 0;
+    std::uint64_t maxTickAllocations = 0;   // худший тик по числу выделений
+    std::uint64_t maxTickBytes = 0;         // худший тик по байтам
+};
+
+struct AllocReport {
+    bool hooked = false;
+    std::uint64_t ticks = 0;
+    std::array<AllocTagStats, ALLOC_TAG_COUNT> tags;
+
+    const AllocTagStats& tag(AllocTag t) const { return tags[static_cast<size_t>(t)]; }
+};
+
+// Учет выделений памяти по тегам. Тег задается областью ScopedAllocTag в
+// текущем потоке (задания JobSystem наследуют тег отправителя). Считает
+// глобальный operator new из alloc_hook.cpp: он входит в тесты, а в игру -
+// при сборке с -DALLOC_TRACKING=ON. Без хука учет пуст.
+// Освобождение относится к тегу выделения; блоки, выделенные до reset()
+// или при выключенном учете, не считаются
+class AllocTracker {
+public:
+    static bool hooked() { return hookedFlag.load(std::memory_order_relaxed); }
+    static bool enabled() { return enabledFlag.load(std::memory_order_relaxed); }
+    static void setEnabled(bool on) { enabledFlag.store(on, std::memory_order_relaxed); }
+
+    static AllocTag currentTag() { return threadTag; }
+    static void setCurrentTag(AllocTag tag) { threadTag = tag; }
+
+    // Для хука: учитывает выделение и возвращает метку для recordFree
+    static std::uint32_t recordAllocation(size_t size);
+    static void recordFree(std::uint32_t token, size_t size);
+    static void markHooked() { hookedFlag.store(true, std::memory_order_relaxed); }
+    static constexpr std::uint32_t NOT_COUNTED = ~std::uint32_t(0);
+
+    // Закрывает тик: выделения с прошлого вызова идут в худший тик
+    static void nextTick();
+    // Начинает окно тика заново, не считая выделения до него (подготовка мира)
+    static void startTick();
+    static AllocReport report();
+    static void reset();
+    // Таблица по тегам для вывода при завершении
+    static std::string format(const AllocReport& report);
+    static const char* name(AllocTag tag);
+
+private:
+    static inline std::atomic<bool> hookedFlag{false};
+    static inline std::atomic<bool> enabledFlag{false};
+    static inline thread_local AllocTag threadTag = AllocTag::Other;
+};
+
+// Тег выделений потока на время области
+class ScopedAllocTag {
+public:
+    explicit ScopedAllocTag(AllocTag tag) : previous(AllocTracker::currentTag()) {
+        AllocTracker::setCurrentTag(tag);
+    }
+    ~ScopedAllocTag() { AllocTracker::setCurrentTag(previous); }
+
+    ScopedAllocTag(const ScopedAllocTag&) = delete;
+    ScopedAllocTag& operator=(const ScopedAllocTag&) = delete;
+
+private:
+    AllocTag previous;
+};
+
+#endif
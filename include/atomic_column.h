@@ -0,0 +1,84 @@
+#ifndef ATOMIC_COLUMN_H
+#define ATOMIC_COLUMN_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Непрерывный массив атомарных значений для колонок NPCStore, которые
+// читает и пишет несколько потоков. Чтение и запись элементов потокобезопасны,
+// изменение размера - нет (только пока симуляция не запущена)
+template <typename T>
+class AtomicColumn {
+public:
+    AtomicColumn() = default;
+    AtomicColumn(const AtomicColumn&) = delete;
+    AtomicColumn& operator=(const AtomicColumn&) = delete;
+
+    AtomicColumn(AtomicColumn&& other) noexcept
+        : data(std::move(other.data)), count(other.count), capacity(other.capacity) {
+        other.count = other.capacity = 0;
+    }
+
+    AtomicColumn& operator=(AtomicColumn&& other) noexcept {
+        data = std::move(other.data);
+        count = other.count;
+        capacity = other.capacity;
+        other.count = other.capacity = 0;
+        return *this;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T load(size_t i, std::memory_order order = std::memory_order_acquire) const {
+        return data[i].load(order);
+    }
+
+    void store(size_t i, T value, std::memory_order order = std::memory_order_release) {
+        data[i].store(value, order);
+    }
+
+    T fetchAdd(size_t i, T value) {
+        return data[i].fetch_add(value, std::memory_order_acq_rel);
+    }
+
+    bool compareExchange(size_t i, T& expected, T desired) {
+        return data[i].compare_exchange_strong(expected, desired, std::memory_order_acq_rel);
+    }
+
+    void pushBack(T value) {
+        if (count == capacity) {
+            grow(capacity ? capacity * 2 : 16);
+        }
+        data[count++].store(value, std::memory_order_relaxed);
+    }
+
+    void resize(size_t newSize, T value = T()) {
+        if (newSize > capacity) {
+            grow(newSize);
+        }
+        for (size_t i = count; i < newSize; ++i) {
+            data[i].store(value, std::memory_order_relaxed);
+        }
+        count = newSize;
+    }
+
+    void clear() { count = 0; }
+
+private:
+    void grow(size_t newCapacity) {
+        std::unique_ptr<std::atomic<T>[]> grown(new std::atomic<T>[newCapacity]);
+        for (size_t i = 0; i < count; ++i) {
+            grown[i].store(data[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        data = std::move(grown);
+        capacity = newCapacity;
+    }
+
+    std::unique_ptr<std::atomic<T>[]> data;
+    size_t count = 0;
+    size_t capacity = 0;
+};
+
+#endif
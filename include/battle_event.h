@@ -0,0 +1,62 @@
+#ifndef BATTLE_EVENT_H
+#define BATTLE_EVENT_H
+
+#include "npcs.h"
+#include "entity_handle.h"
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+enum class BattleResult : std::uint8_t {
+    AttackerKills,
+    DefenderKills,
+    BothDie,
+    Defended        // атака не удалась (броски кубиков)
+};
+
+// Событие битвы без строк: копируется как есть, текст собирает только
+// приемник, которому он нужен (formatBattleEvent)
+struct BattleEvent {
+    EntityHandle attacker;
+    EntityHandle defender;
+    NPCType attackerType = NPCType::Orc;
+    NPCType defenderType = NPCType::Orc;
+    BattleResult result = BattleResult::AttackerKills;
+    std::uint8_t attackRoll = 0;        // 0 - бой без кубиков (редактор)
+    std::uint8_t defenseRoll = 0;
+    std::uint32_t tick = 0;
+    float x = 0.0f;                     // позиция защитника
+    float y = 0.0f;
+};
+
+static_assert(std::is_trivially_copyable<BattleEvent>::value, "BattleEvent is copied into rings");
+
+// Имена NPC по дескрипторам для форматирования событий. Записи не
+// удаляются: событие можно отформатировать и после гибели NPC.
+// Потокобезопасна: приемники читают из своих потоков
+class NameTable {
+public:
+    void set(EntityHandle handle, const std::string& name);
+    // Дописывает имя в out; неизвестный дескриптор - "#индекс"
+    void appendName(EntityHandle handle, std::string& out) const;
+    std::string nameOf(EntityHandle handle) const;
+    size_t size() const;
+    void clear();
+    // Копия всех записей (для сохранения вместе с журналом)
+    std::vector<std::pair<EntityHandle, std::string>> entries() const;
+
+private:
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::uint64_t, std::string> names;
+};
+
+// Текст события в прежних форматах: бой редактора
+// "Orc A kills Bear B", бой симуляции "Battle: Orc A [5] vs Bear B [2] -> B KILLED!"
+void appendBattleEvent(std::string& out, const BattleEvent& event, const NameTable& names);
+std::string formatBattleEvent(const BattleEvent& event, const NameTable& names);
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef BATTLE_LOG_H
+#define BATTLE_LOG_H
+
+#include "observer.h"
+#include "battle_event.h"
+#include "subscription_index.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Двоичный журнал битв. Файл: заголовок, блоки событий, имена, индекс
+// блоков и хвост со смещениями. Блок хранит до blockCapacity событий по
+// колонкам (attacker, defender, tick, x, y, затем байтовые колонки типов,
+// итога и бросков), каждая колонка выровнена на 8 байт, поэтому файл
+// можно читать прямо из mmap. Индекс - по записи на блок: диапазон тиков,
+// маски итогов и типов победителей и Bloom-фильтр участников
+namespace battle_log {
+
+constexpr char FILE_MAGIC[8] = {'L', '7', 'B', 'A', 'T', 'L', 'O', 'G'};
+constexpr char TRAILER_MAGIC[8] = {'L', '7', 'B', 'L', 'E', 'N', 'D', '1'};
+constexpr std::uint32_t BLOCK_MAGIC = 0x314b4c42;   // "BLK1"
+constexpr std::uint32_t VERSION = 1;
+constexpr std::size_t BLOOM_WORDS = 8;              // 512 бит на блок
+
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t blockCapacity;
+};
+
+struct BlockHeader {
+    std::uint32_t magic;
+    std::uint32_t count;
+};
+
+struct BlockIndex {
+    std::uint64_t offset = 0;           // от начала файла до BlockHeader
+    std::uint32_t count = 0;
+    std::uint32_t minTick = 0;
+    std::uint32_t maxTick = 0;
+    std::uint8_t results = 0;           // маска resultBit
+    std::uint8_t killerTypes = 0;       // маска typeBit победителей
+    std::uint16_t reserved = 0;
+    std::uint64_t entities[BLOOM_WORDS] = {};
+
+    void addEntity(EntityHandle handle);
+    bool mayContain(EntityHandle handle) const;
+};
+
+struct Trailer {
+    std::uint64_t namesOffset;
+    std::uint64_t indexOffset;
+    std::uint64_t blockCount;
+    char magic[8];
+};
+
+// Размер блока из count событий
+std::size_t blockSize(std::uint32_t count);
+// Маска typeBit победителей события (0 - никто не погиб)
+std::uint32_t killerTypes(const BattleEvent& event);
+
+}  // namespace battle_log
+
+struct BattleLogStats {
+    std::uint64_t events = 0;
+    std::uint64_t blocks = 0;
+    std::uint64_t bytes = 0;
+    bool failed = false;        // ошибка записи: журнал оборван, хвоста не будет
+};
+
+// Приемник событий в двоичный журнал. Копит блок в колонках и пишет его
+// целиком; имена и индекс пишутся в close() (и в деструкторе). После
+// первой ошибки записи события не принимаются, а close() не пишет хвост:
+// читатель восстановит индекс по уже записанным блокам
+class BattleLogWriter : public BattleObserver {
+public:
+    static constexpr std::uint32_t DEFAULT_BLOCK = 4096;
+
+    // Бросает std::runtime_error, если файл не создать
+    explicit BattleLogWriter(const std::string& path, std::uint32_t blockCapacity = DEFAULT_BLOCK);
+    ~BattleLogWriter() override;
+
+    BattleLogWriter(const BattleLogWriter&) = delete;
+    BattleLogWriter& operator=(const BattleLogWriter&) = delete;
+
+    void onBattleEvent(const BattleEvent& event, const NameTable& names) override;
+    // Дописывает неполный блок, имена и индекс; дальше события не принимаются
+    void close();
+    BattleLogStats stats() const;
+
+private:
+    void writeBlock();
+    // false - запись не удалась, писатель переходит в failed
+    bool writeAll(const void* data, std::size_t size);
+
+    std::string path;
+    std::uint32_t blockCapacity;
+    int fd = -1;
+    std::uint64_t offset = 0;
+    const NameTable* names = nullptr;
+    mutable std::mutex mutex;
+    BattleLogStats totals;
+
+    // Текущий блок по колонкам
+    std::vector<std::uint64_t> attackers;
+    std::vector<std::uint64_t> defenders;
+    std::vector<std::uint32_t> ticks;
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<std::uint8_t> attackerTypes;
+    std::vector<std::uint8_t> defenderTypes;
+    std::vector<std::uint8_t> results;
+    std::vector<std::uint8_t> attackRolls;
+    std::vector<std::uint8_t> defenseRolls;
+    battle_log::BlockIndex current;
+    std::vector<battle_log::BlockIndex> index;
+    std::vector<char> buffer;
+};
+
+// Запрос к журналу; пустые поля - без ограничения
+struct BattleLogQuery {
+    std::uint32_t fromTick = 0;                                 // включительно
+    std::uint32_t toTick = std::numeric_limits<std::uint32_t>::max();
+    std::uint8_t results = ALL_BATTLE_RESULTS;
+    std::uint32_t killerTypes = ALL_NPC_TYPES;  // не все типы - только убийства этими типами
+    std::vector<EntityHandle> entities;         // любой из них участвует в бою
+};
+
+struct BattleLogScan {
+    std::vector<BattleEvent> events;
+    std::size_t blocksTotal = 0;
+    std::size_t blocksScanned = 0;              // блоки, не отброшенные индексом
+};
+
+// Чтение журнала через mmap. Запрос отбрасывает блоки по индексу и в
+// оставшихся читает сначала колонку тиков, остальные - только для строк,
+// прошедших по тику. Журнал без хвоста (процесс не закрыл его) или с
+// испорченным индексом читается по заголовкам блоков; строки с
+// недопустимым итогом или типом пропускаются
+class BattleLogReader {
+public:
+    // Бросает std::runtime_error для недоступного или чужого файла
+    explicit BattleLogReader(const std::string& path);
+    ~BattleLogReader();
+
+    BattleLogReader(const BattleLogReader&) = delete;
+    BattleLogReader& operator=(const BattleLogReader&) = delete;
+
+    std::size_t blockCount() const { return blocks.size(); }
+    std::uint64_t eventCount() const;
+    bool isComplete() const { return complete; }    // индекс и имена прочитаны из хвоста
+    const NameTable& getNames() const { return names; }
+    // Дескрипторы NPC с этим именем (слоты могли переиспользоваться)
+    std::vector<EntityHandle> findByName(const std::string& name) const;
+
+    BattleLogScan query(const BattleLogQuery& query) const;
+
+private:
+    // false - хвоста нет или он не сходится с файлом
+    bool readIndex();
+    void rebuildIndex();
+    // false - секция имен выходит за [offset, end)
+    bool readNames(std::uint64_t offset, std::uint64_t end, NameTable& table) const;
+
+    std::string path;
+    const unsigned char* data = nullptr;
+    std::size_t size = 0;
+    bool complete = false;
+    std::vector<battle_log::BlockIndex> blocks;
+    NameTable names;
+};
+
+#endif
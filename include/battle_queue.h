@@ -0,0 +1,105 @@
+#ifndef BATTLE_QUEUE_H
+#define BATTLE_QUEUE_H
+
+#include "bounded_queue.h"
+#include "entity_handle.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Битва между потоками передается по дескрипторам: к моменту обработки
+// слот может быть освобожден и занят другим NPC
+struct ThreadBattle {
+    EntityHandle attacker;
+    EntityHandle defender;
+    std::uint32_t tick = 0;     // тик, на котором битва найдена
+};
+
+// Что делать, если битвы тика не помещаются в очередь
+enum class BackpressurePolicy {
+    Block,       // ждать, пока потребитель освободит место
+    DropOldest,  // выбрасывать самые старые битвы
+    SkipTick     // отбрасывать все битвы этого тика
+};
+
+struct BattleQueueStats {
+    size_t depth = 0;
+    size_t maxDepth = 0;
+    size_t capacity = 0;
+    std::uint64_t enqueued = 0;
+    std::uint64_t dequeued = 0;
+    std::uint64_t dropped = 0;
+    std::uint64_t coalesced = 0;     // пара уже ждала в очереди
+    std::uint64_t skippedTicks = 0;
+};
+
+// Очередь битв между потоком перемещения и потоком битв поверх BoundedQueue.
+// Пара, которая уже ждет обработки, повторно не ставится. Ожидающие пары
+// хранятся целиком в хеш-таблице с открытой адресацией, поэтому отброшена
+// может быть только настоящая повторная пара
+class BattleQueue {
+public:
+    explicit BattleQueue(size_t capacity = 1024,
+                         BackpressurePolicy policy = BackpressurePolicy::DropOldest);
+
+    // Ставит битвы одного тика; возвращает, сколько из них попало в очередь
+    size_t pushBatch(const ThreadBattle* battles, size_t count);
+    size_t pushBatch(const std::vector<ThreadBattle>& battles) {
+        return pushBatch(battles.data(), battles.size());
+    }
+
+    // Забирает до maxCount битв без ожидания
+    size_t popBatch(ThreadBattle* out, size_t maxCount);
+    // То же, но ждет появления битв не дольше timeout (или до close())
+    size_t waitPopBatch(ThreadBattle* out, size_t maxCount, std::chrono::milliseconds timeout);
+
+    // Будит ожидающих; Block-производитель после этого отбрасывает остаток
+    void close() { closed.store(true, std::memory_order_release); }
+    void reopen() { closed.store(false, std::memory_order_release); }
+    bool isClosed() const { return closed.load(std::memory_order_acquire); }
+
+    void setPolicy(BackpressurePolicy newPolicy) { policy.store(newPolicy, std::memory_order_relaxed); }
+    BackpressurePolicy getPolicy() const { return policy.load(std::memory_order_relaxed); }
+
+    size_t depth() const { return queue.sizeApprox(); }
+    size_t capacity() const { return queue.capacity(); }
+    BattleQueueStats stats() const;
+
+private:
+    // Пара без учета того, кто атакует: меньший и больший дескрипторы
+    struct PendingPair {
+        std::uint64_t low = EMPTY_PAIR;
+        std::uint64_t high = 0;
+    };
+    // Дескриптор с INVALID_INDEX в битве не встречается
+    static constexpr std::uint64_t EMPTY_PAIR = ~0ull;
+
+    static PendingPair pairOf(const ThreadBattle& battle);
+    size_t pendingSlot(const PendingPair& pair) const;
+    // Под pendingMutex: false, если пара уже ждет
+    bool insertPending(const PendingPair& pair);
+    void erasePending(const PendingPair& pair);
+    void growPending();
+    // Снимает отметку ожидания с битв, покинувших очередь
+    void releasePending(const ThreadBattle* battles, size_t count);
+    void recordDepth();
+
+    BoundedQueue<ThreadBattle> queue;
+    std::mutex pendingMutex;
+    std::vector<PendingPair> pending;       // под pendingMutex
+    size_t pendingCount = 0;
+    std::atomic<BackpressurePolicy> policy;
+    std::atomic<bool> closed{false};
+
+    std::atomic<size_t> maxDepth{0};
+    std::atomic<std::uint64_t> enqueued{0};
+    std::atomic<std::uint64_t> dequeued{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<std::uint64_t> coalesced{0};
+    std::atomic<std::uint64_t> skippedTicks{0};
+};
+
+#endif
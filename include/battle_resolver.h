@@ -0,0 +1,68 @@
+#ifndef BATTLE_RESOLVER_H
+#define BATTLE_RESOLVER_H
+
+#include "battle_queue.h"
+#include "npc_store.h"
+#include "job_system.h"
+#include "philox.h"
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Итог одной битвы; порядок итогов совпадает с порядком входных битв
+struct BattleOutcome {
+    NPCStore::Index attacker = 0;
+    NPCStore::Index defender = 0;
+    int attackRoll = 0;
+    int defenseRoll = 0;
+    bool fought = false;    // false: дескриптор устарел, кто-то мертв или атака невозможна
+    bool killed = false;
+};
+
+// Параллельная обработка битв на JobSystem.
+// Битвы раскладываются по волнам так, что в одной волне NPC встречается не
+// больше одного раза, а битвы одного NPC идут по волнам в исходном порядке.
+// Волны обрабатываются по очереди, битвы внутри волны - параллельно.
+// Броски кубиков зависят только от (seed, тик, участники), поэтому результат
+// совпадает с последовательной обработкой при любом числе потоков
+class BattleResolver {
+public:
+    // Битвы выполняются заданиями общего планировщика
+    BattleResolver(JobSystem& jobs, std::uint64_t seed);
+    // Собственный планировщик на workerCount потоков (включая вызывающий)
+    explicit BattleResolver(size_t workerCount = 1, std::uint64_t seed = 0);
+
+    BattleResolver(const BattleResolver&) = delete;
+    BattleResolver& operator=(const BattleResolver&) = delete;
+
+    // Обрабатывает битвы и заполняет outcomes (по одному итогу на битву)
+    void resolve(NPCStore& npcs, const ThreadBattle* battles, size_t count,
+                 std::vector<BattleOutcome>& outcomes);
+
+    size_t getWorkerCount() const { return jobs.getWorkerCount(); }
+    std::uint64_t getSeed() const { return seed; }
+    // Число волн в последнем вызове resolve()
+    size_t getLastWaveCount() const { return waveCount; }
+
+    // Броски 1-6 атакующего и защитника: одно обращение к Philox на битву
+    static std::pair<int, int> rollDice(const CounterRng& rng, const ThreadBattle& battle);
+
+private:
+    void fight(NPCStore& npcs, const ThreadBattle& battle, BattleOutcome& outcome) const;
+
+    std::unique_ptr<JobSystem> ownedJobs;
+    JobSystem& jobs;
+    std::uint64_t seed;
+    CounterRng rng;
+    size_t waveCount = 0;
+
+    // Волны: индексы битв, сгруппированные по номеру волны
+    std::vector<std::uint32_t> waveOf;
+    std::vector<std::uint32_t> waveStart;
+    std::vector<std::uint32_t> waveOrder;
+    std::vector<std::uint32_t> waveFill;    // следующая свободная позиция волны
+    std::vector<std::uint32_t> lastWave;    // по индексу NPC: волна + 1
+};
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Ограниченная lock-free очередь MPMC (кольцо Вьюкова). У каждой ячейки
+// есть номер последовательности: производитель пишет в ячейку, когда номер
+// равен позиции записи, потребитель читает, когда номер на единицу больше.
+// Пакетные операции захватывают сразу несколько подряд идущих ячеек одним CAS
+template <typename T>
+class BoundedQueue {
+public:
+    // Емкость округляется вверх до степени двойки
+    explicit BoundedQueue(size_t capacity) {
+        size_t rounded = 2;
+        while (rounded < capacity) rounded <<= 1;
+
+        mask = rounded - 1;
+        cells.reset(new Cell[rounded]);
+        for (size_t i = 0; i < rounded; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    bool tryPush(const T& value) { return tryPushBatch(&value, 1) == 1; }
+    bool tryPop(T& value) { return tryPopBatch(&value, 1) == 1; }
+
+    // Кладет до count элементов подряд; возвращает, сколько поместилось
+    size_t tryPushBatch(const T* items, size_t count) {
+        if (count == 0) return 0;
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            size_t ready = countCells(pos, count, 0);
+            if (ready == 0) {
+                // Ячейка еще занята: либо очередь полна, либо позиция устарела
+                size_t seq = cells[pos & mask].sequence.load(std::memory_order_acquire);
+                if (static_cast<std::ptrdiff_t>(seq - pos) < 0) return 0;
+                pos = enqueuePos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (enqueuePos.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed)) {
+                for (size_t i = 0; i < ready; ++i) {
+                    Cell& cell = cells[(pos + i) & mask];
+                    cell.value = items[i];
+                    cell.sequence.store(pos + i + 1, std::memory_order_release);
+                }
+                return ready;
+            }
+        }
+    }
+
+    // Забирает до maxCount элементов подряд; возвращает, сколько забрано
+    size_t tryPopBatch(T* out, size_t maxCount) {
+        if (maxCount == 0) return 0;
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            size_t ready = countCells(pos, maxCount, 1);
+            if (ready == 0) {
+                size_t seq = cells[pos & mask].sequence.load(std::memory_order_acquire);
+                if (static_cast<std::ptrdiff_t>(seq - (pos + 1)) < 0) return 0;
+                pos = dequeuePos.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (dequeuePos.compare_exchange_weak(pos, pos + ready, std::memory_order_relaxed)) {
+                for (size_t i = 0; i < ready; ++i) {
+                    Cell& cell = cells[(pos + i) & mask];
+                    out[i] = cell.value;
+                    cell.sequence.store(pos + i + mask + 1, std::memory_order_release);
+                }
+                return ready;
+            }
+        }
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    // Приблизительная глубина: точна только в отсутствие параллельных операций
+    size_t sizeApprox() const {
+        size_t head = dequeuePos.load(std::memory_order_relaxed);
+        size_t tail = enqueuePos.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    // Сколько ячеек подряд, начиная с pos, готовы (sequence == pos + i + offset)
+    size_t countCells(size_t pos, size_t limit, size_t offset) const {
+        size_t ready = 0;
+        while (ready < limit && ready <= mask) {
+            size_t seq = cells[(pos + ready) & mask].sequence.load(std::memory_order_acquire);
+            if (seq != pos + ready + offset) break;
+            ++ready;
+        }
+        return ready;
+    }
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask = 0;
+    // Позиции на разных кэш-линиях, чтобы производители и потребители не мешали друг другу
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) std::atomic<size_t> dequeuePos{0};
+};
+
+#endif
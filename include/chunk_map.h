@@ -0,0 +1,214 @@
+#ifndef CHUNK_MAP_H
+#define CHUNK_MAP_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Разреженная карта чанков: мир делится на квадраты chunkSize x chunkSize,
+// но чанк создается, только когда в нем появляется NPC, и удаляется, когда
+// последний NPC его покидает. Память зависит от занятой площади, а не от
+// размеров мира. Тик обрабатывает только занятые (активные) чанки; пары
+// на границе с соседними чанками находит SpatialGrid.
+// В чанках хранятся индексы NPC в NPCStore. Чанк считает NPC по тегам (типам)
+// и может спать: спящий чанк тик не обрабатывает
+class ChunkMap {
+public:
+    using Id = std::uint32_t;
+    using ChunkKey = std::uint64_t;
+    using Tag = std::uint8_t;
+    static constexpr size_t MAX_TAGS = 8;
+
+    struct Chunk {
+        std::int32_t cx = 0;
+        std::int32_t cy = 0;
+        std::vector<Id> members;
+        std::array<std::uint32_t, MAX_TAGS> tagCounts{};
+        std::array<std::uint8_t, MAX_TAGS> aroundCounts{};  // соседних чанков с тегом
+        std::uint32_t mask = 0;         // теги, которые есть в чанке
+        std::uint32_t around = 0;       // теги восьми соседних чанков
+        bool busy = true;               // результат последней проверки busy()
+        bool asleep = false;
+        std::uint32_t idleTicks = 0;    // тиков подряд без повода не спать
+        std::uint32_t awakeSlot = NO_SLOT;
+    };
+
+    explicit ChunkMap(float chunkSize);
+
+    void insert(Id id, float x, float y, Tag tag = 0);
+    void remove(Id id);
+    // Переносит NPC, если его новая позиция в другом чанке; true при переносе
+    bool update(Id id, float newX, float newY);
+    // Убирает всех NPC, для которых pred(id) == true
+    template <typename Pred>
+    void removeIf(Pred&& pred);
+    void clear();
+
+    // Один тик сна. busy(chunk) должен зависеть только от масок чанка и
+    // соседей (neighbourhoodMask): спящий чанк проверяется, лишь когда в
+    // нем или рядом появляется новый тег. Чанк засыпает после sleepAfter тиков подряд без занятости (0 - никогда)
+    // и просыпается, как только busy снова true; о каждом переходе
+    // сообщается onChange(chunk, asleep). Стоимость - по бодрствующим чанкам
+    template <typename Busy, typename OnChange>
+    void updateSleep(Busy&& busy, std::uint32_t sleepAfter, OnChange&& onChange);
+    // Бодрствующие чанки (новые чанки бодрствуют)
+    const std::vector<Chunk*>& awakeChunks() const { return awake; }
+    size_t sleepingCount() const { return chunks.size() - awake.size(); }
+    // NPC с тегом во всех чанках
+    size_t tagCount(Tag tag) const { return tagTotals[tag]; }
+
+    // Чанк с координатами (cx, cy) или nullptr
+    const Chunk* find(std::int32_t cx, std::int32_t cy) const;
+    // Объединение масок чанка и восьми его соседей
+    static std::uint32_t neighbourhoodMask(const Chunk& chunk) { return chunk.mask | chunk.around; }
+    static ChunkKey makeKey(std::int32_t cx, std::int32_t cy);
+
+    // Занятые чанки. Порядок определяется последовательностью изменений карты,
+    // поэтому одинаков при одинаковой истории (и любом числе потоков)
+    const std::vector<const Chunk*>& activeChunks() const;
+
+    size_t size() const { return count; }
+    size_t chunkCount() const { return chunks.size(); }
+    float getChunkSize() const { return chunkSize; }
+    bool contains(Id id) const { return id < slotOf.size() && slotOf[id] != NO_SLOT; }
+    // true, если NPC уже числится в чанке точки (x, y)
+    bool isInChunk(Id id, float x, float y) const;
+    // Примерный объем памяти чанков и индексов в байтах
+    size_t memoryBytes() const;
+
+private:
+    static constexpr std::uint32_t NO_SLOT = ~std::uint32_t(0);
+
+    ChunkKey keyFor(float x, float y) const;
+    void attach(Id id, ChunkKey key);
+    void detach(Id id);
+    void addTag(Chunk& chunk, ChunkKey key, Tag tag);
+    void removeTag(Chunk& chunk, ChunkKey key, Tag tag);
+    // Тег появился в чанке или пропал: поправить счетчики соседей
+    void updateAround(const Chunk& chunk, Tag tag, bool present);
+    // Новый чанк собирает теги соседей
+    void collectAround(Chunk& chunk);
+    void wake(Chunk& chunk);
+    void dropAwake(Chunk& chunk);
+
+    float chunkSize;
+    float invChunkSize;
+    size_t count = 0;
+    std::unordered_map<ChunkKey, Chunk> chunks;
+    // Для каждого NPC - его чанк и позиция в списке, чтобы убирать за O(1)
+    std::vector<ChunkKey> chunkOf;
+    std::vector<std::uint32_t> slotOf;
+    std::vector<Tag> tagOf;
+    std::array<size_t, MAX_TAGS> tagTotals{};
+
+    // Спящие чанки, рядом с которыми с прошлого updateSleep появились теги
+    std::vector<ChunkKey> wakeCandidates;
+    std::vector<Chunk*> awake;
+
+    mutable std::vector<const Chunk*> active;
+    mutable bool activeDirty = true;
+};
+
+inline ChunkMap::ChunkKey ChunkMap::makeKey(std::int32_t cx, std::int32_t cy) {
+    return (static_cast<ChunkKey>(static_cast<std::uint32_t>(cx)) << 32) |
+           static_cast<std::uint32_t>(cy);
+}
+
+template <typename Pred>
+void ChunkMap::removeIf(Pred&& pred) {
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        auto& members = it->second.members;
+        for (size_t k = 0; k < members.size();) {
+            Id id = members[k];
+            if (!pred(id)) {
+                ++k;
+                continue;
+            }
+            // Последний занимает место удаленного
+            removeTag(it->second, it->first, tagOf[id]);
+            members[k] = members.back();
+            slotOf[members[k]] = static_cast<std::uint32_t>(k);
+            members.pop_back();
+            slotOf[id] = NO_SLOT;
+            --count;
+        }
+
+        if (members.empty()) {
+            dropAwake(it->second);
+            it = chunks.erase(it);
+            activeDirty = true;
+        } else {
+            ++it;
+        }
+    }
+}
+
+inline void ChunkMap::addTag(Chunk& chunk, ChunkKey key, Tag tag) {
+    ++tagTotals[tag];
+    if (chunk.tagCounts[tag]++ == 0) {
+        chunk.mask |= std::uint32_t(1) << tag;
+        if (chunk.asleep) wakeCandidates.push_back(key);
+        updateAround(chunk, tag, true);
+    }
+}
+
+inline void ChunkMap::removeTag(Chunk& chunk, ChunkKey, Tag tag) {
+    --tagTotals[tag];
+    if (--chunk.tagCounts[tag] == 0) {
+        chunk.mask &= ~(std::uint32_t(1) << tag);
+        updateAround(chunk, tag, false);
+    }
+}
+
+inline void ChunkMap::wake(Chunk& chunk) {
+    chunk.asleep = false;
+    chunk.idleTicks = 0;
+    chunk.awakeSlot = static_cast<std::uint32_t>(awake.size());
+    awake.push_back(&chunk);
+}
+
+inline void ChunkMap::dropAwake(Chunk& chunk) {
+    if (chunk.awakeSlot == NO_SLOT) return;
+    awake[chunk.awakeSlot] = awake.back();
+    awake[chunk.awakeSlot]->awakeSlot = chunk.awakeSlot;
+    awake.pop_back();
+    chunk.awakeSlot = NO_SLOT;
+}
+
+template <typename Busy, typename OnChange>
+void ChunkMap::updateSleep(Busy&& busy, std::uint32_t sleepAfter, OnChange&& onChange) {
+    // Исчезновение тегов занятости не добавляет, поэтому спящие чанки
+    // проверяются только при появлении новых тегов рядом
+    for (ChunkKey key : wakeCandidates) {
+        auto it = chunks.find(key);
+        if (it == chunks.end() || !it->second.asleep) continue;
+        Chunk& chunk = it->second;
+        if (busy(static_cast<const Chunk&>(chunk))) {
+            wake(chunk);
+            onChange(static_cast<const Chunk&>(chunk), false);
+        }
+    }
+    wakeCandidates.clear();
+
+    for (size_t k = 0; k < awake.size();) {
+        Chunk& chunk = *awake[k];
+        chunk.busy = busy(static_cast<const Chunk&>(chunk));
+        if (chunk.busy) {
+            chunk.idleTicks = 0;
+        } else if (chunk.idleTicks < sleepAfter) {
+            ++chunk.idleTicks;
+        }
+        if (sleepAfter > 0 && !chunk.busy && chunk.idleTicks >= sleepAfter) {
+            // На место k встает последний, еще не обработанный чанк
+            chunk.asleep = true;
+            dropAwake(chunk);
+            onChange(static_cast<const Chunk&>(chunk), true);
+            continue;
+        }
+        ++k;
+    }
+}
+
+#endif
@@ -2,6 +2,7 @@
 #define DUNGEON_EDITOR_H
 
 #include "npcs.h"
+#include "npc_store.h"
 #include "factory.h"
 #include "observer.h"
 #include <memory>
@@ -9,13 +10,17 @@
 #include <string>
 #include <algorithm>
 #include <unordered_set>
+#include <optional>
 
 
 class BattleVisitor;
 
 class DungeonEditor {
 private:
-    std::vector<std::unique_ptr<NPC>> npcs;
+    NPCStore npcs;
+    WorldBounds bounds = DEFAULT_WORLD_BOUNDS;
+    // Имена для текста событий; объявлена до логгеров и переживает их
+    NameTable names;
     BattleNotifier notifier;
     std::shared_ptr<FileLogger> fileLogger;
     std::shared_ptr<ConsoleLogger> consoleLogger;
@@ -25,36 +30,52 @@ public:
     
     // Основные методы редактора
     bool addNPC(const std::string& type, const std::string& name, float x, float y);
+    // То же, но возвращает дескриптор (недействительный при ошибке)
+    EntityHandle spawnNPC(const std::string& type, const std::string& name, float x, float y);
+    bool removeNPC(EntityHandle handle);
+    std::optional<NPCView> findNPC(EntityHandle handle);
     void printNPCs() const;
     bool saveToFile(const std::string& filename) const;
     bool loadFromFile(const std::string& filename);
     void startBattle(float range);
     
+    // Границы мира для новых и загружаемых NPC
+    void setBounds(const WorldBounds& newBounds) { bounds = newBounds; }
+    const WorldBounds& getBounds() const { return bounds; }
+    
     // Вспомогательные методы
     size_t getNPCCount() const;
-    const std::vector<std::unique_ptr<NPC>>& getNPCs() const;
-    std::vector<NPC*> getAliveNPCs() const;
+    const NPCStore& getNPCs() const;
+    NPCStore& getNPCs();
+    const NameTable& getNames() const { return names; }
+    NPCView getNPC(size_t index);
+    std::vector<NPCView> getAliveNPCs();
 };
 
-class BattleVisitor : public NPCVisitor {
+// Проводит бой между NPC из NPCStore. Вместо visit(Orc&)/visit(Knight&)
+// работает с представлениями NPCView, тип берется из колонки хранилища.
+// Итог боя уходит наблюдателям как BattleEvent, строки здесь не собираются
+class BattleVisitor {
 private:
-    NPC* currentAttacker;
+    NPCStore::Index currentAttacker;
+    bool hasAttacker;
     float battleRange;
     BattleNotifier& notifier;
-    std::vector<std::unique_ptr<NPC>>& npcs;
-    std::unordered_set<NPC*> markedForRemoval;
+    NPCStore& npcs;
+    std::uint32_t round = 0;
+    std::vector<NPCStore::Index> markedForRemoval;   // не больше двух за бой
     
 public:
-    BattleVisitor(float range, BattleNotifier& notifier, 
-                  std::vector<std::unique_ptr<NPC>>& npcs);
+    BattleVisitor(float range, BattleNotifier& notifier, NPCStore& npcs);
     
-    void setCurrentAttacker(NPC* attacker);
-    void visit(Orc& orc) override;
-    void visit(Knight& knight) override;
-    void visit(Bear& bear) override;
+    void setCurrentAttacker(NPCStore::Index attacker);
+    // Номер прохода startBattle, попадает в BattleEvent::tick
+    void setRound(std::uint32_t value) { round = value; }
+    void visit(NPCView defender);
     
-    void performBattle(NPC& attacker, NPC& defender);
-    std::unordered_set<NPC*> getMarkedForRemoval() const;
+    void performBattle(NPCView attacker, NPCView defender);
+    const std::vector<NPCStore::Index>& markedList() const { return markedForRemoval; }
+    std::unordered_set<NPCStore::Index> getMarkedForRemoval() const;
     void clearMarkedForRemoval();
 };
 
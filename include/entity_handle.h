@@ -0,0 +1,38 @@
+#ifndef ENTITY_HANDLE_H
+#define ENTITY_HANDLE_H
+
+#include <cstdint>
+#include <functional>
+
+// Поколенческий дескриптор NPC: индекс слота в NPCStore и номер поколения.
+// Когда слот освобождается, его поколение растет, и старые дескрипторы
+// перестают разрешаться, даже если слот уже занят другим NPC
+struct EntityHandle {
+    static constexpr std::uint32_t INVALID_INDEX = 0xffffffffu;
+
+    std::uint32_t index = INVALID_INDEX;
+    std::uint32_t generation = 0;
+
+    bool isValid() const { return index != INVALID_INDEX; }
+
+    // Упаковка в 64 бита (для ключей и сравнения пар)
+    std::uint64_t packed() const {
+        return (static_cast<std::uint64_t>(generation) << 32) | index;
+    }
+
+    bool operator==(const EntityHandle& other) const {
+        return index == other.index && generation == other.generation;
+    }
+    bool operator!=(const EntityHandle& other) const { return !(*this == other); }
+};
+
+namespace std {
+template <>
+struct hash<EntityHandle> {
+    size_t operator()(const EntityHandle& handle) const {
+        return hash<uint64_t>()(handle.packed());
+    }
+};
+}
+
+#endif
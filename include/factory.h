@@ -2,17 +2,31 @@
 #define FACTORY_H
 
 #include "npcs.h"
+#include "npc_store.h"
+#include "world_bounds.h"
 #include <memory>
 #include <string>
 
+// Координаты проверяются по границам мира; без границ - DEFAULT_WORLD_BOUNDS
 class NPCFactory {
 public:
     static std::unique_ptr<NPC> createNPC(const std::string& type, 
                                          const std::string& name, 
-                                         float x, float y);
+                                         float x, float y,
+                                         const WorldBounds& bounds = DEFAULT_WORLD_BOUNDS);
     
-    static std::unique_ptr<NPC> createNPCFromString(const std::string& data);
+    static std::unique_ptr<NPC> createNPCFromString(const std::string& data,
+                                                    const WorldBounds& bounds = DEFAULT_WORLD_BOUNDS);
+    
+    // То же, но NPC по значению (без выделения памяти под объект)
+    static NPCVariant createNPCValue(const std::string& type, 
+                                     const std::string& name, 
+                                     float x, float y,
+                                     const WorldBounds& bounds = DEFAULT_WORLD_BOUNDS);
+    static NPCVariant createNPCValueFromString(const std::string& data,
+                                               const WorldBounds& bounds = DEFAULT_WORLD_BOUNDS);
     static std::string serializeNPC(const NPC& npc);
+    static std::string serializeNPC(const NPCStore& store, NPCStore::Index index);
 };
 
 #endif
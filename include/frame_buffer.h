@@ -0,0 +1,131 @@
+#ifndef FRAME_BUFFER_H
+#define FRAME_BUFFER_H
+
+#include "npc_store.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Неизменяемый снимок мира на границе тика: колонки NPCStore по индексам слотов
+class FrameView;
+
+struct WorldFrame {
+    std::uint32_t tick = 0;
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<NPCType> types;
+    std::vector<std::uint8_t> alive;
+    std::vector<std::string> names;     // копируются, только если имена менялись
+    std::uint64_t nameVersion = ~std::uint64_t(0);
+    size_t aliveCount = 0;
+    std::array<size_t, NPC_TYPE_COUNT> typeCounts{};
+
+    size_t size() const { return xs.size(); }
+    bool isAlive(size_t i) const { return alive[i] != 0; }
+    const NPCTraits& getTraits(size_t i) const { return traitsOf(types[i]); }
+    std::vector<FrameView> getAliveNPCs() const;
+};
+
+// NPC из кадра с API NPCView (только чтение); действителен, пока кадр закреплен
+class FrameView {
+public:
+    FrameView(const WorldFrame& frame, size_t index) : frame(&frame), index(index) {}
+
+    size_t getIndex() const { return index; }
+    std::string getType() const { return frame->getTraits(index).name; }
+    NPCType getTypeId() const { return frame->types[index]; }
+    const std::string& getName() const { return frame->names[index]; }
+    float getX() const { return frame->xs[index]; }
+    float getY() const { return frame->ys[index]; }
+    std::pair<int, int> getPosition() const {
+        return {static_cast<int>(getX()), static_cast<int>(getY())};
+    }
+    char getSymbol() const { return frame->getTraits(index).symbol; }
+    bool isAlive() const { return frame->isAlive(index); }
+
+private:
+    const WorldFrame* frame;
+    size_t index;
+};
+
+inline std::vector<FrameView> WorldFrame::getAliveNPCs() const {
+    std::vector<FrameView> result;
+    result.reserve(aliveCount);
+    for (size_t i = 0; i < size(); ++i) {
+        if (isAlive(i)) result.emplace_back(*this, i);
+    }
+    return result;
+}
+
+struct FrameBufferStats {
+    std::uint64_t publishes = 0;
+    std::uint64_t reads = 0;
+    std::uint64_t readRetries = 0;          // кадр сменился во время захвата
+    std::chrono::nanoseconds readWaitTotal{0};
+    std::chrono::nanoseconds readWaitMax{0};
+    std::chrono::nanoseconds writeWaitTotal{0}; // писатель ждал читателей старого кадра
+    std::chrono::nanoseconds writeWaitMax{0};
+};
+
+// Двойной буфер кадров. Писатель (поток симуляции) заполняет задний кадр
+// и атомарно делает его передним; читатели закрепляют передний кадр счетчиком
+// и читают его без блокировок. Перед записью писатель ждет, пока заднего
+// кадра (бывшего переднего) не касается ни один читатель
+class FrameBuffer {
+public:
+    // Закрепленный кадр; пока объект жив, кадр не перезаписывается
+    class ReadGuard {
+    public:
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ReadGuard(ReadGuard&& other) noexcept : owner(other.owner), index(other.index) {
+            other.owner = nullptr;
+        }
+        ~ReadGuard() { release(); }
+
+        const WorldFrame& operator*() const { return owner->frames[index]; }
+        const WorldFrame* operator->() const { return &owner->frames[index]; }
+        void release();
+
+    private:
+        friend class FrameBuffer;
+        ReadGuard(FrameBuffer* owner, int index) : owner(owner), index(index) {}
+
+        FrameBuffer* owner;
+        int index;
+    };
+
+    FrameBuffer() = default;
+    FrameBuffer(const FrameBuffer&) = delete;
+    FrameBuffer& operator=(const FrameBuffer&) = delete;
+
+    ReadGuard acquire();
+
+    // Для писателя: копирует состояние хранилища в задний кадр и публикует его
+    void publish(const NPCStore& npcs, std::uint32_t tick,
+                 const std::array<size_t, NPC_TYPE_COUNT>& typeCounts, size_t aliveCount);
+
+    FrameBufferStats stats() const;
+
+private:
+    static void addWait(std::atomic<std::int64_t>& total, std::atomic<std::int64_t>& max,
+                        std::chrono::nanoseconds wait);
+
+    std::array<WorldFrame, 2> frames;
+    std::array<std::atomic<int>, 2> pins{};
+    std::atomic<int> front{0};
+
+    std::atomic<std::uint64_t> publishes{0};
+    std::atomic<std::uint64_t> reads{0};
+    std::atomic<std::uint64_t> readRetries{0};
+    std::atomic<std::int64_t> readWaitTotal{0};
+    std::atomic<std::int64_t> readWaitMax{0};
+    std::atomic<std::int64_t> writeWaitTotal{0};
+    std::atomic<std::int64_t> writeWaitMax{0};
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef GAME_CONFIG_H
+#define GAME_CONFIG_H
+
+#include "scenario.h"
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Параметры игры. В реальном времени тики идут с частотой tickRate и карта
+// печатается раз в секунду; в режиме headless тики идут подряд без вывода
+// и без пауз, насколько позволяет процессор
+struct GameConfig {
+    int mapWidth = 100;
+    int mapHeight = 100;
+    int npcCount = 50;
+    float killDistance = 10.0f;
+    ScenarioKind scenario = ScenarioKind::Uniform;  // начальная расстановка NPC
+
+    double tickRate = 10.0;             // тиков в секунду игрового времени
+    double duration = 30.0;             // секунды игрового времени
+    std::uint64_t tickCount = 0;        // если не 0, задает длину игры вместо duration
+    bool headless = false;
+
+    size_t workerCount = 0;             // 0 - по числу ядер
+    std::optional<std::uint64_t> seed;  // без значения - случайный
+    bool sharedSnapshot = true;         // публиковать кадры в разделяемую память
+    std::string shmName;                // имя сегмента; пусто - shared_snapshot::DEFAULT_NAME
+    std::string metricsPath;            // не пусто - собирать метрики и записать их сюда в конце
+    bool allocReport = false;           // учет выделений по тегам и отчет в конце
+
+    // Битвы в консоли: сводка раз в секунду или строка на битву (для отладки)
+    bool verboseBattles = false;
+    std::uint32_t battleSample = 1;     // verbose: каждая N-я битва
+    std::uint32_t battleRate = 0;       // verbose: строк в секунду, 0 - без ограничения
+    std::string battleRecordPath;       // не пусто - двоичный журнал битв (battle_log_query)
+
+    std::uint64_t totalTicks() const;
+    double simulatedSeconds() const { return totalTicks() / tickRate; }
+    std::chrono::nanoseconds tickInterval() const;
+
+    // Разбор аргументов командной строки; бросает std::invalid_argument
+    static GameConfig fromArgs(int argc, const char* const* argv);
+    static std::string usage(const std::string& program);
+};
+
+// Итог запуска игры
+struct RunReport {
+    std::uint64_t ticks = 0;
+    double simulatedSeconds = 0.0;
+    double wallSeconds = 0.0;
+    double ticksPerSecond = 0.0;
+    size_t kills = 0;
+    size_t alive = 0;
+    size_t battles = 0;             // проведенные битвы (fought)
+    size_t battlesDropped = 0;      // контакты сверх предела битв за тик
+    double tickP50Ms = 0.0;         // задержка тика: медиана и 99-й процентиль
+    double tickP99Ms = 0.0;
+};
+
+#endif
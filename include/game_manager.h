@@ -2,65 +2,87 @@
 #define GAME_MANAGER_H
 
 #include "dungeon_editor.h"
+#include "simulation.h"
+#include "job_system.h"
+#include "shared_snapshot.h"
+#include "game_config.h"
+#include "metrics.h"
+#include "alloc_tracker.h"
+#include "battle_log.h"
 #include <thread>
 #include <mutex>
-#include <shared_mutex>
-#include <condition_variable>
-#include <queue>
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <random>
 #include <unordered_set>
-
-struct ThreadBattle {
-    NPC* attacker;
-    NPC* defender;
-};
+#include <vector>
 
 class GameManager {
 private:
-    // Константы
-    static constexpr int MAP_WIDTH = 100;
-    static constexpr int MAP_HEIGHT = 100;
-    static constexpr int INITIAL_NPC_COUNT = 50;
-    static constexpr int GAME_DURATION = 30; // секунды
+    GameConfig config;
     
     // Потоки и синхронизация
-    std::thread movementThread;
-    std::thread battleThread;
+    std::thread simulationThread;
     std::atomic<bool> running{false};
     std::atomic<bool> gameOver{false};
     
     // Мьютексы
-    mutable std::shared_mutex npcMutex;  // Для доступа к NPC
-    mutable std::mutex printMutex;       // Для вывода в консоль
-    std::mutex battleQueueMutex;         // Для очереди битв
+    mutable InstrumentedMutex printMutex{LockId::Print};   // Для вывода в консоль
     
-    // Очередь битв и условная переменная
-    std::queue<ThreadBattle> battleQueue;
-    std::condition_variable battleCV;
-    
-    // Генератор случайных чисел
+    // seed расстановки NPC (ScenarioGenerator) и случайности тиков (Simulation)
     std::random_device rd;
-    std::mt19937 gen;
-    std::uniform_int_distribution<> diceDist;
+    std::uint64_t seed;
     
     // Редактор с NPC
     DungeonEditor editor;
     
+    // Битвы тиков в консоль: события доставляет свой поток, сводку или
+    // строки собирает ConsoleLogger
+    std::shared_ptr<ConsoleLogger> battleConsole;
+    std::shared_ptr<BattleLogWriter> battleRecord;     // --battle-record
+    BattleNotifier battleLog;
+    
+    // Планировщик заданий и тик игры поверх него
+    JobSystem jobs;
+    Simulation simulation;
+    
+    // Снимок мира в разделяемой памяти для внешних просмотрщиков (может отсутствовать)
+    std::unique_ptr<SharedSnapshotWriter> sharedSnapshot;
+    
     // Переменная для отслеживания времени вывода
     int lastPrintedSecond;
     
+    // Счетчики тиков текущего запуска (пишет только поток симуляции)
+    std::uint64_t ticksRun = 0;
+    size_t killsRun = 0;
+    size_t battlesRun = 0;
+    size_t droppedRun = 0;
+    std::vector<double> tickMillis;       // длительность каждого тика
+    
 public:
-    GameManager();
+    explicit GameManager(const GameConfig& config = GameConfig());
     ~GameManager();
     
-    void run();
+    // Играет config.totalTicks() тиков в выбранном режиме
+    RunReport run();
     void stop();
     
+    const GameConfig& getConfig() const { return config; }
+    
 private:
     void initializeNPCs();
-    void movementWorker();
-    void battleWorker();
+    RunReport runRealtime();
+    RunReport runHeadless();
+    // Учитывает итоги тика в счетчиках запуска
+    void recordTick(const TickReport& report, std::chrono::steady_clock::duration elapsed);
+    RunReport makeReport(double wallSeconds, size_t alive) const;
+    void startSharedSnapshot();
+    void simulationWorker();
+    // Битвы тика уходят в battleLog в исходном порядке
+    void publishBattles(const TickReport& report);
+    void printRunSummary(const RunReport& report);
+    void writeMetrics();
     void printMap();
     void printSurvivors();
 };
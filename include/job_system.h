@@ -0,0 +1,109 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "metrics.h"
+#include "alloc_tracker.h"
+
+// Счетчик незавершенных заданий группы; wait() ждет его обнуления
+struct JobCounter {
+    std::atomic<size_t> pending{0};
+};
+
+// Планировщик заданий с кражей работы. У каждого потока своя очередь:
+// владелец берет задания с конца, остальные крадут с начала.
+// Поток, ждущий группу заданий, не спит, а выполняет задания сам
+class JobSystem {
+public:
+    using Job = std::function<void()>;
+
+    struct WorkerStats {
+        std::uint64_t jobs = 0;
+        std::uint64_t steals = 0;
+        double busySeconds = 0.0;
+        double utilisation = 0.0;    // доля времени с последнего resetStats()
+    };
+
+    // workerCount - общее число потоков, включая вызывающий (слот 0)
+    explicit JobSystem(size_t workerCount = defaultWorkerCount());
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void submit(Job job, JobCounter& counter);
+    // Выполняет задания (свои и чужие), пока counter не обнулится
+    void wait(JobCounter& counter);
+
+    // Делит [0, count) на куски по grain и вызывает f(begin, end) параллельно
+    template <typename F>
+    void parallelFor(size_t count, size_t grain, F&& f);
+
+    size_t getWorkerCount() const { return workers.size(); }
+    std::vector<WorkerStats> stats() const;
+    void resetStats();
+
+    static size_t defaultWorkerCount();
+
+private:
+    struct Task {
+        Job job;
+        JobCounter* counter;
+        AllocTag tag;       // тег выделений отправителя
+    };
+
+    struct alignas(64) Worker {
+        InstrumentedMutex mutex{LockId::JobQueue};
+        std::deque<Task> tasks;
+        std::atomic<std::uint64_t> jobs{0};
+        std::atomic<std::uint64_t> steals{0};
+        std::atomic<std::uint64_t> busyNanos{0};
+    };
+
+    size_t currentWorker() const;
+    void recordInline(std::chrono::steady_clock::duration elapsed);
+    bool tryRunOne(size_t self);
+    void workerLoop(size_t index);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> queued{0};
+    std::atomic<size_t> nextVictim{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleepMutex;
+    std::condition_variable sleepCV;
+    std::chrono::steady_clock::time_point statsStart;
+};
+
+template <typename F>
+void JobSystem::parallelFor(size_t count, size_t grain, F&& f) {
+    if (count == 0) return;
+    grain = std::max<size_t>(1, grain);
+
+    if (workers.size() == 1 || count <= grain) {
+        // Без разбиения - прямо в этом потоке, но с учетом в статистике
+        auto begin = std::chrono::steady_clock::now();
+        f(size_t(0), count);
+        recordInline(std::chrono::steady_clock::now() - begin);
+        return;
+    }
+
+    JobCounter counter;
+    for (size_t begin = 0; begin < count; begin += grain) {
+        size_t end = std::min(count, begin + grain);
+        submit([&f, begin, end]() { f(begin, end); }, counter);
+    }
+    wait(counter);
+}
+
+#endif
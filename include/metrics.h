@@ -0,0 +1,224 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Сборка без метрик: -DLABA7_METRICS=0 (CMake: -DENABLE_METRICS=OFF).
+// Тогда Metrics::enabled() - константа false и замеры вырезает компилятор
+#ifndef LABA7_METRICS
+#define LABA7_METRICS 1
+#endif
+
+enum class MetricCounter {
+    Ticks,
+    PairsChecked,
+    BattlesQueued,
+    BattlesDropped,     // контакты сверх места в очереди битв
+    BattlesResolved,    // битвы, которые действительно состоялись
+    Kills,
+    ObserverEvents,
+    COUNT
+};
+
+// Порядок фаз тика совпадает с TickReport::Phase
+enum class MetricHistogram {
+    TickTotal,
+    TickMove,
+    TickBroadPhase,
+    TickBattle,
+    TickStats,
+    TickPublish,
+    BattleQueueDepth,   // глубина очереди битв после постановки битв тика
+    ObserverDispatch,
+    COUNT
+};
+
+enum class LockId {
+    Print,      // GameManager::printMutex
+    JobQueue,   // очереди заданий JobSystem
+    COUNT
+};
+
+constexpr size_t METRIC_COUNTER_COUNT = static_cast<size_t>(MetricCounter::COUNT);
+constexpr size_t METRIC_HISTOGRAM_COUNT = static_cast<size_t>(MetricHistogram::COUNT);
+constexpr size_t LOCK_ID_COUNT = static_cast<size_t>(LockId::COUNT);
+
+// Гистограмма в духе HDR: логарифмические интервалы, каждый поделен на
+// SUB_BUCKETS линейных частей. Относительная ошибка значения - до 1/16,
+// диапазон - весь uint64 при фиксированных 976 ячейках
+class Histogram {
+public:
+    static constexpr unsigned SUB_BITS = 4;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    static size_t bucketOf(std::uint64_t value);
+    // Границы значений ячейки, обе включительно
+    static std::uint64_t bucketLow(size_t bucket);
+    static std::uint64_t bucketHigh(size_t bucket);
+
+    void record(std::uint64_t value, std::uint64_t times = 1);
+    void merge(const Histogram& other);
+    void clear() { *this = Histogram(); }
+
+    std::uint64_t count() const { return total; }
+    std::uint64_t sum() const { return valueSum; }
+    std::uint64_t min() const { return total ? minValue : 0; }
+    std::uint64_t max() const { return maxValue; }
+    double mean() const { return total ? static_cast<double>(valueSum) / total : 0.0; }
+    // Верхняя граница ячейки с q-квантилем (0..1), не больше max()
+    std::uint64_t percentile(double q) const;
+    std::uint64_t bucket(size_t index) const { return buckets[index]; }
+
+private:
+    friend struct AtomicHistogram;
+
+    std::array<std::uint64_t, BUCKET_COUNT> buckets{};
+    std::uint64_t total = 0;
+    std::uint64_t valueSum = 0;
+    std::uint64_t minValue = ~std::uint64_t(0);
+    std::uint64_t maxValue = 0;
+};
+
+// Сводка всех метрик на момент Metrics::snapshot()
+struct MetricsSnapshot {
+    struct Lock {
+        std::uint64_t acquisitions = 0;
+        std::uint64_t contended = 0;    // захваты, которым пришлось ждать
+        Histogram wait;                 // ожидание захвата, нс
+        Histogram hold;                 // удержание, нс
+    };
+
+    bool enabled = false;
+    std::array<std::uint64_t, METRIC_COUNTER_COUNT> counters{};
+    std::array<Histogram, METRIC_HISTOGRAM_COUNT> histograms;
+    std::array<Lock, LOCK_ID_COUNT> locks;
+
+    std::uint64_t counter(MetricCounter c) const { return counters[static_cast<size_t>(c)]; }
+    const Histogram& histogram(MetricHistogram h) const { return histograms[static_cast<size_t>(h)]; }
+    const Lock& lock(LockId id) const { return locks[static_cast<size_t>(id)]; }
+};
+
+// Метрики горячих путей. Каждый поток пишет в свои счетчики и гистограммы
+// (без общих кэш-линий и блокировок); snapshot() сливает данные всех
+// потоков, включая завершившиеся. Выключенные метрики стоят одной
+// relaxed-загрузки флага на замер
+class Metrics {
+public:
+    static constexpr bool COMPILED = LABA7_METRICS != 0;
+
+    static bool enabled() {
+        if constexpr (!COMPILED) return false;
+        return enabledFlag.load(std::memory_order_relaxed);
+    }
+    static void setEnabled(bool on) { enabledFlag.store(COMPILED && on, std::memory_order_relaxed); }
+
+    // Замеры; вызывать после проверки enabled()
+    static void add(MetricCounter counter, std::uint64_t value = 1);
+    static void record(MetricHistogram histogram, std::uint64_t value);
+    static void recordLock(LockId id, std::uint64_t waitNanos, std::uint64_t holdNanos, bool contended);
+
+    static MetricsSnapshot snapshot();
+    // Обнуляет данные всех потоков
+    static void reset();
+
+    static std::string toJson(const MetricsSnapshot& snapshot);
+    // Текстовый формат Prometheus: времена в секундах, гистограммы -
+    // накопительные ячейки le по непустым ячейкам
+    static std::string toPrometheus(const MetricsSnapshot& snapshot);
+    // Пишет снимок в файл: *.json - JSON, иначе формат Prometheus
+    static bool dump(const std::string& path);
+
+private:
+    static inline std::atomic<bool> enabledFlag{false};
+};
+
+// Время жизни области в гистограмму, нс
+class ScopedTimer {
+public:
+    explicit ScopedTimer(MetricHistogram histogram)
+        : histogram(histogram), active(Metrics::enabled()) {
+        if (active) begin = std::chrono::steady_clock::now();
+    }
+    ~ScopedTimer() {
+        if (!active) return;
+        auto elapsed = std::chrono::steady_clock::now() - begin;
+        Metrics::record(histogram, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    MetricHistogram histogram;
+    bool active;
+    std::chrono::steady_clock::time_point begin;
+};
+
+// std::mutex с учетом ожидания и удержания. Без метрик - только проверка
+// флага; с метриками ожидание замеряется лишь при неудачном try_lock
+class InstrumentedMutex {
+public:
+    explicit InstrumentedMutex(LockId id) : id(id) {}
+
+    InstrumentedMutex(const InstrumentedMutex&) = delete;
+    InstrumentedMutex& operator=(const InstrumentedMutex&) = delete;
+
+    void lock() {
+        if (!Metrics::enabled()) {
+            mutex.lock();
+            timed = false;
+            return;
+        }
+        bool contended = !mutex.try_lock();
+        std::uint64_t wait = 0;
+        if (contended) {
+            auto begin = std::chrono::steady_clock::now();
+            mutex.lock();
+            acquiredAt = std::chrono::steady_clock::now();
+            wait = std::chrono::duration_cast<std::chrono::nanoseconds>(acquiredAt - begin).count();
+        } else {
+            acquiredAt = std::chrono::steady_clock::now();
+        }
+        timed = true;
+        waitNanos = wait;
+        wasContended = contended;
+    }
+
+    bool try_lock() {
+        if (!mutex.try_lock()) return false;
+        timed = Metrics::enabled();
+        if (timed) {
+            acquiredAt = std::chrono::steady_clock::now();
+            waitNanos = 0;
+            wasContended = false;
+        }
+        return true;
+    }
+
+    void unlock() {
+        if (timed) {
+            auto hold = std::chrono::steady_clock::now() - acquiredAt;
+            Metrics::recordLock(id, waitNanos,
+                                std::chrono::duration_cast<std::chrono::nanoseconds>(hold).count(),
+                                wasContended);
+        }
+        mutex.unlock();
+    }
+
+private:
+    std::mutex mutex;
+    LockId id;
+    // Поля ниже принадлежат текущему владельцу
+    bool timed = false;
+    bool wasContended = false;
+    std::uint64_t waitNanos = 0;
+    std::chrono::steady_clock::time_point acquiredAt;
+};
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef NPC_STORE_H
+#define NPC_STORE_H
+
+#include "npcs.h"
+#include "entity_handle.h"
+#include "atomic_column.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+class NPCView;
+
+// Хранилище NPC в виде структуры массивов: горячие циклы (перемещение,
+// проверка дистанции, выборка живых) идут по непрерывным колонкам без
+// разыменования указателя на каждый NPC
+class NPCStore {
+public:
+    using Index = std::uint32_t;
+
+    // Новый NPC занимает освобожденный слот, если он есть
+    Index add(NPCType type, const std::string& name, float x, float y);
+    Index add(const NPC& npc);
+    Index add(const NPCVariant& npc) { return add(asNPC(npc)); }
+    void clear();
+    // Удаляет мертвых NPC, сохраняя порядок живых. Перемещенные NPC получают
+    // новые дескрипторы, старые дескрипторы на них становятся устаревшими
+    void removeDead();
+
+    // Освобождает слот: NPC считается мертвым, дескрипторы на него устаревают,
+    // а сам слот уходит в список свободных
+    void release(Index i);
+    // Освобождает все слоты с мертвыми NPC; возвращает их количество
+    size_t releaseDead();
+
+    // Дескрипторы. resolve() работает за O(1) и отвергает устаревшие дескрипторы
+    EntityHandle handleOf(Index i) const {
+        return {i, generations.load(i)};
+    }
+    std::optional<Index> resolve(EntityHandle handle) const {
+        if (handle.index >= xs.size() ||
+            generations.load(handle.index) != handle.generation) {
+            return std::nullopt;
+        }
+        return handle.index;
+    }
+    bool isValid(EntityHandle handle) const { return resolve(handle).has_value(); }
+
+    // Число слотов (включая освобожденные) - верхняя граница индексов
+    size_t size() const { return xs.size(); }
+    bool empty() const { return xs.empty(); }
+    size_t aliveCount() const;
+    size_t freeSlotCount() const { return freeSlots.size(); }
+    bool isUsed(Index i) const { return used[i] != 0; }
+
+    float getX(Index i) const { return xs[i]; }
+    float getY(Index i) const { return ys[i]; }
+    NPCType getType(Index i) const { return types[i]; }
+    const NPCTraits& getTraits(Index i) const { return traitsOf(types[i]); }
+    const std::string& getName(Index i) const { return names[nameIndices[i]]; }
+    // Меняется при каждом изменении имен или их расположения по слотам
+    std::uint64_t getNameVersion() const { return nameVersion; }
+    bool isAlive(Index i) const { return alive.load(i) != 0; }
+    void kill(Index i) { alive.store(i, 0); }
+    // Атомарный переход "жив -> мертв": true только у того, кто убил первым
+    bool tryKill(Index i) {
+        std::uint8_t expected = 1;
+        return alive.compareExchange(i, expected, 0);
+    }
+
+    void move(Index i, int dx, int dy, int maxX, int maxY);
+    // Пакетное перемещение всех NPC: dirX/dirY - направления (-1, 0, 1)
+    // для каждого индекса; мертвые NPC остаются на месте
+    void moveAll(const float* dirX, const float* dirY, int maxX, int maxY);
+    // То же для индексов [begin, end); разные диапазоны можно двигать параллельно
+    void moveRange(Index begin, Index end, const float* dirX, const float* dirY,
+                   int maxX, int maxY);
+    // То же для произвольного набора индексов ids[0..count); dirX[k], dirY[k] -
+    // направления для ids[k]. Координаты собираются в плотный буфер и
+    // двигаются тем же пакетным ядром
+    void moveIndices(const Index* ids, size_t count, const float* dirX, const float* dirY,
+                     int maxX, int maxY);
+    bool canAttack(Index attacker, Index defender) const {
+        return canKill(types[attacker], types[defender]);
+    }
+
+    // Прямой доступ к колонкам для горячих циклов
+    const float* xData() const { return xs.data(); }
+    const float* yData() const { return ys.data(); }
+    const NPCType* typeData() const { return types.data(); }
+
+    NPCView view(Index i);
+
+private:
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<NPCType> types;
+    // Флаг жизни меняют параллельные обработчики битв, поэтому он атомарный
+    AtomicColumn<std::uint8_t> alive;
+    std::vector<std::uint32_t> nameIndices;
+    std::vector<std::string> names;
+    std::vector<std::uint8_t> used;         // слот занят (не в freeSlots)
+    // Поколения слотов; читаются потоком битв, поэтому атомарные.
+    // Колонка не укорачивается, чтобы поколение слота не сбрасывалось
+    AtomicColumn<std::uint32_t> generations;
+    std::vector<Index> freeSlots;
+    std::uint64_t nameVersion = 0;
+};
+
+// Тонкая обертка над индексом в NPCStore с API класса NPC
+class NPCView {
+public:
+    NPCView(NPCStore& store, NPCStore::Index index) : store(&store), index(index) {}
+
+    NPCStore::Index getIndex() const { return index; }
+    EntityHandle getHandle() const { return store->handleOf(index); }
+
+    std::string getType() const { return store->getTraits(index).name; }
+    NPCType getTypeId() const { return store->getType(index); }
+    std::string getName() const { return store->getName(index); }
+    float getX() const { return store->getX(index); }
+    float getY() const { return store->getY(index); }
+    std::pair<int, int> getPosition() const;
+
+    float distanceTo(const NPCView& other) const;
+    bool isInRange(const NPCView& other, float range) const;
+
+    bool canAttack(const NPCView& other) const { return store->canAttack(index, other.index); }
+    bool canBeAttackedBy(const NPCView& other) const { return store->canAttack(other.index, index); }
+    bool isAlive() const { return store->isAlive(index); }
+    void die() { store->kill(index); }
+    int getMoveDistance() const { return store->getTraits(index).moveDistance; }
+    int getKillDistance() const { return store->getTraits(index).killDistance; }
+    char getSymbol() const { return store->getTraits(index).symbol; }
+
+    void move(int dx, int dy, int maxX, int maxY) { store->move(index, dx, dy, maxX, maxY); }
+
+    bool operator==(const NPCView& other) const {
+        return store == other.store && index == other.index;
+    }
+
+private:
+    NPCStore* store;
+    NPCStore::Index index;
+};
+
+inline NPCView NPCStore::view(Index i) {
+    return NPCView(*this, i);
+}
+
+#endif
@@ -1,11 +1,69 @@
 #ifndef NPCS_H
 #define NPCS_H
 
+#include "type_list.h"
+#include <array>
 #include <string>
 #include <memory>
+#include <utility>
+#include <variant>
 #include <vector>
+#include <cstddef>
+#include <cstdint>
 
-class NPCVisitor;
+class Orc;
+class Knight;
+class Bear;
+
+// Список всех типов NPC. Чтобы добавить новое существо, достаточно описать
+// его класс (TYPE и TRAITS), добавить значение в NPCType и тип в этот список:
+// фабрика, visitor, variant и таблица убийств строятся по нему автоматически
+using NPCTypeList = TypeList<Orc, Knight, Bear>;
+
+// Компактный тег типа NPC (совпадает с позицией в NPCTypeList)
+enum class NPCType : std::uint8_t {
+    Orc = 0,
+    Knight = 1,
+    Bear = 2
+};
+
+constexpr std::size_t NPC_TYPE_COUNT = NPCTypeList::size;
+
+constexpr std::size_t typeIndex(NPCType type) {
+    return static_cast<std::size_t>(type);
+}
+
+constexpr std::uint32_t typeBit(NPCType type) {
+    return std::uint32_t(1) << typeIndex(type);
+}
+
+// Параметры, общие для всех NPC одного типа
+struct NPCTraits {
+    const char* name;
+    int moveDistance;
+    int killDistance;
+    char symbol;
+    std::uint32_t preyMask;    // биты типов, которых этот тип убивает
+};
+
+// Интерфейс Visitor: по методу visit(T&) на каждый тип из NPCTypeList
+template <typename T>
+class NPCVisitorFor {
+public:
+    virtual ~NPCVisitorFor() = default;
+    virtual void visit(T& npc) = 0;
+};
+
+template <typename List>
+class NPCVisitorOf;
+
+template <typename... Ts>
+class NPCVisitorOf<TypeList<Ts...>> : public NPCVisitorFor<Ts>... {
+public:
+    using NPCVisitorFor<Ts>::visit...;
+};
+
+class NPCVisitor : public NPCVisitorOf<NPCTypeList> {};
 
 // Базовый класс для всех NPC
 class NPC {
@@ -13,73 +71,164 @@ protected:
     std::string name;
     float x, y;
     bool alive;          // статус жизни
-    int moveDistance;    // дистанция перемещения
-    int killDistance;    // дистанция убийства
-    char symbol;         // символ для карты
+    NPCType type;        // тег типа, параметры берутся из NPC_TRAITS
 
 public:
-    NPC(const std::string& name, float x, float y, 
-        int moveDist, int killDist, char sym);
+    NPC(const std::string& name, float x, float y, NPCType type);
     virtual ~NPC() = default;
-    
-    virtual std::string getType() const = 0;
+
+    std::string getType() const;
+    NPCType getTypeId() const { return type; }
     virtual void accept(NPCVisitor& visitor) = 0;
-    
+
     std::string getName() const;
     float getX() const;
     float getY() const;
-    
+
     float distanceTo(const NPC& other) const;
     bool isInRange(const NPC& other, float range) const;
-    
-    virtual bool canAttack(const NPC& other) const = 0;
-    virtual bool canBeAttackedBy(const NPC& other) const = 0;
+
+    bool canAttack(const NPC& other) const;
+    bool canBeAttackedBy(const NPC& other) const;
     bool isAlive() const { return alive; }
     void die() { alive = false; }
-    int getMoveDistance() const { return moveDistance; }
-    int getKillDistance() const { return killDistance; }
-    char getSymbol() const { return symbol; }
-    
+    int getMoveDistance() const;
+    int getKillDistance() const;
+    char getSymbol() const;
+
     // Методы для перемещения
     void move(int dx, int dy, int maxX, int maxY);
     std::pair<int, int> getPosition() const;
 };
 
-// Конкретные классы NPC
-class Orc : public NPC {
+// Общая часть конкретных NPC: тег типа и accept() для Visitor
+template <typename Derived>
+class NPCOf : public NPC {
 public:
-    Orc(const std::string& name, float x, float y);
-    std::string getType() const override;
-    void accept(NPCVisitor& visitor) override;
-    bool canAttack(const NPC& other) const override;
-    bool canBeAttackedBy(const NPC& other) const override;
+    NPCOf(const std::string& name, float x, float y) : NPC(name, x, y, Derived::TYPE) {}
+
+    void accept(NPCVisitor& visitor) override {
+        visitor.visit(static_cast<Derived&>(*this));
+    }
 };
 
-class Knight : public NPC {
+// Конкретные классы NPC
+class Orc : public NPCOf<Orc> {
 public:
-    Knight(const std::string& name, float x, float y);
-    std::string getType() const override;
-    void accept(NPCVisitor& visitor) override;
-    bool canAttack(const NPC& other) const override;
-    bool canBeAttackedBy(const NPC& other) const override;
+    static constexpr NPCType TYPE = NPCType::Orc;
+    static constexpr NPCTraits TRAITS = {"Orc", 20, 10, 'O', typeBit(NPCType::Bear)};
+    using NPCOf::NPCOf;
 };
 
-class Bear : public NPC {
+class Knight : public NPCOf<Knight> {
 public:
-    Bear(const std::string& name, float x, float y);
-    std::string getType() const override;
-    void accept(NPCVisitor& visitor) override;
-    bool canAttack(const NPC& other) const override;
-    bool canBeAttackedBy(const NPC& other) const override;
+    static constexpr NPCType TYPE = NPCType::Knight;
+    static constexpr NPCTraits TRAITS = {"Knight", 30, 10, 'K', typeBit(NPCType::Orc)};
+    using NPCOf::NPCOf;
 };
 
-// Visitor для обработки NPC
-class NPCVisitor {
+class Bear : public NPCOf<Bear> {
 public:
-    virtual ~NPCVisitor() = default;
-    virtual void visit(Orc& orc) = 0;
-    virtual void visit(Knight& knight) = 0;
-    virtual void visit(Bear& bear) = 0;
+    static constexpr NPCType TYPE = NPCType::Bear;
+    static constexpr NPCTraits TRAITS = {"Bear", 5, 10, 'B', typeBit(NPCType::Knight)};
+    using NPCOf::NPCOf;
+};
+
+// ---- Таблицы, построенные по NPCTypeList ----
+
+using NPCDispatcher = TypeDispatcher<NPCTypeList>;
+
+// NPC по значению: для хранения в непрерывном контейнере без кучи
+using NPCVariant = NPCTypeList::apply<std::variant>;
+
+template <typename List>
+struct NPCTables;
+
+template <typename... Ts>
+struct NPCTables<TypeList<Ts...>> {
+    static_assert(((typeIndex(Ts::TYPE) == IndexOf<Ts, NPCTypeList>::value) && ...),
+                  "NPCType values must match positions in NPCTypeList");
+
+    static constexpr std::array<NPCTraits, sizeof...(Ts)> traits = {Ts::TRAITS...};
+
+    static constexpr std::array<std::array<bool, sizeof...(Ts)>, sizeof...(Ts)> killMatrix() {
+        std::array<std::array<bool, sizeof...(Ts)>, sizeof...(Ts)> matrix{};
+        for (std::size_t a = 0; a < sizeof...(Ts); ++a) {
+            for (std::size_t d = 0; d < sizeof...(Ts); ++d) {
+                matrix[a][d] = (traits[a].preyMask >> d) & 1u;
+            }
+        }
+        return matrix;
+    }
 };
 
+constexpr auto NPC_TRAITS = NPCTables<NPCTypeList>::traits;
+
+// Таблица совместимости: KILL_MATRIX[атакующий][защищающийся]
+constexpr auto KILL_MATRIX = NPCTables<NPCTypeList>::killMatrix();
+
+constexpr bool canKill(NPCType attacker, NPCType defender) {
+    return KILL_MATRIX[typeIndex(attacker)][typeIndex(defender)];
+}
+
+// Маска типов, с которыми тип может сражаться (в любую сторону)
+constexpr std::uint32_t hostileMask(NPCType type) {
+    std::uint32_t mask = 0;
+    for (std::size_t other = 0; other < NPC_TYPE_COUNT; ++other) {
+        if (KILL_MATRIX[typeIndex(type)][other] || KILL_MATRIX[other][typeIndex(type)]) {
+            mask |= std::uint32_t(1) << other;
+        }
+    }
+    return mask;
+}
+
+constexpr const NPCTraits& traitsOf(NPCType type) {
+    return NPC_TRAITS[typeIndex(type)];
+}
+
+// То же для типов, известных при компиляции
+template <typename Attacker, typename Defender>
+constexpr bool KILLS = canKill(Attacker::TYPE, Defender::TYPE);
+
+static_assert(KILLS<Orc, Bear>, "Orcs kill bears");
+static_assert(KILLS<Bear, Knight>, "Bears kill knights");
+static_assert(KILLS<Knight, Orc>, "Knights kill orcs");
+static_assert(!KILLS<Orc, Orc>, "Same types do not fight");
+
+// Вызывает f(TypeTag<T>{}) для конкретного класса, соответствующего тегу
+template <typename F>
+decltype(auto) visitNPCType(NPCType type, F&& f) {
+    return NPCDispatcher::dispatch(typeIndex(type), std::forward<F>(f));
+}
+
+inline NPCType typeOf(const NPCVariant& npc) {
+    return static_cast<NPCType>(npc.index());
+}
+
+inline const NPC& asNPC(const NPCVariant& npc) {
+    return std::visit([](const auto& value) -> const NPC& { return value; }, npc);
+}
+
+inline NPC& asNPC(NPCVariant& npc) {
+    return std::visit([](auto& value) -> NPC& { return value; }, npc);
+}
+
+// Проверка атаки для NPC по значению: двойная диспетчеризация через
+// std::visit, результат для каждой пары типов - константа времени компиляции
+inline bool canAttack(const NPCVariant& attacker, const NPCVariant& defender) {
+    return std::visit([](const auto& a, const auto& d) {
+        return KILLS<std::decay_t<decltype(a)>, std::decay_t<decltype(d)>>;
+    }, attacker, defender);
+}
+
+// Разбор имени типа ("Orc", "Knight", "Bear"); false для неизвестного типа
+bool parseNPCType(const std::string& name, NPCType& type);
+
+inline std::string NPC::getType() const { return traitsOf(type).name; }
+inline bool NPC::canAttack(const NPC& other) const { return canKill(type, other.type); }
+inline bool NPC::canBeAttackedBy(const NPC& other) const { return canKill(other.type, type); }
+inline int NPC::getMoveDistance() const { return traitsOf(type).moveDistance; }
+inline int NPC::getKillDistance() const { return traitsOf(type).killDistance; }
+inline char NPC::getSymbol() const { return traitsOf(type).symbol; }
+
 #endif
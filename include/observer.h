@@ -1,41 +1,351 @@
 #ifndef OBSERVER_H
 #define OBSERVER_H
 
+#include "entity_handle.h"
+#include "battle_event.h"
+#include "subscription_index.h"
+#include "bounded_queue.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
 #include <memory>
+#include <thread>
+#include <unordered_map>
 #include <vector>  
 
 // Интерфейс Observer
 class BattleObserver {
 public:
     virtual ~BattleObserver() = default;
-    virtual void onBattleResult(const std::string& result) = 0;
+    virtual void onBattleResult(const std::string& /*result*/) {}
+    
+    // Результат боя вместе с дескрипторами участников. По умолчанию
+    // передает только текст, чтобы старые наблюдатели работали как раньше
+    virtual void onBattle(EntityHandle /*attacker*/, EntityHandle /*defender*/,
+                          const std::string& result) {
+        onBattleResult(result);
+    }
+    
+    // Структурное событие битвы. По умолчанию собирает текст и передает
+    // его в onBattle: строковые наблюдатели работают без изменений, а
+    // наблюдатель, которому текст не нужен, переопределяет только этот метод
+    virtual void onBattleEvent(const BattleEvent& event, const NameTable& names) {
+        onBattle(event.attacker, event.defender, formatBattleEvent(event, names));
+    }
+};
+
+// Когда FileLogger вызывает fsync
+enum class SyncPolicy {
+    None,           // данные остаются в кэше ОС
+    Periodic,       // не реже раза в syncInterval
+    EveryBatch      // после каждой записи в файл
+};
+
+struct FileLoggerOptions {
+    size_t capacity = 4096;                             // строк в кольце
+    size_t batchBytes = 64 * 1024;                      // запись в файл, когда набралось столько
+    std::chrono::milliseconds flushInterval{100};       // и не позже, чем через столько
+    SyncPolicy sync = SyncPolicy::None;
+    std::chrono::milliseconds syncInterval{1000};       // для SyncPolicy::Periodic
+};
+
+struct FileLoggerStats {
+    std::uint64_t logged = 0;       // строк принято в кольцо
+    std::uint64_t dropped = 0;      // строк потеряно: кольцо полно или файл не открыт
+    std::uint64_t truncated = 0;    // строк обрезано до MAX_LINE
+    std::uint64_t writes = 0;       // вызовов write
+    std::uint64_t bytesWritten = 0;
+    std::uint64_t syncs = 0;
 };
 
 // Конкретные 
+// Лог в файл без блокировок на стороне битвы: строка или событие
+// копируется в lock-free кольцо, а отдельный поток держит файл открытым,
+// собирает текст событий и пишет накопленное крупными блоками (group
+// commit). Файл и поток появляются при первой записи: логгер без событий
+// не создает файл. При переполнении кольца запись отбрасывается и
+// учитывается в stats().dropped
 class FileLogger : public BattleObserver {
+public:
+    static constexpr size_t MAX_LINE = 254;
+
+    FileLogger(const std::string& filename = "log.txt", const FileLoggerOptions& options = {});
+    // Дописывает все принятые строки и закрывает файл
+    ~FileLogger() override;
+
+    FileLogger(const FileLogger&) = delete;
+    FileLogger& operator=(const FileLogger&) = delete;
+
+    void onBattleResult(const std::string& result) override;
+    // Текст события собирает поток записи; names должна пережить логгер
+    void onBattleEvent(const BattleEvent& event, const NameTable& names) override;
+    // Ждет, пока строки, принятые до вызова, попадут в файл
+    // (и на диск, если политика не SyncPolicy::None)
+    void flush();
+
+    // Файл открыт первой записью; до нее false
+    bool isOpen() const { return fd.load(std::memory_order_acquire) >= 0; }
+    FileLoggerStats stats() const;
+
 private:
+    // Запись кольца: готовая строка (names == nullptr) или событие
+    struct Line {
+        const NameTable* names;
+        BattleEvent event;
+        std::uint16_t length;
+        char text[MAX_LINE];
+    };
+
+    void push(const Line& line);
+    // Открывает файл и запускает поток записи; один раз, из первого push
+    void open();
+    void writerLoop();
+    void writeOut(std::string& buffer);
+    void sync();
+
     std::string filename;
+    FileLoggerOptions options;
+    std::atomic<int> fd{-1};
+    BoundedQueue<Line> ring;
+    size_t wakeThreshold;
 
-public:
-    FileLogger(const std::string& filename = "log.txt");
-    void onBattleResult(const std::string& result) override;
+    std::once_flag openOnce;
+    std::thread writer;
+    std::atomic<bool> started{false};       // writer запущен
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> writerSleeping{false};
+    std::atomic<std::uint64_t> flushRequested{0};
+    std::atomic<std::uint64_t> flushDone{0};
+    std::mutex wakeMutex;
+    std::condition_variable wakeCV;     // будит поток записи
+    std::condition_variable flushCV;    // сообщает о выполненном flush()
+
+    std::atomic<std::uint64_t> logged{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<std::uint64_t> truncated{0};
+    std::atomic<std::uint64_t> writes{0};
+    std::atomic<std::uint64_t> bytesWritten{0};
+    std::atomic<std::uint64_t> syncs{0};
+    bool unsynced = false;              // только поток записи
+};
+
+// Как ConsoleLogger выводит битвы
+enum class ConsoleMode {
+    Verbose,        // строка на событие, с выборкой и ограничением частоты
+    Summary         // сводка за интервал: убийства по парам типов, защиты, лучшие бойцы
+};
+
+struct ConsoleLoggerOptions {
+    ConsoleMode mode = ConsoleMode::Verbose;
+    std::uint32_t sampleEvery = 1;          // Verbose: печатать каждое N-е событие
+    std::uint32_t maxLinesPerSecond = 0;    // Verbose: 0 - без ограничения
+    std::chrono::milliseconds summaryInterval{1000};
+    size_t topKillers = 3;
+};
+
+struct ConsoleLoggerStats {
+    std::uint64_t events = 0;
+    std::uint64_t printed = 0;      // строк событий
+    std::uint64_t sampledOut = 0;   // пропущено выборкой
+    std::uint64_t rateLimited = 0;  // пропущено сверх maxLinesPerSecond
+    std::uint64_t summaries = 0;
 };
 
+// Вывод битв в консоль. Окна (секунда для ограничения частоты, интервал
+// сводки) закрываются с приходом следующего события или в flush(); при
+// закрытии печатается сводка или число пропущенных строк
 class ConsoleLogger : public BattleObserver {
 public:
+    explicit ConsoleLogger(const ConsoleLoggerOptions& options = {}, std::ostream& out = std::cout);
+
     void onBattleResult(const std::string& result) override;
+    void onBattleEvent(const BattleEvent& event, const NameTable& names) override;
+    // Печатает незакрытое окно: сводку или число пропущенных строк
+    void flush();
+    ConsoleLoggerStats stats() const;
+
+protected:
+    // Вывод готового текста (строки с переводами строк)
+    virtual void write(const std::string& text);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Killer {
+        NPCType type;
+        std::uint32_t kills;
+    };
+
+    // Вызываются под mutex
+    void rollWindow(Clock::time_point now, std::string& text);
+    void closeWindow(Clock::time_point now, std::string& text);
+    bool admitLine();
+    void countKill(NPCType killer, EntityHandle handle, NPCType victim);
+
+    ConsoleLoggerOptions options;
+    std::ostream& out;
+    mutable std::mutex mutex;
+    const NameTable* names = nullptr;   // для имен в сводке
+    ConsoleLoggerStats totals;
+
+    Clock::time_point windowStart;
+    std::uint64_t sampleCounter = 0;
+    std::uint32_t windowLines = 0;
+    std::uint64_t windowSuppressed = 0;
+    std::uint64_t windowFought = 0;
+    std::uint64_t windowDefended = 0;
+    std::uint64_t windowMessages = 0;   // текстовые уведомления без типов
+    std::uint32_t pairKills[NPC_TYPE_COUNT][NPC_TYPE_COUNT] = {};
+    std::unordered_map<std::uint64_t, Killer> killers;     // по дескриптору
+};
+
+// Что делать, если очередь исполнителя уведомлений полна
+enum class NotifyBackpressure {
+    Block,          // ждать места: битва стоит, пока наблюдатели не догонят
+    DropNewest,     // отбросить новое событие
+    DropOldest      // вытеснить самое старое событие очереди
+};
+
+struct NotifierOptions {
+    size_t executors = 1;           // потоков доставки, наблюдатели делятся между ними
+    size_t capacity = 4096;         // событий в очереди каждого потока
+    NotifyBackpressure backpressure = NotifyBackpressure::Block;
+};
+
+struct NotifierStats {
+    std::uint64_t queued = 0;       // принято в очереди исполнителей
+    std::uint64_t delivered = 0;    // разослано наблюдателям
+    std::uint64_t dropped = 0;
+    size_t maxDepth = 0;
 };
 
 // Subject для управления 
+// Наблюдатели подписываются с фильтром (BattleFilter), подписки
+// индексируются. По умолчанию рассылает синхронно. После startAsync()
+// notifyObservers только копирует событие в ограниченные очереди
+// потоков-исполнителей. Каждая подписка закреплена за одним исполнителем,
+// поэтому видит события каждого производителя в порядке отправки.
+// Исполнитель рассылает по снимку своих подписок без блокировок: подписка
+// и отписка публикуют новый снимок и не ждут наблюдателей, а пачка,
+// начатая по старому снимку, еще может дойти до снятого наблюдателя.
+// Подписываться и отписываться из самого наблюдателя нельзя
 class BattleNotifier {
 private:
-    std::vector<std::shared_ptr<BattleObserver>> observers;
+    // Событие в очереди исполнителя; text - для строковых уведомлений
+    struct Message {
+        bool structured = true;
+        BattleEvent event;
+        std::string text;
+    };
+    
+    // Снимок подписок исполнителя; держит их, пока по нему идет рассылка
+    struct Targets {
+        SubscriptionIndex index;
+        std::vector<std::shared_ptr<Subscription>> subscriptions;
+    };
+    
+    struct Executor {
+        explicit Executor(size_t capacity) : queue(capacity) {}
+        
+        BoundedQueue<Message> queue;
+        std::mutex targetsMutex;
+        std::shared_ptr<const Targets> targets;     // под targetsMutex
+        // Под targetsMutex: события, разосланные по снимкам, и события
+        // пачки, которая сейчас рассылается по текущему снимку
+        std::uint64_t processed = 0;
+        std::uint64_t inflight = 0;
+        std::atomic<size_t> subscriptionCount{0};
+        std::thread thread;
+        std::atomic<bool> sleeping{false};
+        std::atomic<std::uint64_t> accepted{0};     // принято в очередь
+        std::atomic<std::uint64_t> retired{0};      // разослано или вытеснено
+        std::atomic<std::uint64_t> delivered{0};
+        std::atomic<size_t> maxDepth{0};
+        std::atomic<int> flushWaiters{0};
+        std::mutex mutex;
+        std::condition_variable wakeCV;     // будит исполнителя
+        std::condition_variable doneCV;     // сообщает flush() о продвижении
+    };
+    
+    std::vector<std::shared_ptr<Subscription>> subscriptions;
+    SubscriptionIndex index;                        // для синхронной рассылки
+    SubscriptionId nextId = 1;
+    std::atomic<std::uint64_t> events{0};           // структурных событий отправлено
+    const NameTable* names = nullptr;
+    
+    NotifierOptions options;
+    std::vector<std::unique_ptr<Executor>> executors;
+    mutable std::shared_mutex observersMutex;
+    size_t nextExecutor = 0;
+    std::atomic<bool> stopping{false};
+    std::atomic<std::uint64_t> dropped{0};
+    // Итоги исполнителей, остановленных stopAsync()
+    std::uint64_t retiredQueued = 0;
+    std::uint64_t retiredDelivered = 0;
+    size_t retiredMaxDepth = 0;
+    
+    void enqueue(const Message& message);
+    void push(Executor& executor, const Message& message);
+    void wake(Executor& executor);
+    void executorLoop(Executor& executor);
+    // Закрепляет подписку за исполнителем и публикует его новый снимок
+    void assign(const std::shared_ptr<Subscription>& subscription);
+    // Новый снимок; подписка added начинает счет отсеянных с этого момента
+    void publish(Executor& executor, std::shared_ptr<Targets> targets, Subscription* added = nullptr);
+    // Отсеяно для подписки с учетом ее рассыльщика; под observersMutex
+    std::uint64_t filteredOf(const Subscription& subscription) const;
+    // Переносит счет отсеянных к новому рассыльщику, у которого уже
+    // разослано processed событий (startAsync/stopAsync)
+    void rebaseFiltered(std::uint64_t processed);
+    void deliver(const Message& message, const SubscriptionIndex& targets);
 
 public:
+    BattleNotifier() = default;
+    // Доставляет остаток очередей
+    ~BattleNotifier();
+    
+    BattleNotifier(const BattleNotifier&) = delete;
+    BattleNotifier& operator=(const BattleNotifier&) = delete;
+    
+    // Подписка без фильтра
     void addObserver(std::shared_ptr<BattleObserver> observer);
+    // Снимает все подписки наблюдателя
     void removeObserver(std::shared_ptr<BattleObserver> observer);
+    
+    // Подписка с фильтром. Стоимость рассылки растет с числом подходящих
+    // подписок, а не всех. Текстовые уведомления получают только подписки
+    // без фильтра. Не вызывать из наблюдателя (как и unsubscribe,
+    // addObserver и removeObserver)
+    SubscriptionId subscribe(std::shared_ptr<BattleObserver> observer, const BattleFilter& filter = {});
+    void unsubscribe(SubscriptionId id);
+    // filtered растет, когда исполнитель разослал событие; события в
+    // очередях и отброшенные при переполнении в нем не учитываются
+    SubscriptionStats subscriptionStats(SubscriptionId id) const;
+    size_t subscriptionCount() const { return subscriptions.size(); }
+    // Имена для текста событий; без таблицы вместо имен идут "#индекс"
+    void setNames(const NameTable* table) { names = table; }
+    
+    // Переводит рассылку на исполнителей (executors == 0 - остается
+    // синхронным). Поток исполнителя запускается, когда за ним закреплена
+    // первая подписка. Не вызывать одновременно с notifyObservers
+    void startAsync(const NotifierOptions& asyncOptions = {});
+    // Доставляет остаток и возвращается к синхронной рассылке
+    void stopAsync();
+    bool isAsync() const { return !executors.empty(); }
+    // Ждет, пока события, отправленные до вызова, дойдут до наблюдателей.
+    // Не вызывать из наблюдателя
+    void flush();
+    NotifierStats stats() const;
+    
     void notifyObservers(const std::string& result);
+    void notifyObservers(const std::string& result, 
+                         EntityHandle attacker, EntityHandle defender);
+    void notifyObservers(const BattleEvent& event);
 };
 
 #endif
@@ -0,0 +1,93 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Счетчиковый генератор Philox4x32-10 (Salmon et al., "Parallel Random
+// Numbers: As Easy as 1, 2, 3"). Результат - чистая функция ключа и счетчика,
+// состояния нет: любой поток получает те же числа для того же
+// (seed, тик, сущность, назначение), поэтому итоги не зависят от числа потоков
+namespace philox {
+
+using Counter = std::array<std::uint32_t, 4>;
+using Key = std::array<std::uint32_t, 2>;
+
+constexpr std::uint32_t MULTIPLIER_0 = 0xD2511F53;
+constexpr std::uint32_t MULTIPLIER_1 = 0xCD9E8D57;
+constexpr std::uint32_t WEYL_0 = 0x9E3779B9;
+constexpr std::uint32_t WEYL_1 = 0xBB67AE85;
+constexpr int ROUNDS = 10;
+
+inline Counter philox4x32(Counter counter, Key key) {
+    for (int round = 0; round < ROUNDS; ++round) {
+        std::uint64_t product0 = std::uint64_t(MULTIPLIER_0) * counter[0];
+        std::uint64_t product1 = std::uint64_t(MULTIPLIER_1) * counter[2];
+        counter = {static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+                   static_cast<std::uint32_t>(product1),
+                   static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+                   static_cast<std::uint32_t>(product0)};
+        key[0] += WEYL_0;
+        key[1] += WEYL_1;
+    }
+    return counter;
+}
+
+// Равномерное число из [0, n) по 32-битному слову: умножение со сдвигом
+// вместо деления (смещение не больше n / 2^32)
+inline std::uint32_t below(std::uint32_t word, std::uint32_t n) {
+    return static_cast<std::uint32_t>((std::uint64_t(word) * n) >> 32);
+}
+
+}  // namespace philox
+
+// Назначения случайных величин: разные назначения дают независимые потоки чисел
+enum class RandomPurpose : std::uint32_t {
+    Direction = 1,      // направление движения NPC
+    Attacker = 2,       // кто атакует, если оба участника пары могут
+    Dice = 3,           // броски кубиков в битве
+};
+
+// Philox с ключом из seed игры; счетчик - (сущность, тик, назначение)
+class CounterRng {
+public:
+    explicit CounterRng(std::uint64_t seed)
+        : key{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)} {}
+
+    // Четыре независимых 32-битных слова для (тик, сущность, назначение)
+    philox::Counter draw(std::uint32_t tick, std::uint64_t entity, RandomPurpose purpose) const {
+        return philox::philox4x32({static_cast<std::uint32_t>(entity),
+                                   static_cast<std::uint32_t>(entity >> 32), tick,
+                                   static_cast<std::uint32_t>(purpose)},
+                                  key);
+    }
+
+    // Направления (-1, 0, 1) по обеим осям для сущностей [begin, end);
+    // элемент i пишется в dirX[i], dirY[i]. Цикл без зависимостей между
+    // итерациями, компилятор может его векторизовать
+    void fillDirections(std::uint32_t tick, size_t begin, size_t end,
+                        float* dirX, float* dirY) const {
+        for (size_t i = begin; i < end; ++i) {
+            philox::Counter words = draw(tick, i, RandomPurpose::Direction);
+            dirX[i] = static_cast<float>(static_cast<int>(philox::below(words[0], 3)) - 1);
+            dirY[i] = static_cast<float>(static_cast<int>(philox::below(words[1], 3)) - 1);
+        }
+    }
+
+    // То же для набора сущностей: направления ids[k] пишутся в dirX[k], dirY[k]
+    template <typename Id>
+    void fillDirections(std::uint32_t tick, const Id* ids, size_t count,
+                        float* dirX, float* dirY) const {
+        for (size_t k = 0; k < count; ++k) {
+            philox::Counter words = draw(tick, ids[k], RandomPurpose::Direction);
+            dirX[k] = static_cast<float>(static_cast<int>(philox::below(words[0], 3)) - 1);
+            dirY[k] = static_cast<float>(static_cast<int>(philox::below(words[1], 3)) - 1);
+        }
+    }
+
+private:
+    philox::Key key;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include "npcs.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Начальные расстановки NPC для игры и замеров производительности
+enum class ScenarioKind {
+    Uniform,        // случайные типы равномерно по карте (расстановка по умолчанию)
+    Clusters,       // плотные скопления вокруг случайных центров
+    OneCell,        // все NPC в одной клетке сетки - худший случай поиска пар
+    SingleType,     // равномерно по карте, все одного типа - битв нет
+    Balanced,       // равномерно по карте, типы поровну по кругу
+};
+
+struct NPCSpawn {
+    NPCType type;
+    float x;
+    float y;
+};
+
+class ScenarioGenerator {
+public:
+    // NPC на каждое скопление в сценарии Clusters и радиус скопления
+    static constexpr int CLUSTER_SIZE = 500;
+    static constexpr float CLUSTER_RADIUS = 25.0f;
+
+    // count NPC на карте width x height; результат зависит только от аргументов
+    static std::vector<NPCSpawn> generate(ScenarioKind kind, int count, int width, int height,
+                                          std::uint64_t seed);
+
+    static std::string name(ScenarioKind kind);
+    static std::optional<ScenarioKind> parse(const std::string& name);
+    static const std::vector<ScenarioKind>& all();
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef SHARED_SNAPSHOT_H
+#define SHARED_SNAPSHOT_H
+
+#include "npc_store.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Снимок мира в разделяемой памяти POSIX для внешних просмотрщиков.
+// Раскладка сегмента: заголовок, затем колонки xs, ys (float), types, alive
+// (uint8) по capacity элементов. Согласованность - seqlock: писатель делает
+// sequence нечетным на время записи, читатель повторяет чтение, если
+// sequence нечетный или изменился
+namespace shared_snapshot {
+
+constexpr std::uint32_t MAGIC = 0x4C374E57;    // "WN7L"
+constexpr std::uint32_t VERSION = 1;
+constexpr const char* DEFAULT_NAME = "/laba7_world";
+
+struct Header {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t capacity;         // размер колонок в слотах
+    std::uint32_t typeCount;
+    std::atomic<std::uint64_t> sequence;
+    // Поля ниже защищены sequence
+    std::uint64_t tick;
+    std::uint64_t publishNanos;     // steady_clock на момент публикации
+    std::uint32_t count;            // заполненные слоты (<= capacity)
+    std::uint32_t totalCount;       // слотов в хранилище; > count, если не поместились
+    std::uint64_t aliveCount;
+    std::uint64_t typeCounts[NPC_TYPE_COUNT];
+};
+
+size_t segmentSize(std::uint32_t capacity);
+
+}  // namespace shared_snapshot
+
+// Согласованная копия кадра на стороне читателя
+struct SnapshotFrame {
+    std::uint64_t tick = 0;
+    std::uint64_t publishNanos = 0;
+    std::uint32_t totalCount = 0;
+    std::uint64_t aliveCount = 0;
+    std::array<std::uint64_t, NPC_TYPE_COUNT> typeCounts{};
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<std::uint8_t> types;
+    std::vector<std::uint8_t> alive;
+
+    size_t size() const { return xs.size(); }
+};
+
+// Создает сегмент и публикует в него кадры; единственный писатель - поток симуляции.
+// Сегмент принадлежит одному писателю: второй писатель с тем же именем не
+// откроет его, иначе изменил бы размер под чужими отображениями и удалил
+// сегмент при выходе
+class SharedSnapshotWriter {
+public:
+    // Бросает std::runtime_error, если сегмент не удалось создать или имя
+    // уже занято (другой игрой или остатком упавшего процесса)
+    SharedSnapshotWriter(const std::string& name, std::uint32_t capacity);
+    ~SharedSnapshotWriter();
+    SharedSnapshotWriter(const SharedSnapshotWriter&) = delete;
+    SharedSnapshotWriter& operator=(const SharedSnapshotWriter&) = delete;
+
+    void publish(const NPCStore& npcs, std::uint64_t tick,
+                 const std::array<size_t, NPC_TYPE_COUNT>& typeCounts, size_t aliveCount);
+
+    const std::string& getName() const { return name; }
+    std::uint32_t getCapacity() const { return capacity; }
+    std::uint64_t getPublishes() const { return publishes; }
+
+private:
+    std::string name;
+    std::uint32_t capacity;
+    size_t size;
+    void* memory = nullptr;
+    shared_snapshot::Header* header = nullptr;
+    std::uint64_t publishes = 0;
+};
+
+// Открывает существующий сегмент только для чтения
+class SharedSnapshotReader {
+public:
+    // Бросает std::runtime_error, если сегмента нет или он другого формата
+    explicit SharedSnapshotReader(const std::string& name);
+    ~SharedSnapshotReader();
+    SharedSnapshotReader(const SharedSnapshotReader&) = delete;
+    SharedSnapshotReader& operator=(const SharedSnapshotReader&) = delete;
+
+    // Одна попытка: false, если писатель был посреди записи
+    bool tryRead(SnapshotFrame& out) const;
+    // Повторяет попытки до успеха; возвращает число неудачных попыток
+    size_t read(SnapshotFrame& out) const;
+    // Номер последнего опубликованного кадра без копирования колонок
+    std::uint64_t sequence() const;
+
+    std::uint32_t getCapacity() const { return capacity; }
+
+private:
+    std::uint32_t capacity = 0;
+    size_t size = 0;
+    void* memory = nullptr;
+    const shared_snapshot::Header* header = nullptr;
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Пакетные ядра над упакованными массивами координат.
+// Реализация выбирается при первом вызове: AVX2, SSE2 или скалярная.
+class SimdKernels {
+public:
+    enum class Level { Scalar, SSE2, AVX2 };
+
+    // Максимальный размер блока для withinRadiusMask (по биту на кандидата)
+    static constexpr std::size_t MASK_BLOCK = 64;
+
+    // Бит k выставлен, если (xs[k], ys[k]) лежит не дальше radius от (px, py).
+    // Сравнение идет по квадрату расстояния, без sqrt; count <= MASK_BLOCK
+    static std::uint64_t withinRadiusMask(float px, float py,
+                                          const float* xs, const float* ys,
+                                          std::size_t count, float radius);
+
+    // x += dirX * distance, y += dirY * distance и обрезка по границам карты
+    // так же, как в NPC::move(): [0, maxX - 1] и [0, maxY - 1]
+    static void moveBatch(float* xs, float* ys,
+                          const float* dirX, const float* dirY,
+                          const float* distance, std::size_t count,
+                          float maxX, float maxY);
+
+    // Индекс младшего выставленного бита (mask != 0)
+    static int lowestBit(std::uint64_t mask) {
+#if defined(__GNUC__)
+        return __builtin_ctzll(mask);
+#else
+        int bit = 0;
+        while (!(mask & 1)) {
+            mask >>= 1;
+            ++bit;
+        }
+        return bit;
+#endif
+    }
+
+    static Level activeLevel();
+    static Level bestSupportedLevel();
+    // Принудительный выбор реализации (для тестов и бенчмарков);
+    // уровень выше поддерживаемого процессором понижается
+    static void setLevel(Level level);
+    static const char* levelName(Level level);
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "npc_store.h"
+#include "spatial_grid.h"
+#include "chunk_map.h"
+#include "battle_queue.h"
+#include "battle_resolver.h"
+#include "job_system.h"
+#include "frame_buffer.h"
+#include "shared_snapshot.h"
+#include "philox.h"
+#include "union_find.h"
+#include "metrics.h"
+#include "alloc_tracker.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Итоги одного тика
+struct TickReport {
+    enum Phase { Move, BroadPhase, Battle, Stats, Publish, PHASE_COUNT };
+
+    std::uint32_t tick = 0;
+    size_t pairs = 0;                       // пары в радиусе убийства
+    size_t battlesQueued = 0;
+    size_t battlesDropped = 0;              // контакты, не попавшие в очередь битв
+    std::vector<BattleOutcome> outcomes;    // битвы, обработанные на этом тике
+    size_t kills = 0;
+    size_t alive = 0;
+    size_t activeChunks = 0;                // бодрствующие чанки, обработанные на тике
+    size_t sleepingChunks = 0;
+    size_t moved = 0;                       // NPC, которые двигались на тике
+    size_t islands = 0;                     // острова враждебных контактов
+    std::array<size_t, NPC_TYPE_COUNT> typeCounts{};
+    std::array<std::chrono::nanoseconds, PHASE_COUNT> phaseTime{};
+};
+
+// Один тик игры - цепочка параллельных фаз на JobSystem. Перемещение
+// обходит только бодрствующие чанки ChunkMap, поэтому стоимость тика
+// зависит от числа NPC рядом с врагами, а не от размера мира и населения.
+// Чанк без враждебных типов в себе и соседях засыпает через sleepAfter
+// тиков: его NPC стоят на месте, пары внутри него не ищутся. Пара спящего
+// с пришедшим врагом находится в тот же тик, а чанк просыпается в начале
+// следующего. Бодрствующие чанки с враждебными контактами объединяются
+// в острова (union-find).
+// Фазы: перемещение, поиск пар (broad-phase), обработка битв, статистика,
+// публикация кадра.
+// Хранилище изменяет только поток, вызывающий step(); остальные потоки
+// читают кадр, опубликованный в конце тика (getFrames().acquire()).
+// Случайность - Philox по (seed, тик, NPC, назначение), поэтому результат
+// тиков не зависит от числа потоков.
+// Очередь битв наполняет и опустошает один поток step(), поэтому в начале
+// тика она пуста и ждать потребителя некому. Ограничение емкости
+// применяется при сборе битв: если контактов больше свободного места,
+// остается равномерная выборка по хешу (тик, пара), а не битвы первых
+// частей сетки. Выборка не зависит от числа потоков, отброшенные
+// контакты - в TickReport::battlesDropped. Часть сетки держит не больше
+// емкости очереди кандидатов
+class Simulation {
+public:
+    Simulation(NPCStore& npcs, JobSystem& jobs, std::uint64_t seed,
+               int mapWidth, int mapHeight, float killDistance);
+
+    // Заново заполняет сетку по хранилищу (после изменения NPC извне)
+    // и публикует кадр с текущим состоянием
+    void reset();
+    // Выполняет один тик; отчет действителен до следующего вызова
+    const TickReport& step();
+
+    static constexpr std::uint32_t DEFAULT_SLEEP_AFTER = 20;
+    // Тиков простоя до сна чанка; 0 - чанки не засыпают
+    void setSleepAfter(std::uint32_t ticks) { sleepAfter = ticks; }
+    std::uint32_t getSleepAfter() const { return sleepAfter; }
+    // Предел битв за тик; больше свободного места в очереди не бывает
+    void setBattleLimit(size_t limit) { battleLimit = limit; }
+
+    std::uint32_t getTick() const { return tick; }
+    std::uint64_t getSeed() const { return seed; }
+    BattleQueue& getBattleQueue() { return battleQueue; }
+    const BattleQueue& getBattleQueue() const { return battleQueue; }
+    const SpatialGrid& getGrid() const { return grid; }
+    const ChunkMap& getChunks() const { return chunks; }
+    JobSystem& getJobs() { return jobs; }
+    FrameBuffer& getFrames() { return frames; }
+    // Дополнительно публиковать кадры в разделяемую память (nullptr - выключить)
+    void setSharedSnapshot(SharedSnapshotWriter* writer) { sharedSnapshot = writer; }
+
+private:
+    void sleepPhase();
+    void movePhase();
+    void broadPhase();
+    void battlePhase();
+    void statsPhase();
+    void publishPhase();
+    // Фазы, счетчики битв и пар тика - в Metrics
+    void recordMetrics();
+    // Раскладывает NPC бодрствующих чанков по пакетам для заданий
+    void buildChunkTasks();
+    // Живые NPC по типам - по счетчикам чанков
+    void countTypes();
+
+    NPCStore& npcs;
+    JobSystem& jobs;
+    std::uint64_t seed;
+    int mapWidth;
+    int mapHeight;
+    float killDistance;
+
+    SpatialGrid grid;
+    ChunkMap chunks;
+    BattleQueue battleQueue;
+    BattleResolver resolver;
+    CounterRng rng;
+    FrameBuffer frames;
+    SharedSnapshotWriter* sharedSnapshot = nullptr;
+
+    std::uint32_t tick = 0;
+    std::uint32_t sleepAfter = DEFAULT_SLEEP_AFTER;
+    size_t battleLimit = SIZE_MAX;
+    TickReport report;
+    UnionFind<ChunkMap::ChunkKey> islands;
+
+    // Буферы фаз, переиспользуются между тиками
+    struct ChunkTask {
+        const ChunkMap::Chunk* chunk;
+        size_t begin;
+        size_t end;
+    };
+    // NPC, сменивший клетку сетки или чанк, и его прежняя позиция
+    struct Mover {
+        NPCStore::Index id;
+        float oldX;
+        float oldY;
+    };
+    std::vector<ChunkTask> chunkTasks;
+    std::vector<size_t> taskBatches;    // пакет b - куски [taskBatches[b], taskBatches[b + 1])
+    std::vector<std::vector<Mover>> batchMovers;
+    // Битва-кандидат: приоритет выборки и номер в порядке обхода сетки
+    struct BattleCandidate {
+        std::uint64_t priority;
+        std::uint32_t order;
+        ThreadBattle battle;
+    };
+    std::vector<std::vector<BattleCandidate>> shardBattles;
+    std::vector<size_t> shardPairs;
+    std::vector<size_t> shardContacts;
+    std::vector<BattleCandidate> tickCandidates;
+    std::vector<ThreadBattle> tickBattles;
+};
+
+#endif
@@ -0,0 +1,238 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include "simd_kernels.h"
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Равномерная сетка (spatial hash) для broad-phase поиска столкновений.
+// Размер клетки равен дистанции убийства, поэтому любая пара NPC в радиусе
+// убийства лежит либо в одной клетке, либо в соседних.
+// В клетках хранятся индексы NPC в NPCStore.
+// У каждого NPC есть тег (тип), у клетки - маска тегов ее NPC. Если задана
+// таблица взаимодействий, поиск пар пропускает клетки, между тегами которых
+// взаимодействий нет (например, скопление одних орков), и пары клеток,
+// где все NPC спят (setDormant)
+class SpatialGrid {
+public:
+    using Id = std::uint32_t;
+    using Tag = std::uint8_t;
+
+    explicit SpatialGrid(float cellSize);
+
+    // interactions[t] - маска тегов, взаимодействующих с тегом t.
+    // Без таблицы взаимодействуют все
+    void setInteractions(std::vector<std::uint32_t> interactions);
+    bool interacts(std::uint32_t maskA, std::uint32_t maskB) const;
+
+    void insert(Id id, float x, float y, Tag tag = 0);
+    // Спящий NPC остается в сетке. Внутри клетки только из спящих и между
+    // двумя такими клетками пары не ищутся; с бодрствующей соседней клеткой -
+    // ищутся, с какой бы стороны она ни была
+    void setDormant(Id id, float x, float y, bool dormant);
+    void remove(Id id, float x, float y);
+    // Вызывается после перемещения: переносит NPC, только если сменилась клетка
+    void update(Id id, float oldX, float oldY, float newX, float newY);
+    // Убирает из сетки всех NPC, для которых pred(id) == true
+    template <typename Pred>
+    void removeIf(Pred&& pred);
+    void clear();
+
+    // true, если точки лежат в одной клетке (update() для них ничего не делает)
+    bool isSameCell(float x0, float y0, float x1, float y1) const {
+        return keyFor(x0, y0) == keyFor(x1, y1);
+    }
+
+    size_t size() const { return count; }
+    size_t cellCount() const { return cells.size(); }
+    float getCellSize() const { return cellSize; }
+
+    // Перебирает каждую пару-кандидата (своя клетка + соседние) ровно один раз
+    template <typename F>
+    void forEachCandidatePair(F&& f) const;
+
+    // То же, но отдает только пары на расстоянии не больше range (range <= cellSize)
+    template <typename F>
+    void forEachPairInRange(float range, const float* xs, const float* ys, F&& f) const {
+        forEachPairInRange(range, xs, ys, 0, 1, f);
+    }
+
+    // Только клетки из части shard из shardCount: части не пересекаются и вместе
+    // дают все пары, поэтому их можно обходить параллельно
+    template <typename F>
+    void forEachPairInRange(float range, const float* xs, const float* ys,
+                            size_t shard, size_t shardCount, F&& f) const;
+
+private:
+    using CellKey = std::uint64_t;
+
+    struct Cell {
+        std::vector<Id> ids;
+        std::uint32_t mask = 0;     // объединение тегов NPC клетки
+        std::uint32_t dormant = 0;  // спящих NPC в клетке
+    };
+
+    CellKey keyFor(float x, float y) const;
+    static CellKey makeKey(std::int32_t cx, std::int32_t cy);
+    std::uint32_t tagBit(Id id) const { return std::uint32_t(1) << tagOf[id]; }
+    void add(CellKey key, Id id);
+    void ensureId(Id id);
+    // Пересчитывает маску клетки после удаления NPC
+    void refreshMask(Cell& cell) const;
+
+    float cellSize;
+    float invCellSize;
+    size_t count = 0;
+    std::unordered_map<CellKey, Cell> cells;
+    std::vector<Tag> tagOf;
+    std::vector<std::uint8_t> dormantOf;
+    std::vector<std::uint32_t> interactionTable;
+};
+
+inline SpatialGrid::CellKey SpatialGrid::makeKey(std::int32_t cx, std::int32_t cy) {
+    return (static_cast<CellKey>(static_cast<std::uint32_t>(cx)) << 32) |
+           static_cast<std::uint32_t>(cy);
+}
+
+inline bool SpatialGrid::interacts(std::uint32_t maskA, std::uint32_t maskB) const {
+    if (interactionTable.empty()) return maskA != 0 && maskB != 0;
+    for (std::uint32_t bits = maskA; bits; bits &= bits - 1) {
+        if (interactionTable[SimdKernels::lowestBit(bits)] & maskB) return true;
+    }
+    return false;
+}
+
+template <typename F>
+void SpatialGrid::forEachCandidatePair(F&& f) const {
+    // Половина окрестности: пара из соседних клеток видна только с одной стороны
+    static constexpr int NEIGHBOURS[4][2] = {{1, 0}, {1, 1}, {0, 1}, {-1, 1}};
+
+    for (const auto& cell : cells) {
+        const auto& bucket = cell.second.ids;
+        auto cx = static_cast<std::int32_t>(cell.first >> 32);
+        auto cy = static_cast<std::int32_t>(cell.first & 0xffffffffu);
+
+        for (size_t i = 0; i < bucket.size(); ++i) {
+            for (size_t j = i + 1; j < bucket.size(); ++j) {
+                f(bucket[i], bucket[j]);
+            }
+        }
+
+        for (const auto& offset : NEIGHBOURS) {
+            auto it = cells.find(makeKey(cx + offset[0], cy + offset[1]));
+            if (it == cells.end()) continue;
+
+            for (Id a : bucket) {
+                for (Id b : it->second.ids) {
+                    f(a, b);
+                }
+            }
+        }
+    }
+}
+
+template <typename Pred>
+void SpatialGrid::removeIf(Pred&& pred) {
+    for (auto it = cells.begin(); it != cells.end();) {
+        Cell& cell = it->second;
+        auto& bucket = cell.ids;
+        size_t before = bucket.size();
+        bucket.erase(std::remove_if(bucket.begin(), bucket.end(), [&](Id id) {
+            if (!pred(id)) return false;
+            if (dormantOf[id]) {
+                dormantOf[id] = 0;
+                --cell.dormant;
+            }
+            return true;
+        }), bucket.end());
+        count -= before - bucket.size();
+
+        if (bucket.empty()) {
+            it = cells.erase(it);
+        } else {
+            if (bucket.size() != before) refreshMask(cell);
+            ++it;
+        }
+    }
+}
+
+template <typename F>
+void SpatialGrid::forEachPairInRange(float range, const float* xs, const float* ys,
+                                     size_t shard, size_t shardCount, F&& f) const {
+    static constexpr int NEIGHBOURS[4][2] = {{1, 0}, {1, 1}, {0, 1}, {-1, 1}};
+
+    // Координаты клетки собираются в плотные массивы, чтобы проверять
+    // одного NPC сразу против блока кандидатов пакетным ядром
+    thread_local std::vector<float> ownX, ownY, otherX, otherY;
+
+    auto gather = [&](const std::vector<Id>& bucket, std::vector<float>& gx, std::vector<float>& gy) {
+        gx.resize(bucket.size());
+        gy.resize(bucket.size());
+        for (size_t k = 0; k < bucket.size(); ++k) {
+            gx[k] = xs[bucket[k]];
+            gy[k] = ys[bucket[k]];
+        }
+    };
+
+    // Проверяет точку против кандидатов [first, last) и вызывает f для попаданий
+    auto testBlock = [&](Id a, float px, float py, const std::vector<Id>& bucket,
+                         const std::vector<float>& gx, const std::vector<float>& gy,
+                         size_t first) {
+        for (size_t start = first; start < bucket.size(); start += SimdKernels::MASK_BLOCK) {
+            size_t count = std::min(SimdKernels::MASK_BLOCK, bucket.size() - start);
+            std::uint64_t mask = SimdKernels::withinRadiusMask(
+                px, py, gx.data() + start, gy.data() + start, count, range);
+            while (mask) {
+                int bit = SimdKernels::lowestBit(mask);
+                mask &= mask - 1;
+                f(a, bucket[start + bit]);
+            }
+        }
+    };
+
+    // Части делят между собой корзины хеш-таблицы
+    size_t bucketCount = cells.bucket_count();
+    size_t firstBucket = bucketCount * shard / shardCount;
+    size_t lastBucket = bucketCount * (shard + 1) / shardCount;
+
+    for (size_t b = firstBucket; b < lastBucket; ++b) {
+        for (auto cell = cells.begin(b); cell != cells.end(b); ++cell) {
+            const auto& bucket = cell->second.ids;
+            std::uint32_t mask = cell->second.mask;
+            bool asleep = cell->second.dormant == bucket.size();
+            auto cx = static_cast<std::int32_t>(cell->first >> 32);
+            auto cy = static_cast<std::int32_t>(cell->first & 0xffffffffu);
+
+            // Координаты собираются лениво: клетки без взаимодействий не трогаем
+            bool gathered = false;
+            auto gatherOwn = [&]() {
+                if (!gathered) gather(bucket, ownX, ownY);
+                gathered = true;
+            };
+
+            if (!asleep && bucket.size() > 1 && interacts(mask, mask)) {
+                gatherOwn();
+                for (size_t i = 0; i + 1 < bucket.size(); ++i) {
+                    testBlock(bucket[i], ownX[i], ownY[i], bucket, ownX, ownY, i + 1);
+                }
+            }
+
+            for (const auto& offset : NEIGHBOURS) {
+                auto it = cells.find(makeKey(cx + offset[0], cy + offset[1]));
+                if (it == cells.end() || !interacts(mask, it->second.mask)) continue;
+                if (asleep && it->second.dormant == it->second.ids.size()) continue;
+
+                gatherOwn();
+                const auto& other = it->second.ids;
+                gather(other, otherX, otherY);
+                for (size_t i = 0; i < bucket.size(); ++i) {
+                    testBlock(bucket[i], ownX[i], ownY[i], other, otherX, otherY, 0);
+                }
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef SUBSCRIPTION_INDEX_H
+#define SUBSCRIPTION_INDEX_H
+
+#include "battle_event.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+class BattleObserver;
+
+using SubscriptionId = std::uint64_t;
+
+constexpr std::size_t BATTLE_RESULT_COUNT = 4;
+constexpr std::uint8_t ALL_BATTLE_RESULTS = (1u << BATTLE_RESULT_COUNT) - 1;
+constexpr std::uint32_t ALL_NPC_TYPES = (std::uint32_t(1) << NPC_TYPE_COUNT) - 1;
+
+constexpr std::uint8_t resultBit(BattleResult result) {
+    return static_cast<std::uint8_t>(1u << static_cast<unsigned>(result));
+}
+
+// Прямоугольник мира [minX, maxX) x [minY, maxY)
+struct BattleRegion {
+    float minX = 0.0f;
+    float minY = 0.0f;
+    float maxX = 0.0f;
+    float maxY = 0.0f;
+
+    bool contains(float x, float y) const {
+        return x >= minX && x < maxX && y >= minY && y < maxY;
+    }
+};
+
+// Какие события нужны подписке; по умолчанию - все
+struct BattleFilter {
+    std::uint8_t results = ALL_BATTLE_RESULTS;  // маска resultBit
+    std::uint32_t types = ALL_NPC_TYPES;        // маска typeBit: тип хотя бы одного участника
+    std::optional<BattleRegion> region;         // позиция события (защитника)
+    std::optional<EntityHandle> entity;         // один из участников
+
+    bool unfiltered() const {
+        return results == ALL_BATTLE_RESULTS && types == ALL_NPC_TYPES && !region && !entity;
+    }
+    bool matches(const BattleEvent& event) const;
+};
+
+// Счетчики отсеянных событий ведет тот, кто рассылает: notifier в
+// синхронном режиме или исполнитель, за которым закреплена подписка.
+// При смене рассыльщика накопленное переходит в filteredBefore
+struct Subscription {
+    SubscriptionId id = 0;
+    std::shared_ptr<BattleObserver> observer;
+    BattleFilter filter;
+    std::size_t executor = 0;                   // исполнитель в асинхронном режиме
+    std::uint64_t eventsBefore = 0;             // событий рассыльщика до подписки
+    std::uint64_t matchedBefore = 0;            // matched на тот же момент
+    std::uint64_t filteredBefore = 0;           // отсеяно прежними рассыльщиками
+    std::atomic<std::uint64_t> delivered{0};    // событий и текстовых уведомлений
+    std::atomic<std::uint64_t> matched{0};      // из них событий
+};
+
+struct SubscriptionStats {
+    std::uint64_t delivered = 0;
+    std::uint64_t filtered = 0;     // разосланные после подписки события, не подошедшие ей
+};
+
+// Индекс подписок по фильтрам: событие проверяется только против подписок,
+// которым оно может подойти. Подписка лежит в одном разделе: по участнику,
+// по клеткам региона или в списках всех сочетаний (итог, тип атакующего,
+// тип защитника), которые пропускает ее фильтр. Регион шире MAX_REGION_CELLS
+// клеток проверяется на каждом событии
+class SubscriptionIndex {
+public:
+    static constexpr float REGION_CELL = 32.0f;
+    static constexpr std::size_t MAX_REGION_CELLS = 256;
+
+    void add(Subscription* subscription);
+    void remove(const Subscription* subscription);
+    bool empty() const { return count == 0; }
+    std::size_t size() const { return count; }
+
+    // Вызывает f(Subscription&) для подписок, которым подходит событие,
+    // для каждой один раз
+    template <typename F>
+    void forEachMatch(const BattleEvent& event, F&& f) const;
+    // Подписки без фильтра: им идут и текстовые уведомления
+    const std::vector<Subscription*>& unfiltered() const { return plain; }
+
+private:
+    using Bucket = std::vector<Subscription*>;
+
+    static std::uint64_t cellKey(std::int64_t cx, std::int64_t cy);
+    static std::int64_t cellOf(float coordinate);
+    // Списки, куда входит подписка; без create - только существующие
+    std::vector<Bucket*> bucketsOf(const Subscription* subscription, bool create);
+
+    Bucket byKind[BATTLE_RESULT_COUNT][NPC_TYPE_COUNT][NPC_TYPE_COUNT];
+    std::unordered_map<std::uint64_t, Bucket> byEntity;
+    std::unordered_map<std::uint64_t, Bucket> byCell;
+    Bucket wideRegions;
+    Bucket plain;
+    std::size_t count = 0;
+};
+
+template <typename F>
+void SubscriptionIndex::forEachMatch(const BattleEvent& event, F&& f) const {
+    // Сочетание итога и типов целиком решает фильтр: проверка не нужна
+    for (Subscription* subscription : byKind[static_cast<std::size_t>(event.result)]
+                                            [typeIndex(event.attackerType)][typeIndex(event.defenderType)]) {
+        f(*subscription);
+    }
+
+    auto check = [&](const Bucket& bucket) {
+        for (Subscription* subscription : bucket) {
+            if (subscription->filter.matches(event)) f(*subscription);
+        }
+    };
+    if (!byEntity.empty()) {
+        if (auto it = byEntity.find(event.attacker.packed()); it != byEntity.end()) check(it->second);
+        if (auto it = byEntity.find(event.defender.packed()); it != byEntity.end()) check(it->second);
+    }
+    if (!byCell.empty()) {
+        if (auto it = byCell.find(cellKey(cellOf(event.x), cellOf(event.y))); it != byCell.end()) check(it->second);
+    }
+    check(wideRegions);
+}
+
+#endif
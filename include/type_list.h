@@ -0,0 +1,73 @@
+#ifndef TYPE_LIST_H
+#define TYPE_LIST_H
+
+#include <cstddef>
+#include <type_traits>
+
+// Список типов времени компиляции
+template <typename... Ts>
+struct TypeList {
+    static constexpr std::size_t size = sizeof...(Ts);
+
+    // TypeList<A, B>::apply<std::variant> == std::variant<A, B>
+    template <template <typename...> class Target>
+    using apply = Target<Ts...>;
+};
+
+// Тег-обертка для передачи типа в обобщенную лямбду
+template <typename T>
+struct TypeTag {
+    using type = T;
+};
+
+// Позиция типа T в списке
+template <typename T, typename List>
+struct IndexOf;
+
+template <typename T, typename... Ts>
+struct IndexOf<T, TypeList<T, Ts...>> : std::integral_constant<std::size_t, 0> {};
+
+template <typename T, typename U, typename... Ts>
+struct IndexOf<T, TypeList<U, Ts...>>
+    : std::integral_constant<std::size_t, 1 + IndexOf<T, TypeList<Ts...>>::value> {};
+
+// Первый тип списка
+template <typename List>
+struct FrontOf;
+
+template <typename T, typename... Ts>
+struct FrontOf<TypeList<T, Ts...>> {
+    using type = T;
+};
+
+// Статическая диспетчеризация по индексу типа: таблица указателей на
+// функции, по одной на каждый тип списка (компилируется в jump table)
+template <typename List>
+struct TypeDispatcher;
+
+template <typename... Ts>
+struct TypeDispatcher<TypeList<Ts...>> {
+    template <typename F>
+    static decltype(auto) dispatch(std::size_t index, F&& f) {
+        using First = typename FrontOf<TypeList<Ts...>>::type;
+        using Result = decltype(f(TypeTag<First>{}));
+        using Entry = Result (*)(F&);
+
+        static constexpr Entry table[] = {&invoke<Ts, F, Result>...};
+        return table[index](f);
+    }
+
+    // Вызывает f(TypeTag<T>{}) для каждого типа списка по порядку
+    template <typename F>
+    static void forEach(F&& f) {
+        (f(TypeTag<Ts>{}), ...);
+    }
+
+private:
+    template <typename T, typename F, typename Result>
+    static Result invoke(F& f) {
+        return f(TypeTag<T>{});
+    }
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef UNION_FIND_H
+#define UNION_FIND_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+// Система непересекающихся множеств над разреженными ключами (union-find
+// с объединением по рангу и сжатием путей). Память - по числу добавленных
+// ключей, поэтому ее можно очищать и заполнять заново на каждом тике
+template <typename Key>
+class UnionFind {
+public:
+    void clear() {
+        nodes.clear();
+        sets = 0;
+    }
+
+    // Добавляет ключ отдельным множеством (если его еще нет)
+    void add(Key key) {
+        if (nodes.emplace(key, Node{key, 0}).second) ++sets;
+    }
+
+    bool contains(Key key) const { return nodes.count(key) != 0; }
+
+    // Представитель множества ключа; ключ должен быть добавлен
+    Key find(Key key) {
+        Node* node = &nodes.at(key);
+        while (node->parent != key) {
+            // Сжатие пути делением пополам
+            Node& parent = nodes.at(node->parent);
+            node->parent = parent.parent;
+            key = node->parent;
+            node = &nodes.at(key);
+        }
+        return key;
+    }
+
+    // Объединяет множества (ключи добавляются при необходимости);
+    // true, если они были разными
+    bool unite(Key a, Key b) {
+        add(a);
+        add(b);
+        a = find(a);
+        b = find(b);
+        if (a == b) return false;
+
+        Node& rootA = nodes.at(a);
+        Node& rootB = nodes.at(b);
+        if (rootA.rank < rootB.rank) {
+            rootA.parent = b;
+        } else {
+            rootB.parent = a;
+            if (rootA.rank == rootB.rank) ++rootA.rank;
+        }
+        --sets;
+        return true;
+    }
+
+    size_t size() const { return nodes.size(); }
+    size_t setCount() const { return sets; }
+
+private:
+    struct Node {
+        Key parent;
+        std::uint32_t rank;
+    };
+
+    std::unordered_map<Key, Node> nodes;
+    size_t sets = 0;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef WORLD_BOUNDS_H
+#define WORLD_BOUNDS_H
+
+#include <string>
+
+// Прямоугольник мира [0, width] x [0, height]; задается во время выполнения
+struct WorldBounds {
+    float width = 500.0f;
+    float height = 500.0f;
+
+    bool contains(float x, float y) const {
+        return x >= 0 && x <= width && y >= 0 && y <= height;
+    }
+    std::string describe() const {
+        return "0-" + std::to_string(static_cast<long long>(width)) + " x 0-" +
+               std::to_string(static_cast<long long>(height));
+    }
+};
+
+// Исторические границы фабрики: 0-500 по обеим осям
+constexpr WorldBounds DEFAULT_WORLD_BOUNDS{500.0f, 500.0f};
+
+#endif
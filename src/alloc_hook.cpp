@@ -0,0 +1,81 @@
+#include "../include/alloc_tracker.h"
+#include <cstdlib>
+#include <new>
+
+// Глобальные operator new/delete с учетом в AllocTracker. Перед каждым
+// блоком лежит заголовок с размером и меткой выделения, поэтому delete
+// без размера тоже учитывается
+namespace {
+
+struct alignas(16) Header {
+    std::size_t size;
+    std::uint32_t token;
+    std::uint32_t offset;       // от начала выделенной памяти до блока
+};
+
+static_assert(sizeof(Header) == 16, "header keeps default new alignment");
+
+void* allocate(std::size_t size, std::size_t alignment) {
+    std::size_t offset = alignment > sizeof(Header) ? alignment : sizeof(Header);
+    void* raw;
+    if (alignment > sizeof(Header)) {
+        std::size_t total = (size + offset + alignment - 1) / alignment * alignment;
+        raw = std::aligned_alloc(alignment, total);
+    } else {
+        raw = std::malloc(size + offset);
+    }
+    if (!raw) return nullptr;
+
+    char* block = static_cast<char*>(raw) + offset;
+    Header* header = reinterpret_cast<Header*>(block) - 1;
+    header->size = size;
+    header->offset = static_cast<std::uint32_t>(offset);
+    header->token = AllocTracker::recordAllocation(size);
+    return block;
+}
+
+void* allocateOrThrow(std::size_t size, std::size_t alignment) {
+    if (void* block = allocate(size, alignment)) return block;
+    throw std::bad_alloc();
+}
+
+void release(void* block) {
+    if (!block) return;
+    Header* header = static_cast<Header*>(block) - 1;
+    AllocTracker::recordFree(header->token, header->size);
+    std::free(static_cast<char*>(block) - header->offset);
+}
+
+const bool registered = (AllocTracker::markHooked(), true);
+
+}  // namespace
+
+void* operator new(std::size_t size) { return allocateOrThrow(size, 0); }
+void* operator new[](std::size_t size) { return allocateOrThrow(size, 0); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new(std::size_t size, std::align_val_t al) {
+    return allocateOrThrow(size, static_cast<std::size_t>(al));
+}
+void* operator new[](std::size_t size, std::align_val_t al) {
+    return allocateOrThrow(size, static_cast<std::size_t>(al));
+}
+void* operator new(std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return allocate(size, static_cast<std::size_t>(al));
+}
+void* operator new[](std::size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return allocate(size, static_cast<std::size_t>(al));
+}
+
+void operator delete(void* block) noexcept { release(block); }
+void operator delete[](void* block) noexcept { release(block); }
+void operator delete(void* block, std::size_t) noexcept { release(block); }
+void operator delete[](void* block, std::size_t) noexcept { release(block); }
+void operator delete(void* block, const std::nothrow_t&) noexcept { release(block); }
+void operator delete[](void* block, const std::nothrow_t&) noexcept { release(block); }
+void operator delete(void* block, std::align_val_t) noexcept { release(block); }
+void operator delete[](void* block, std::align_val_t) noexcept { release(block); }
+void operator delete(void* block, std::size_t, std::align_val_t) noexcept { release(block); }
+void operator delete[](void* block, std::size_t, std::align_val_t) noexcept { release(block); }
+void operator delete(void* block, std::align_val_t, const std::nothrow_t&) noexcept { release(block); }
+void operator delete[](void* block, std::align_val_t, const std::nothrow_t&) noexcept { release(block); }
@@ -0,0 +1,147 @@
+#include "../include/alloc_tracker.h"
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+// Счетчики тега. Статические атомики инициализируются нулями до любых
+// конструкторов, поэтому хук может работать еще до main()
+struct TagCounters {
+    std::atomic<std::uint64_t> allocations;
+    std::atomic<std::uint64_t> frees;
+    std::atomic<std::uint64_t> bytes;
+    std::atomic<std::int64_t> liveBytes;
+    std::atomic<std::int64_t> peakLiveBytes;
+    std::atomic<std::uint64_t> tickAllocations;
+    std::atomic<std::uint64_t> tickBytes;
+    std::atomic<std::uint64_t> maxTickAllocations;
+    std::atomic<std::uint64_t> maxTickBytes;
+};
+
+TagCounters counters[ALLOC_TAG_COUNT];
+std::atomic<std::uint64_t> ticks;
+// Поколение учета: освобождения блоков, выделенных до reset(), не считаются
+std::atomic<std::uint32_t> generation;
+
+constexpr std::uint32_t TAG_BITS = 8;
+
+void raise(std::atomic<std::uint64_t>& target, std::uint64_t value) {
+    std::uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void raise(std::atomic<std::int64_t>& target, std::int64_t value) {
+    std::int64_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+}  // namespace
+
+std::uint32_t AllocTracker::recordAllocation(size_t size) {
+    if (!enabled()) return NOT_COUNTED;
+
+    auto tag = static_cast<std::uint32_t>(threadTag);
+    TagCounters& c = counters[tag];
+    c.allocations.fetch_add(1, std::memory_order_relaxed);
+    c.bytes.fetch_add(size, std::memory_order_relaxed);
+    c.tickAllocations.fetch_add(1, std::memory_order_relaxed);
+    c.tickBytes.fetch_add(size, std::memory_order_relaxed);
+    std::int64_t live = c.liveBytes.fetch_add(static_cast<std::int64_t>(size), std::memory_order_relaxed) +
+                        static_cast<std::int64_t>(size);
+    raise(c.peakLiveBytes, live);
+    return (generation.load(std::memory_order_relaxed) << TAG_BITS) | tag;
+}
+
+void AllocTracker::recordFree(std::uint32_t token, size_t size) {
+    if (token == NOT_COUNTED) return;
+    if ((token >> TAG_BITS) != (generation.load(std::memory_order_relaxed) & (NOT_COUNTED >> TAG_BITS))) return;
+
+    TagCounters& c = counters[token & ((1u << TAG_BITS) - 1)];
+    c.frees.fetch_add(1, std::memory_order_relaxed);
+    c.liveBytes.fetch_sub(static_cast<std::int64_t>(size), std::memory_order_relaxed);
+}
+
+void AllocTracker::nextTick() {
+    for (TagCounters& c : counters) {
+        raise(c.maxTickAllocations, c.tickAllocations.exchange(0, std::memory_order_relaxed));
+        raise(c.maxTickBytes, c.tickBytes.exchange(0, std::memory_order_relaxed));
+    }
+    ticks.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AllocTracker::startTick() {
+    for (TagCounters& c : counters) {
+        c.tickAllocations.store(0, std::memory_order_relaxed);
+        c.tickBytes.store(0, std::memory_order_relaxed);
+    }
+}
+
+AllocReport AllocTracker::report() {
+    AllocReport result;
+    result.hooked = hooked();
+    result.ticks = ticks.load(std::memory_order_relaxed);
+    for (size_t t = 0; t < ALLOC_TAG_COUNT; ++t) {
+        const TagCounters& c = counters[t];
+        AllocTagStats& stats = result.tags[t];
+        stats.allocations = c.allocations.load(std::memory_order_relaxed);
+        stats.frees = c.frees.load(std::memory_order_relaxed);
+        stats.bytes = c.bytes.load(std::memory_order_relaxed);
+        stats.liveBytes = c.liveBytes.load(std::memory_order_relaxed);
+        stats.peakLiveBytes = c.peakLiveBytes.load(std::memory_order_relaxed);
+        stats.maxTickAllocations = c.maxTickAllocations.load(std::memory_order_relaxed);
+        stats.maxTickBytes = c.maxTickBytes.load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+void AllocTracker::reset() {
+    generation.fetch_add(1, std::memory_order_relaxed);
+    for (TagCounters& c : counters) {
+        c.allocations.store(0, std::memory_order_relaxed);
+        c.frees.store(0, std::memory_order_relaxed);
+        c.bytes.store(0, std::memory_order_relaxed);
+        c.liveBytes.store(0, std::memory_order_relaxed);
+        c.peakLiveBytes.store(0, std::memory_order_relaxed);
+        c.tickAllocations.store(0, std::memory_order_relaxed);
+        c.tickBytes.store(0, std::memory_order_relaxed);
+        c.maxTickAllocations.store(0, std::memory_order_relaxed);
+        c.maxTickBytes.store(0, std::memory_order_relaxed);
+    }
+    ticks.store(0, std::memory_order_relaxed);
+}
+
+std::string AllocTracker::format(const AllocReport& report) {
+    std::ostringstream out;
+    if (!report.hooked) {
+        out << "Allocations: not tracked (configure with -DALLOC_TRACKING=ON)\n";
+        return out.str();
+    }
+    out << "Allocations by tag over " << report.ticks << " ticks:\n"
+        << std::left << std::setw(10) << "tag" << std::right
+        << std::setw(12) << "allocs" << std::setw(14) << "bytes"
+        << std::setw(12) << "live" << std::setw(12) << "peak live"
+        << std::setw(14) << "max allocs/t" << std::setw(14) << "max bytes/t" << "\n";
+    for (size_t t = 0; t < ALLOC_TAG_COUNT; ++t) {
+        const AllocTagStats& s = report.tags[t];
+        out << std::left << std::setw(10) << name(static_cast<AllocTag>(t)) << std::right
+            << std::setw(12) << s.allocations << std::setw(14) << s.bytes
+            << std::setw(12) << s.liveBytes << std::setw(12) << s.peakLiveBytes
+            << std::setw(14) << s.maxTickAllocations << std::setw(14) << s.maxTickBytes << "\n";
+    }
+    return out.str();
+}
+
+const char* AllocTracker::name(AllocTag tag) {
+    switch (tag) {
+        case AllocTag::Other: return "other";
+        case AllocTag::Movement: return "movement";
+        case AllocTag::Battle: return "battle";
+        case AllocTag::Render: return "render";
+        case AllocTag::Logging: return "logging";
+        case AllocTag::IO: return "io";
+        case AllocTag::COUNT: break;
+    }
+    return "unknown";
+}
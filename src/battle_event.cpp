@@ -0,0 +1,100 @@
+#include "../include/battle_event.h"
+#include <mutex>
+
+void NameTable::set(EntityHandle handle, const std::string& name) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    names[handle.packed()] = name;
+}
+
+void NameTable::appendName(EntityHandle handle, std::string& out) const {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = names.find(handle.packed());
+        if (it != names.end()) {
+            out += it->second;
+            return;
+        }
+    }
+    out += '#';
+    out += std::to_string(handle.index);
+}
+
+std::string NameTable::nameOf(EntityHandle handle) const {
+    std::string name;
+    appendName(handle, name);
+    return name;
+}
+
+size_t NameTable::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names.size();
+}
+
+std::vector<std::pair<EntityHandle, std::string>> NameTable::entries() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<std::pair<EntityHandle, std::string>> result;
+    result.reserve(names.size());
+    for (const auto& [key, name] : names) {
+        result.push_back({EntityHandle{static_cast<std::uint32_t>(key), static_cast<std::uint32_t>(key >> 32)}, name});
+    }
+    return result;
+}
+
+void NameTable::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    names.clear();
+}
+
+static void appendFighter(std::string& out, NPCType type, EntityHandle handle, const NameTable& names) {
+    out += traitsOf(type).name;
+    out += ' ';
+    names.appendName(handle, out);
+}
+
+void appendBattleEvent(std::string& out, const BattleEvent& event, const NameTable& names) {
+    if (event.attackRoll != 0) {
+        out += "Battle: ";
+        appendFighter(out, event.attackerType, event.attacker, names);
+        out += " [";
+        out += std::to_string(event.attackRoll);
+        out += "] vs ";
+        appendFighter(out, event.defenderType, event.defender, names);
+        out += " [";
+        out += std::to_string(event.defenseRoll);
+        out += "] -> ";
+        names.appendName(event.defender, out);
+        out += event.result == BattleResult::Defended ? " DEFENDED!" : " KILLED!";
+        return;
+    }
+
+    switch (event.result) {
+        case BattleResult::AttackerKills:
+            appendFighter(out, event.attackerType, event.attacker, names);
+            out += " kills ";
+            appendFighter(out, event.defenderType, event.defender, names);
+            break;
+        case BattleResult::Defended:
+            appendFighter(out, event.attackerType, event.attacker, names);
+            out += " attacks ";
+            appendFighter(out, event.defenderType, event.defender, names);
+            out += ": DEFENDED!";
+            break;
+        case BattleResult::DefenderKills:
+            appendFighter(out, event.defenderType, event.defender, names);
+            out += " kills ";
+            appendFighter(out, event.attackerType, event.attacker, names);
+            break;
+        case BattleResult::BothDie:
+            appendFighter(out, event.attackerType, event.attacker, names);
+            out += " and ";
+            appendFighter(out, event.defenderType, event.defender, names);
+            out += " kill each other";
+            break;
+    }
+}
+
+std::string formatBattleEvent(const BattleEvent& event, const NameTable& names) {
+    std::string text;
+    appendBattleEvent(text, event, names);
+    return text;
+}
@@ -0,0 +1,460 @@
+#include "../include/battle_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace battle_log;
+
+static_assert(sizeof(FileHeader) == 16, "blocks start 8-byte aligned");
+static_assert(sizeof(BlockHeader) == 8, "columns start 8-byte aligned");
+static_assert(sizeof(BlockIndex) == 88 && std::is_trivially_copyable<BlockIndex>::value,
+              "index entries are written as is");
+static_assert(sizeof(Trailer) == 32, "trailer has a fixed size");
+
+namespace {
+
+std::size_t align8(std::size_t size) {
+    return (size + 7) & ~std::size_t(7);
+}
+
+// Смещения колонок внутри блока из count событий
+struct BlockLayout {
+    std::size_t attackers, defenders, ticks, xs, ys;
+    std::size_t attackerTypes, defenderTypes, results, attackRolls, defenseRolls;
+    std::size_t size;
+
+    explicit BlockLayout(std::uint32_t count) {
+        std::size_t n = count;
+        attackers = sizeof(BlockHeader);
+        defenders = attackers + 8 * n;
+        ticks = defenders + 8 * n;
+        xs = ticks + align8(4 * n);
+        ys = xs + align8(4 * n);
+        attackerTypes = ys + align8(4 * n);
+        defenderTypes = attackerTypes + align8(n);
+        results = defenderTypes + align8(n);
+        attackRolls = results + align8(n);
+        defenseRolls = attackRolls + align8(n);
+        size = defenseRolls + align8(n);
+    }
+};
+
+// Колонки блока в отображенном файле
+struct BlockColumns {
+    const std::uint64_t* attackers;
+    const std::uint64_t* defenders;
+    const std::uint32_t* ticks;
+    const float* xs;
+    const float* ys;
+    const std::uint8_t* attackerTypes;
+    const std::uint8_t* defenderTypes;
+    const std::uint8_t* results;
+    const std::uint8_t* attackRolls;
+    const std::uint8_t* defenseRolls;
+
+    BlockColumns(const unsigned char* block, std::uint32_t count) {
+        BlockLayout layout(count);
+        attackers = reinterpret_cast<const std::uint64_t*>(block + layout.attackers);
+        defenders = reinterpret_cast<const std::uint64_t*>(block + layout.defenders);
+        ticks = reinterpret_cast<const std::uint32_t*>(block + layout.ticks);
+        xs = reinterpret_cast<const float*>(block + layout.xs);
+        ys = reinterpret_cast<const float*>(block + layout.ys);
+        attackerTypes = block + layout.attackerTypes;
+        defenderTypes = block + layout.defenderTypes;
+        results = block + layout.results;
+        attackRolls = block + layout.attackRolls;
+        defenseRolls = block + layout.defenseRolls;
+    }
+
+    BattleEvent event(std::uint32_t i) const {
+        BattleEvent e;
+        e.attacker = EntityHandle{static_cast<std::uint32_t>(attackers[i]), static_cast<std::uint32_t>(attackers[i] >> 32)};
+        e.defender = EntityHandle{static_cast<std::uint32_t>(defenders[i]), static_cast<std::uint32_t>(defenders[i] >> 32)};
+        e.attackerType = static_cast<NPCType>(attackerTypes[i]);
+        e.defenderType = static_cast<NPCType>(defenderTypes[i]);
+        e.result = static_cast<BattleResult>(results[i]);
+        e.attackRoll = attackRolls[i];
+        e.defenseRoll = defenseRolls[i];
+        e.tick = ticks[i];
+        e.x = xs[i];
+        e.y = ys[i];
+        return e;
+    }
+};
+
+// Байты итога и типов из файла: иначе сдвиги resultBit/typeBit не определены
+bool validRow(const BlockColumns& columns, std::uint32_t i) {
+    return columns.results[i] < BATTLE_RESULT_COUNT && columns.attackerTypes[i] < NPC_TYPE_COUNT &&
+           columns.defenderTypes[i] < NPC_TYPE_COUNT;
+}
+
+// Два бита Bloom-фильтра для дескриптора
+std::pair<unsigned, unsigned> bloomBits(EntityHandle handle) {
+    std::uint64_t h = handle.packed() * 0x9E3779B97F4A7C15ull;
+    return {static_cast<unsigned>(h >> 55), static_cast<unsigned>((h >> 46) & 511)};
+}
+
+void resetIndex(BlockIndex& entry) {
+    entry = BlockIndex{};
+    entry.minTick = std::numeric_limits<std::uint32_t>::max();
+}
+
+void indexEvent(BlockIndex& entry, const BattleEvent& event) {
+    entry.minTick = std::min(entry.minTick, event.tick);
+    entry.maxTick = std::max(entry.maxTick, event.tick);
+    entry.results |= resultBit(event.result);
+    entry.killerTypes |= static_cast<std::uint8_t>(killerTypes(event));
+    entry.addEntity(event.attacker);
+    entry.addEntity(event.defender);
+}
+
+std::runtime_error fileError(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " '" + path + "': " + std::strerror(errno));
+}
+
+}  // namespace
+
+void BlockIndex::addEntity(EntityHandle handle) {
+    auto [a, b] = bloomBits(handle);
+    entities[a / 64] |= std::uint64_t(1) << (a % 64);
+    entities[b / 64] |= std::uint64_t(1) << (b % 64);
+}
+
+bool BlockIndex::mayContain(EntityHandle handle) const {
+    auto [a, b] = bloomBits(handle);
+    return (entities[a / 64] >> (a % 64) & 1) && (entities[b / 64] >> (b % 64) & 1);
+}
+
+std::size_t battle_log::blockSize(std::uint32_t count) {
+    return BlockLayout(count).size;
+}
+
+std::uint32_t battle_log::killerTypes(const BattleEvent& event) {
+    switch (event.result) {
+        case BattleResult::AttackerKills: return typeBit(event.attackerType);
+        case BattleResult::DefenderKills: return typeBit(event.defenderType);
+        case BattleResult::BothDie: return typeBit(event.attackerType) | typeBit(event.defenderType);
+        case BattleResult::Defended: break;
+    }
+    return 0;
+}
+
+BattleLogWriter::BattleLogWriter(const std::string& path, std::uint32_t blockCapacity)
+    : path(path), blockCapacity(std::max<std::uint32_t>(1, blockCapacity)) {
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) throw fileError("cannot create battle log", path);
+
+    for (auto* column : {&attackers, &defenders}) column->reserve(this->blockCapacity);
+    ticks.reserve(this->blockCapacity);
+    xs.reserve(this->blockCapacity);
+    ys.reserve(this->blockCapacity);
+    for (auto* column : {&attackerTypes, &defenderTypes, &results, &attackRolls, &defenseRolls}) {
+        column->reserve(this->blockCapacity);
+    }
+    resetIndex(current);
+
+    FileHeader header{};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.blockCapacity = this->blockCapacity;
+    writeAll(&header, sizeof(header));
+}
+
+BattleLogWriter::~BattleLogWriter() {
+    close();
+}
+
+void BattleLogWriter::onBattleEvent(const BattleEvent& event, const NameTable& table) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd < 0 || totals.failed) return;
+    names = &table;
+
+    attackers.push_back(event.attacker.packed());
+    defenders.push_back(event.defender.packed());
+    ticks.push_back(event.tick);
+    xs.push_back(event.x);
+    ys.push_back(event.y);
+    attackerTypes.push_back(static_cast<std::uint8_t>(event.attackerType));
+    defenderTypes.push_back(static_cast<std::uint8_t>(event.defenderType));
+    results.push_back(static_cast<std::uint8_t>(event.result));
+    attackRolls.push_back(event.attackRoll);
+    defenseRolls.push_back(event.defenseRoll);
+    indexEvent(current, event);
+    ++totals.events;
+
+    if (ticks.size() == blockCapacity) writeBlock();
+}
+
+void BattleLogWriter::writeBlock() {
+    auto count = static_cast<std::uint32_t>(ticks.size());
+    if (count == 0) return;
+
+    BlockLayout layout(count);
+    buffer.assign(layout.size, 0);
+    BlockHeader header{BLOCK_MAGIC, count};
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    auto put = [&](std::size_t at, const auto& column) {
+        std::memcpy(buffer.data() + at, column.data(), column.size() * sizeof(column[0]));
+    };
+    put(layout.attackers, attackers);
+    put(layout.defenders, defenders);
+    put(layout.ticks, ticks);
+    put(layout.xs, xs);
+    put(layout.ys, ys);
+    put(layout.attackerTypes, attackerTypes);
+    put(layout.defenderTypes, defenderTypes);
+    put(layout.results, results);
+    put(layout.attackRolls, attackRolls);
+    put(layout.defenseRolls, defenseRolls);
+
+    current.offset = offset;
+    current.count = count;
+    if (writeAll(buffer.data(), buffer.size())) {
+        index.push_back(current);
+        ++totals.blocks;
+    }
+
+    attackers.clear();
+    defenders.clear();
+    ticks.clear();
+    xs.clear();
+    ys.clear();
+    attackerTypes.clear();
+    defenderTypes.clear();
+    results.clear();
+    attackRolls.clear();
+    defenseRolls.clear();
+    resetIndex(current);
+}
+
+bool BattleLogWriter::writeAll(const void* data, std::size_t size) {
+    if (totals.failed) return false;
+    auto* bytes = static_cast<const char*>(data);
+    std::size_t done = 0;
+    while (done < size) {
+        ssize_t n = ::write(fd, bytes + done, size - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            // Диск полон или файл недоступен: смещения дальше не сошлись бы
+            // с файлом, поэтому журнал обрывается на последнем целом блоке
+            totals.failed = true;
+            break;
+        }
+        done += static_cast<std::size_t>(n);
+    }
+    offset += done;
+    totals.bytes += done;
+    return !totals.failed;
+}
+
+void BattleLogWriter::close() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd < 0) return;
+    writeBlock();
+    if (totals.failed) {
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+
+    // Имена: число записей, затем дескриптор, длина и байты имени
+    Trailer trailer{};
+    trailer.namesOffset = offset;
+    auto entries = names ? names->entries() : std::vector<std::pair<EntityHandle, std::string>>{};
+    buffer.clear();
+    auto append = [&](const void* data, std::size_t size) {
+        buffer.insert(buffer.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+    };
+    std::uint64_t count = entries.size();
+    append(&count, sizeof(count));
+    for (const auto& [handle, name] : entries) {
+        std::uint64_t key = handle.packed();
+        auto length = static_cast<std::uint32_t>(name.size());
+        append(&key, sizeof(key));
+        append(&length, sizeof(length));
+        append(name.data(), name.size());
+    }
+    buffer.resize(align8(buffer.size()), 0);
+    writeAll(buffer.data(), buffer.size());
+
+    trailer.indexOffset = offset;
+    trailer.blockCount = index.size();
+    writeAll(index.data(), index.size() * sizeof(BlockIndex));
+    std::memcpy(trailer.magic, TRAILER_MAGIC, sizeof(trailer.magic));
+    writeAll(&trailer, sizeof(trailer));
+
+    ::close(fd);
+    fd = -1;
+}
+
+BattleLogStats BattleLogWriter::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return totals;
+}
+
+BattleLogReader::BattleLogReader(const std::string& path) : path(path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) throw fileError("cannot open battle log", path);
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw fileError("cannot stat battle log", path);
+    }
+    size = static_cast<std::size_t>(info.st_size);
+    if (size < sizeof(FileHeader)) {
+        ::close(fd);
+        throw std::runtime_error("'" + path + "' is not a battle log");
+    }
+    void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) throw fileError("cannot map battle log", path);
+    data = static_cast<const unsigned char*>(memory);
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != VERSION) {
+        munmap(const_cast<unsigned char*>(data), size);
+        throw std::runtime_error("'" + path + "' is not a battle log");
+    }
+
+    try {
+        if (!readIndex()) rebuildIndex();
+    } catch (...) {
+        munmap(const_cast<unsigned char*>(data), size);
+        throw;
+    }
+}
+
+BattleLogReader::~BattleLogReader() {
+    munmap(const_cast<unsigned char*>(data), size);
+}
+
+bool BattleLogReader::readIndex() {
+    if (size < sizeof(FileHeader) + sizeof(Trailer)) return false;
+    Trailer trailer{};
+    std::memcpy(&trailer, data + size - sizeof(Trailer), sizeof(Trailer));
+    if (std::memcmp(trailer.magic, TRAILER_MAGIC, sizeof(trailer.magic)) != 0) return false;
+
+    // Смещения проверяются до арифметики с ними: файл может быть испорчен
+    std::uint64_t indexBytes = size - sizeof(Trailer) - sizeof(FileHeader);
+    if (trailer.blockCount > indexBytes / sizeof(BlockIndex)) return false;
+    if (trailer.indexOffset + trailer.blockCount * sizeof(BlockIndex) != size - sizeof(Trailer)) return false;
+    if (trailer.namesOffset < sizeof(FileHeader) || trailer.namesOffset > trailer.indexOffset) return false;
+
+    std::vector<BlockIndex> entries(trailer.blockCount);
+    std::memcpy(entries.data(), data + trailer.indexOffset, trailer.blockCount * sizeof(BlockIndex));
+    for (const auto& block : entries) {
+        if (block.count == 0 || block.offset < sizeof(FileHeader) || block.offset > trailer.namesOffset ||
+            blockSize(block.count) > trailer.namesOffset - block.offset) {
+            return false;
+        }
+        BlockHeader header;
+        std::memcpy(&header, data + block.offset, sizeof(header));
+        if (header.magic != BLOCK_MAGIC || header.count != block.count) return false;
+    }
+
+    NameTable table;
+    if (!readNames(trailer.namesOffset, trailer.indexOffset, table)) return false;
+    blocks = std::move(entries);
+    for (const auto& [handle, name] : table.entries()) names.set(handle, name);
+    complete = true;
+    return true;
+}
+
+void BattleLogReader::rebuildIndex() {
+    // Хвоста нет: идем по заголовкам блоков до первого неполного
+    std::size_t at = sizeof(FileHeader);
+    while (at + sizeof(BlockHeader) <= size) {
+        BlockHeader header;
+        std::memcpy(&header, data + at, sizeof(header));
+        if (header.magic != BLOCK_MAGIC || header.count == 0 || at + blockSize(header.count) > size) break;
+
+        BlockIndex entry;
+        resetIndex(entry);
+        entry.offset = at;
+        entry.count = header.count;
+        BlockColumns columns(data + at, header.count);
+        for (std::uint32_t i = 0; i < header.count; ++i) {
+            if (validRow(columns, i)) indexEvent(entry, columns.event(i));
+        }
+        blocks.push_back(entry);
+        at += blockSize(header.count);
+    }
+}
+
+bool BattleLogReader::readNames(std::uint64_t offset, std::uint64_t end, NameTable& table) const {
+    auto read = [&](void* out, std::size_t bytes) {
+        if (bytes > end - offset) return false;
+        std::memcpy(out, data + offset, bytes);
+        offset += bytes;
+        return true;
+    };
+    std::uint64_t count = 0;
+    if (!read(&count, sizeof(count))) return false;
+    for (std::uint64_t i = 0; i < count; ++i) {
+        std::uint64_t key = 0;
+        std::uint32_t length = 0;
+        if (!read(&key, sizeof(key)) || !read(&length, sizeof(length)) || length > end - offset) return false;
+        std::string name(length, '\0');
+        read(name.data(), length);
+        table.set(EntityHandle{static_cast<std::uint32_t>(key), static_cast<std::uint32_t>(key >> 32)}, name);
+    }
+    return true;
+}
+
+std::uint64_t BattleLogReader::eventCount() const {
+    std::uint64_t total = 0;
+    for (const auto& block : blocks) total += block.count;
+    return total;
+}
+
+std::vector<EntityHandle> BattleLogReader::findByName(const std::string& name) const {
+    std::vector<EntityHandle> handles;
+    for (const auto& [handle, entry] : names.entries()) {
+        if (entry == name) handles.push_back(handle);
+    }
+    return handles;
+}
+
+BattleLogScan BattleLogReader::query(const BattleLogQuery& query) const {
+    BattleLogScan scan;
+    scan.blocksTotal = blocks.size();
+    bool byKiller = (query.killerTypes & ALL_NPC_TYPES) != ALL_NPC_TYPES;
+
+    for (const auto& block : blocks) {
+        // Блоки, которым запрос заведомо не подходит, не читаются
+        if (block.maxTick < query.fromTick || block.minTick > query.toTick) continue;
+        if (!(block.results & query.results)) continue;
+        if (byKiller && !(block.killerTypes & query.killerTypes)) continue;
+        if (!query.entities.empty() &&
+            std::none_of(query.entities.begin(), query.entities.end(),
+                         [&](EntityHandle handle) { return block.mayContain(handle); })) {
+            continue;
+        }
+        ++scan.blocksScanned;
+
+        BlockColumns columns(data + block.offset, block.count);
+        for (std::uint32_t i = 0; i < block.count; ++i) {
+            std::uint32_t tick = columns.ticks[i];
+            if (tick < query.fromTick || tick > query.toTick) continue;
+            if (!validRow(columns, i) || !(query.results & (1u << columns.results[i]))) continue;
+
+            BattleEvent event = columns.event(i);
+            if (byKiller && !(killerTypes(event) & query.killerTypes)) continue;
+            if (!query.entities.empty() &&
+                std::none_of(query.entities.begin(), query.entities.end(), [&](EntityHandle handle) {
+                    return event.attacker == handle || event.defender == handle;
+                })) {
+                continue;
+            }
+            scan.events.push_back(event);
+        }
+    }
+    return scan;
+}
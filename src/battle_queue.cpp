@@ -0,0 +1,176 @@
+#include "../include/battle_queue.h"
+#include <algorithm>
+#include <thread>
+
+BattleQueue::BattleQueue(size_t capacity, BackpressurePolicy policy)
+    : queue(capacity), policy(policy) {
+    // Таблица заполнена не больше чем наполовину: полная очередь помещается
+    // в нее без перестройки
+    size_t slots = 16;
+    while (slots < queue.capacity() * 2) slots *= 2;
+    pending.resize(slots);
+}
+
+BattleQueue::PendingPair BattleQueue::pairOf(const ThreadBattle& battle) {
+    std::uint64_t a = battle.attacker.packed();
+    std::uint64_t b = battle.defender.packed();
+    return PendingPair{std::min(a, b), std::max(a, b)};
+}
+
+size_t BattleQueue::pendingSlot(const PendingPair& pair) const {
+    std::uint64_t key = pair.low * 0x9E3779B97F4A7C15ull ^ pair.high;
+    key ^= key >> 29;
+    key *= 0xBF58476D1CE4E5B9ull;
+    key ^= key >> 32;
+    return static_cast<size_t>(key) & (pending.size() - 1);
+}
+
+bool BattleQueue::insertPending(const PendingPair& pair) {
+    if ((pendingCount + 1) * 2 > pending.size()) growPending();
+    size_t mask = pending.size() - 1;
+    for (size_t slot = pendingSlot(pair);; slot = (slot + 1) & mask) {
+        PendingPair& entry = pending[slot];
+        if (entry.low == EMPTY_PAIR) {
+            entry = pair;
+            ++pendingCount;
+            return true;
+        }
+        if (entry.low == pair.low && entry.high == pair.high) return false;
+    }
+}
+
+void BattleQueue::erasePending(const PendingPair& pair) {
+    size_t mask = pending.size() - 1;
+    size_t slot = pendingSlot(pair);
+    while (pending[slot].low != pair.low || pending[slot].high != pair.high) {
+        if (pending[slot].low == EMPTY_PAIR) return;
+        slot = (slot + 1) & mask;
+    }
+    // Сдвигаем назад хвост цепочки, чтобы поиск не обрывался на дыре
+    for (size_t next = (slot + 1) & mask; pending[next].low != EMPTY_PAIR; next = (next + 1) & mask) {
+        size_t home = pendingSlot(pending[next]);
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            pending[slot] = pending[next];
+            slot = next;
+        }
+    }
+    pending[slot] = PendingPair{};
+    --pendingCount;
+}
+
+void BattleQueue::growPending() {
+    // Block-производитель может отметить пачку больше очереди
+    std::vector<PendingPair> old(pending.size() * 2);
+    old.swap(pending);
+    pendingCount = 0;
+    for (const auto& pair : old) {
+        if (pair.low != EMPTY_PAIR) insertPending(pair);
+    }
+}
+
+void BattleQueue::releasePending(const ThreadBattle* battles, size_t count) {
+    if (count == 0) return;
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    for (size_t i = 0; i < count; ++i) {
+        erasePending(pairOf(battles[i]));
+    }
+}
+
+void BattleQueue::recordDepth() {
+    size_t current = queue.sizeApprox();
+    size_t seen = maxDepth.load(std::memory_order_relaxed);
+    while (current > seen &&
+           !maxDepth.compare_exchange_weak(seen, current, std::memory_order_relaxed)) {
+    }
+}
+
+size_t BattleQueue::pushBatch(const ThreadBattle* battles, size_t count) {
+    thread_local std::vector<ThreadBattle> accepted;
+    accepted.clear();
+
+    // Отсеиваем пары, которые уже ждут обработки
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        for (size_t i = 0; i < count; ++i) {
+            if (!insertPending(pairOf(battles[i]))) {
+                coalesced.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            accepted.push_back(battles[i]);
+        }
+    }
+
+    BackpressurePolicy mode = getPolicy();
+    size_t total = accepted.size();
+
+    if (mode == BackpressurePolicy::SkipTick &&
+        queue.capacity() - std::min(queue.capacity(), queue.sizeApprox()) < total) {
+        releasePending(accepted.data(), total);
+        dropped.fetch_add(total, std::memory_order_relaxed);
+        skippedTicks.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    size_t pushed = 0;
+    while (pushed < total) {
+        pushed += queue.tryPushBatch(accepted.data() + pushed, total - pushed);
+        if (pushed == total) break;
+
+        if (mode == BackpressurePolicy::DropOldest) {
+            ThreadBattle oldest[16];
+            size_t evicted = queue.tryPopBatch(oldest, std::min<size_t>(16, total - pushed));
+            releasePending(oldest, evicted);
+            dropped.fetch_add(evicted, std::memory_order_relaxed);
+        } else if (mode == BackpressurePolicy::Block && !isClosed()) {
+            std::this_thread::yield();
+        } else {
+            // SkipTick при гонке с другим производителем или закрытая очередь
+            releasePending(accepted.data() + pushed, total - pushed);
+            dropped.fetch_add(total - pushed, std::memory_order_relaxed);
+            break;
+        }
+    }
+
+    enqueued.fetch_add(pushed, std::memory_order_relaxed);
+    recordDepth();
+    return pushed;
+}
+
+size_t BattleQueue::popBatch(ThreadBattle* out, size_t maxCount) {
+    size_t popped = queue.tryPopBatch(out, maxCount);
+    releasePending(out, popped);
+    dequeued.fetch_add(popped, std::memory_order_relaxed);
+    return popped;
+}
+
+size_t BattleQueue::waitPopBatch(ThreadBattle* out, size_t maxCount,
+                                 std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    int spins = 0;
+
+    for (;;) {
+        size_t popped = popBatch(out, maxCount);
+        if (popped > 0 || isClosed() || std::chrono::steady_clock::now() >= deadline) {
+            return popped;
+        }
+        // Короткое ожидание без блокировок: сначала уступаем квант, потом спим
+        if (++spins < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+BattleQueueStats BattleQueue::stats() const {
+    BattleQueueStats result;
+    result.depth = queue.sizeApprox();
+    result.maxDepth = maxDepth.load(std::memory_order_relaxed);
+    result.capacity = queue.capacity();
+    result.enqueued = enqueued.load(std::memory_order_relaxed);
+    result.dequeued = dequeued.load(std::memory_order_relaxed);
+    result.dropped = dropped.load(std::memory_order_relaxed);
+    result.coalesced = coalesced.load(std::memory_order_relaxed);
+    result.skippedTicks = skippedTicks.load(std::memory_order_relaxed);
+    return result;
+}
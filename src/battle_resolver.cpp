@@ -0,0 +1,101 @@
+#include "../include/battle_resolver.h"
+#include <algorithm>
+#include <tuple>
+
+// Битв в одном задании: мелкие волны не стоит дробить сильнее
+static constexpr size_t BATTLE_GRAIN = 16;
+
+BattleResolver::BattleResolver(JobSystem& jobs, std::uint64_t seed)
+    : jobs(jobs), seed(seed), rng(seed) {}
+
+BattleResolver::BattleResolver(size_t workerCount, std::uint64_t seed)
+    : ownedJobs(std::make_unique<JobSystem>(workerCount)), jobs(*ownedJobs), seed(seed), rng(seed) {}
+
+std::pair<int, int> BattleResolver::rollDice(const CounterRng& rng, const ThreadBattle& battle) {
+    // Пара слотов однозначна в пределах тика: поколения меняются только между тиками
+    std::uint64_t pair = (std::uint64_t(battle.attacker.index) << 32) | battle.defender.index;
+    philox::Counter words = rng.draw(battle.tick, pair, RandomPurpose::Dice);
+    return {static_cast<int>(philox::below(words[0], 6)) + 1,
+            static_cast<int>(philox::below(words[1], 6)) + 1};
+}
+
+void BattleResolver::fight(NPCStore& npcs, const ThreadBattle& battle,
+                           BattleOutcome& outcome) const {
+    outcome = BattleOutcome{};
+
+    // Устаревший дескриптор: участник уже убит и его слот освобожден
+    auto attacker = npcs.resolve(battle.attacker);
+    auto defender = npcs.resolve(battle.defender);
+    if (!attacker || !defender) return;
+
+    outcome.attacker = *attacker;
+    outcome.defender = *defender;
+
+    // Проверяем, что оба еще живы и могут сражаться
+    if (!npcs.isAlive(*attacker) || !npcs.isAlive(*defender)) return;
+    if (!npcs.canAttack(*attacker, *defender)) return;
+
+    // Бросаем 6-гранные кубики
+    outcome.fought = true;
+    std::tie(outcome.attackRoll, outcome.defenseRoll) = rollDice(rng, battle);
+
+    if (outcome.attackRoll > outcome.defenseRoll) {
+        // Защитника может одновременно убить только один поток
+        outcome.killed = npcs.tryKill(*defender);
+    }
+}
+
+void BattleResolver::resolve(NPCStore& npcs, const ThreadBattle* battles, size_t count,
+                             std::vector<BattleOutcome>& outcomes) {
+    outcomes.resize(count);
+    waveOf.resize(count);
+    if (lastWave.size() < npcs.size()) {
+        lastWave.resize(npcs.size(), 0);
+    }
+
+    // Жадная раскладка: битва идет в волну, следующую за последними
+    // волнами обоих участников
+    waveCount = 0;
+    for (size_t k = 0; k < count; ++k) {
+        std::uint32_t a = battles[k].attacker.index;
+        std::uint32_t d = battles[k].defender.index;
+        std::uint32_t wave = 0;
+        if (a < lastWave.size() && d < lastWave.size()) {
+            wave = std::max(lastWave[a], lastWave[d]);
+            lastWave[a] = lastWave[d] = wave + 1;
+        }
+        waveOf[k] = wave;
+        waveCount = std::max<size_t>(waveCount, wave + 1);
+    }
+    for (size_t k = 0; k < count; ++k) {
+        std::uint32_t a = battles[k].attacker.index;
+        std::uint32_t d = battles[k].defender.index;
+        if (a < lastWave.size()) lastWave[a] = 0;
+        if (d < lastWave.size()) lastWave[d] = 0;
+    }
+
+    // Сортировка подсчетом: битвы каждой волны подряд, в исходном порядке
+    waveStart.assign(waveCount + 1, 0);
+    for (size_t k = 0; k < count; ++k) {
+        ++waveStart[waveOf[k] + 1];
+    }
+    for (size_t w = 0; w < waveCount; ++w) {
+        waveStart[w + 1] += waveStart[w];
+    }
+    waveOrder.resize(count);
+    waveFill.assign(waveStart.begin(), waveStart.end() - 1);
+    for (size_t k = 0; k < count; ++k) {
+        waveOrder[waveFill[waveOf[k]]++] = static_cast<std::uint32_t>(k);
+    }
+
+    for (size_t w = 0; w < waveCount; ++w) {
+        const std::uint32_t* wave = waveOrder.data() + waveStart[w];
+        size_t waveSize = waveStart[w + 1] - waveStart[w];
+        jobs.parallelFor(waveSize, BATTLE_GRAIN, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                std::uint32_t k = wave[i];
+                fight(npcs, battles[k], outcomes[k]);
+            }
+        });
+    }
+}
@@ -0,0 +1,161 @@
+#include "../include/chunk_map.h"
+#include <cmath>
+
+ChunkMap::ChunkMap(float chunkSize)
+    : chunkSize(chunkSize), invChunkSize(1.0f / chunkSize) {}
+
+ChunkMap::ChunkKey ChunkMap::keyFor(float x, float y) const {
+    auto cx = static_cast<std::int32_t>(std::floor(x * invChunkSize));
+    auto cy = static_cast<std::int32_t>(std::floor(y * invChunkSize));
+    return makeKey(cx, cy);
+}
+
+void ChunkMap::attach(Id id, ChunkKey key) {
+    auto result = chunks.try_emplace(key);
+    Chunk& chunk = result.first->second;
+    if (result.second) {
+        chunk.cx = static_cast<std::int32_t>(key >> 32);
+        chunk.cy = static_cast<std::int32_t>(key & 0xffffffffu);
+        collectAround(chunk);
+        wake(chunk);
+        activeDirty = true;
+    }
+
+    chunkOf[id] = key;
+    slotOf[id] = static_cast<std::uint32_t>(chunk.members.size());
+    chunk.members.push_back(id);
+    addTag(chunk, key, tagOf[id]);
+}
+
+void ChunkMap::detach(Id id) {
+    auto it = chunks.find(chunkOf[id]);
+    Chunk& chunk = it->second;
+    auto& members = chunk.members;
+    std::uint32_t slot = slotOf[id];
+    removeTag(chunk, it->first, tagOf[id]);
+
+    members[slot] = members.back();
+    slotOf[members[slot]] = slot;
+    members.pop_back();
+    slotOf[id] = NO_SLOT;
+
+    // Пустые чанки не храним
+    if (members.empty()) {
+        dropAwake(chunk);
+        chunks.erase(it);
+        activeDirty = true;
+    }
+}
+
+void ChunkMap::insert(Id id, float x, float y, Tag tag) {
+    if (contains(id)) return;
+    if (id >= slotOf.size()) {
+        slotOf.resize(id + 1, NO_SLOT);
+        chunkOf.resize(id + 1, 0);
+        tagOf.resize(id + 1, 0);
+    }
+    tagOf[id] = tag;
+    attach(id, keyFor(x, y));
+    ++count;
+}
+
+void ChunkMap::remove(Id id) {
+    if (!contains(id)) return;
+    detach(id);
+    --count;
+}
+
+bool ChunkMap::update(Id id, float newX, float newY) {
+    ChunkKey newKey = keyFor(newX, newY);
+    if (!contains(id)) {
+        insert(id, newX, newY, id < tagOf.size() ? tagOf[id] : 0);
+        return true;
+    }
+    if (chunkOf[id] == newKey) return false;
+
+    // Простой переходит вместе с NPC: переход в соседний чанк не будит его
+    std::uint32_t idleTicks = chunks.find(chunkOf[id])->second.idleTicks;
+    bool created = chunks.count(newKey) == 0;
+    detach(id);
+    attach(id, newKey);
+    Chunk& chunk = chunks.find(newKey)->second;
+    chunk.idleTicks = created ? idleTicks : std::min(chunk.idleTicks, idleTicks);
+    return true;
+}
+
+const ChunkMap::Chunk* ChunkMap::find(std::int32_t cx, std::int32_t cy) const {
+    auto it = chunks.find(makeKey(cx, cy));
+    return it == chunks.end() ? nullptr : &it->second;
+}
+
+void ChunkMap::updateAround(const Chunk& chunk, Tag tag, bool present) {
+    std::uint32_t bit = std::uint32_t(1) << tag;
+    for (std::int32_t dy = -1; dy <= 1; ++dy) {
+        for (std::int32_t dx = -1; dx <= 1; ++dx) {
+            if (dx == 0 && dy == 0) continue;
+            auto it = chunks.find(makeKey(chunk.cx + dx, chunk.cy + dy));
+            if (it == chunks.end()) continue;
+
+            Chunk& other = it->second;
+            if (present) {
+                if (other.aroundCounts[tag]++ == 0) other.around |= bit;
+                if (other.asleep) wakeCandidates.push_back(it->first);
+            } else if (--other.aroundCounts[tag] == 0) {
+                other.around &= ~bit;
+            }
+        }
+    }
+}
+
+void ChunkMap::collectAround(Chunk& chunk) {
+    for (std::int32_t dy = -1; dy <= 1; ++dy) {
+        for (std::int32_t dx = -1; dx <= 1; ++dx) {
+            if (dx == 0 && dy == 0) continue;
+            const Chunk* other = find(chunk.cx + dx, chunk.cy + dy);
+            if (!other) continue;
+            for (size_t tag = 0; tag < MAX_TAGS; ++tag) {
+                if (!(other->mask >> tag & 1)) continue;
+                if (chunk.aroundCounts[tag]++ == 0) chunk.around |= std::uint32_t(1) << tag;
+            }
+        }
+    }
+}
+
+bool ChunkMap::isInChunk(Id id, float x, float y) const {
+    return contains(id) && chunkOf[id] == keyFor(x, y);
+}
+
+void ChunkMap::clear() {
+    chunks.clear();
+    chunkOf.clear();
+    slotOf.clear();
+    tagOf.clear();
+    tagTotals.fill(0);
+    wakeCandidates.clear();
+    awake.clear();
+    count = 0;
+    activeDirty = true;
+}
+
+const std::vector<const ChunkMap::Chunk*>& ChunkMap::activeChunks() const {
+    if (activeDirty) {
+        active.clear();
+        active.reserve(chunks.size());
+        for (const auto& entry : chunks) {
+            active.push_back(&entry.second);
+        }
+        activeDirty = false;
+    }
+    return active;
+}
+
+size_t ChunkMap::memoryBytes() const {
+    size_t bytes = chunks.bucket_count() * sizeof(void*) +
+                   chunks.size() * (sizeof(Chunk) + sizeof(ChunkKey) + 2 * sizeof(void*)) +
+                   chunkOf.capacity() * sizeof(ChunkKey) + slotOf.capacity() * sizeof(std::uint32_t) +
+                   tagOf.capacity() * sizeof(Tag);
+    for (const auto& entry : chunks) {
+        bytes += entry.second.members.capacity() * sizeof(Id);
+    }
+    return bytes;
+}
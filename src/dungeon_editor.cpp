@@ -1,74 +1,61 @@
 #include "../include/dungeon_editor.h"
+#include "../include/simd_kernels.h"
+#include "../include/alloc_tracker.h"
 #include <fstream>
 #include <iostream>
 #include <algorithm>
 
 
-BattleVisitor::BattleVisitor(float range, BattleNotifier& notifier, 
-                           std::vector<std::unique_ptr<NPC>>& npcs)
-    : battleRange(range), notifier(notifier), npcs(npcs), currentAttacker(nullptr) {}
-
-void BattleVisitor::setCurrentAttacker(NPC* attacker) {
-    currentAttacker = attacker;
-}
-
-void BattleVisitor::visit(Orc& orc) {
-    if (currentAttacker) {
-        performBattle(*currentAttacker, orc);
-    }
+BattleVisitor::BattleVisitor(float range, BattleNotifier& notifier, NPCStore& npcs)
+    : currentAttacker(0), hasAttacker(false), battleRange(range), 
+      notifier(notifier), npcs(npcs) {
+    markedForRemoval.reserve(2);
 }
 
-void BattleVisitor::visit(Knight& knight) {
-    if (currentAttacker) {
-        performBattle(*currentAttacker, knight);
-    }
+void BattleVisitor::setCurrentAttacker(NPCStore::Index attacker) {
+    currentAttacker = attacker;
+    hasAttacker = true;
 }
 
-void BattleVisitor::visit(Bear& bear) {
-    if (currentAttacker) {
-        performBattle(*currentAttacker, bear);
+void BattleVisitor::visit(NPCView defender) {
+    if (hasAttacker) {
+        performBattle(npcs.view(currentAttacker), defender);
     }
 }
 
-void BattleVisitor::performBattle(NPC& attacker, NPC& defender) {
+void BattleVisitor::performBattle(NPCView attacker, NPCView defender) {
 
     bool attackerWins = attacker.canAttack(defender);
     bool defenderWins = defender.canAttack(attacker);
+    if (!attackerWins && !defenderWins) return;
     
-    std::string result;
+    BattleEvent event;
+    event.attacker = attacker.getHandle();
+    event.defender = defender.getHandle();
+    event.attackerType = attacker.getTypeId();
+    event.defenderType = defender.getTypeId();
+    event.tick = round;
+    event.x = defender.getX();
+    event.y = defender.getY();
     
     if (attackerWins && !defenderWins) {
-   
-        result = attacker.getType() + " " + attacker.getName() + 
-                 " kills " + defender.getType() + " " + defender.getName();
-        notifier.notifyObservers(result);
-        
-   
-        markedForRemoval.insert(&defender);
+        event.result = BattleResult::AttackerKills;
+        markedForRemoval.push_back(defender.getIndex());
     }
     else if (!attackerWins && defenderWins) {
-    
-        result = defender.getType() + " " + defender.getName() + 
-                 " kills " + attacker.getType() + " " + attacker.getName();
-        notifier.notifyObservers(result);
-    
-        markedForRemoval.insert(&attacker);
+        event.result = BattleResult::DefenderKills;
+        markedForRemoval.push_back(attacker.getIndex());
     }
-    else if (attackerWins && defenderWins) {
- 
-        result = attacker.getType() + " " + attacker.getName() + 
-                 " and " + defender.getType() + " " + defender.getName() + 
-                 " kill each other";
-        notifier.notifyObservers(result);
-        
-       
-        markedForRemoval.insert(&attacker);
-        markedForRemoval.insert(&defender);
+    else {
+        event.result = BattleResult::BothDie;
+        markedForRemoval.push_back(attacker.getIndex());
+        markedForRemoval.push_back(defender.getIndex());
     }
+    notifier.notifyObservers(event);
 }
 
-std::unordered_set<NPC*> BattleVisitor::getMarkedForRemoval() const {
-    return markedForRemoval;
+std::unordered_set<NPCStore::Index> BattleVisitor::getMarkedForRemoval() const {
+    return {markedForRemoval.begin(), markedForRemoval.end()};
 }
 
 void BattleVisitor::clearMarkedForRemoval() {
@@ -80,41 +67,66 @@ DungeonEditor::DungeonEditor() {
     fileLogger = std::make_shared<FileLogger>();
     consoleLogger = std::make_shared<ConsoleLogger>();
     
-    notifier.addObserver(fileLogger);
-    notifier.addObserver(consoleLogger);
+    notifier.setNames(&names);
+    // Логгеры работают в потоке уведомлений и не задерживают бой. Поток
+    // появится, когда startBattle подпишет логгеры
+    notifier.startAsync();
 }
 
 bool DungeonEditor::addNPC(const std::string& type, const std::string& name, float x, float y) {
+    return spawnNPC(type, name, x, y).isValid();
+}
+
+EntityHandle DungeonEditor::spawnNPC(const std::string& type, const std::string& name, 
+                                     float x, float y) {
     try {
-        auto npc = NPCFactory::createNPC(type, name, x, y);
-        npcs.push_back(std::move(npc));
-        return true;
+        // Фабрика проверяет тип и координаты
+        EntityHandle handle = npcs.handleOf(npcs.add(NPCFactory::createNPCValue(type, name, x, y, bounds)));
+        names.set(handle, name);
+        return handle;
     } catch (const std::exception& e) {
         std::cerr << "Error adding NPC: " << e.what() << std::endl;
-        return false;
+        return EntityHandle{};
     }
 }
 
+bool DungeonEditor::removeNPC(EntityHandle handle) {
+    auto index = npcs.resolve(handle);
+    if (!index) return false;
+    
+    npcs.release(*index);
+    return true;
+}
+
+std::optional<NPCView> DungeonEditor::findNPC(EntityHandle handle) {
+    auto index = npcs.resolve(handle);
+    if (!index) return std::nullopt;
+    return npcs.view(*index);
+}
+
 void DungeonEditor::printNPCs() const {
     std::cout << "NPC List:" << std::endl;
     std::cout << "---------" << std::endl;
-    for (const auto& npc : npcs) {
-        std::cout << "Type: " << npc->getType() 
-                  << ", Name: " << npc->getName()
-                  << ", Position: (" << npc->getX() << ", " << npc->getY() << ")"
-                  << ", Alive: " << (npc->isAlive() ? "Yes" : "No")
+    for (NPCStore::Index i = 0; i < npcs.size(); ++i) {
+        if (!npcs.isUsed(i)) continue;
+        std::cout << "Type: " << npcs.getTraits(i).name 
+                  << ", Name: " << npcs.getName(i)
+                  << ", Position: (" << npcs.getX(i) << ", " << npcs.getY(i) << ")"
+                  << ", Alive: " << (npcs.isAlive(i) ? "Yes" : "No")
                   << std::endl;
     }
 }
 
 bool DungeonEditor::saveToFile(const std::string& filename) const {
+    ScopedAllocTag tag(AllocTag::IO);
     std::ofstream file(filename);
     if (!file.is_open()) {
         return false;
     }
     
-    for (const auto& npc : npcs) {
-        file << NPCFactory::serializeNPC(*npc) << std::endl;
+    for (NPCStore::Index i = 0; i < npcs.size(); ++i) {
+        if (!npcs.isUsed(i)) continue;
+        file << NPCFactory::serializeNPC(npcs, i) << std::endl;
     }
     
     file.close();
@@ -122,6 +134,7 @@ bool DungeonEditor::saveToFile(const std::string& filename) const {
 }
 
 bool DungeonEditor::loadFromFile(const std::string& filename) {
+    ScopedAllocTag tag(AllocTag::IO);
     std::ifstream file(filename);
     if (!file.is_open()) {
         return false;
@@ -133,8 +146,8 @@ bool DungeonEditor::loadFromFile(const std::string& filename) {
     while (std::getline(file, line)) {
         if (!line.empty()) {
             try {
-                auto npc = NPCFactory::createNPCFromString(line);
-                npcs.push_back(std::move(npc));
+                auto index = npcs.add(NPCFactory::createNPCValueFromString(line, bounds));
+                names.set(npcs.handleOf(index), npcs.getName(index));
             } catch (const std::exception& e) {
                 std::cerr << "Error loading NPC: " << e.what() << std::endl;
             }
@@ -146,42 +159,54 @@ bool DungeonEditor::loadFromFile(const std::string& filename) {
 }
 
 void DungeonEditor::startBattle(float range) {
+    ScopedAllocTag tag(AllocTag::Battle);
     std::cout << "Starting battle with range: " << range << std::endl;
+    // Подписка при первом бое: редактор без боев не держит потоков и файлов
+    if (notifier.subscriptionCount() == 0) {
+        notifier.addObserver(fileLogger);
+        notifier.addObserver(consoleLogger);
+    }
     
-    std::unordered_set<NPC*> killedNPCs;
     bool battleOccurred;
+    std::uint32_t round = 0;
+    BattleVisitor visitor(range, notifier, npcs);
     
     do {
         battleOccurred = false;
-        BattleVisitor visitor(range, notifier, npcs);
+        visitor.setRound(round++);
     
-        for (size_t i = 0; i < npcs.size(); ++i) {
-            auto& attacker = npcs[i];
-            if (!attacker) continue;
-            if (!attacker->isAlive()) continue;
-            if (killedNPCs.find(attacker.get()) != killedNPCs.end()) {
-                continue;
-            }
+        for (NPCStore::Index i = 0; i < npcs.size(); ++i) {
+            if (!npcs.isAlive(i)) continue;
             
-            visitor.setCurrentAttacker(attacker.get());
+            NPCView attacker = npcs.view(i);
+            visitor.setCurrentAttacker(i);
             
-            for (size_t j = i + 1; j < npcs.size(); ++j) {
-                auto& defender = npcs[j];
-                if (!defender) continue;
-                if (!defender->isAlive()) continue;
+            // Кандидаты j > i проверяются блоками по квадрату расстояния
+            for (size_t start = i + 1; start < npcs.size(); start += SimdKernels::MASK_BLOCK) {
+                // Атакующий мог погибнуть в одном из предыдущих боев
+                if (!npcs.isAlive(i)) break;
                 
-                if (killedNPCs.find(defender.get()) != killedNPCs.end()) {
-                    continue;
-                }
+                size_t count = std::min(SimdKernels::MASK_BLOCK, npcs.size() - start);
+                std::uint64_t inRange = SimdKernels::withinRadiusMask(
+                    attacker.getX(), attacker.getY(),
+                    npcs.xData() + start, npcs.yData() + start, count, range);
                 
-                // Проверяем дистанцию и возможность атаки
-                if (attacker->isInRange(*defender, range) && 
-                    attacker->canAttack(*defender)) {
-                    defender->accept(visitor);
+                while (inRange && npcs.isAlive(i)) {
+                    auto j = static_cast<NPCStore::Index>(start + SimdKernels::lowestBit(inRange));
+                    inRange &= inRange - 1;
+                    
+                    if (!npcs.isAlive(j)) continue;
                     
-                    auto newlyKilled = visitor.getMarkedForRemoval();
+                    NPCView defender = npcs.view(j);
+                    if (!attacker.canAttack(defender)) continue;
+                    
+                    visitor.visit(defender);
+                    
+                    const auto& newlyKilled = visitor.markedList();
                     if (!newlyKilled.empty()) {
-                        killedNPCs.insert(newlyKilled.begin(), newlyKilled.end());
+                        for (auto index : newlyKilled) {
+                            npcs.kill(index);
+                        }
                         battleOccurred = true;
                         visitor.clearMarkedForRemoval();
                     }
@@ -190,34 +215,34 @@ void DungeonEditor::startBattle(float range) {
         }
     } while (battleOccurred);
     
-    // Удаляем убитых NPC
-    if (!killedNPCs.empty()) {
-        npcs.erase(
-            std::remove_if(npcs.begin(), npcs.end(),
-                [&killedNPCs](const std::unique_ptr<NPC>& npc) {
-                    return npc && killedNPCs.find(npc.get()) != killedNPCs.end();
-                }),
-            npcs.end()
-        );
-    }
+    // Освобождаем слоты убитых NPC; дескрипторы выживших остаются в силе
+    npcs.releaseDead();
+    notifier.flush();
     
-    std::cout << "Battle finished. Remaining NPCs: " << npcs.size() << std::endl;
+    std::cout << "Battle finished. Remaining NPCs: " << getNPCCount() << std::endl;
 }
 
 size_t DungeonEditor::getNPCCount() const {
-    return npcs.size();
+    return npcs.size() - npcs.freeSlotCount();
 }
 
-const std::vector<std::unique_ptr<NPC>>& DungeonEditor::getNPCs() const {
+const NPCStore& DungeonEditor::getNPCs() const {
     return npcs;
 }
 
+NPCStore& DungeonEditor::getNPCs() {
+    return npcs;
+}
+
+NPCView DungeonEditor::getNPC(size_t index) {
+    return npcs.view(static_cast<NPCStore::Index>(index));
+}
 
-std::vector<NPC*> DungeonEditor::getAliveNPCs() const {
-    std::vector<NPC*> aliveNPCs;
-    for (const auto& npc : npcs) {
-        if (npc && npc->isAlive()) {
-            aliveNPCs.push_back(npc.get());
+std::vector<NPCView> DungeonEditor::getAliveNPCs() {
+    std::vector<NPCView> aliveNPCs;
+    for (NPCStore::Index i = 0; i < npcs.size(); ++i) {
+        if (npcs.isAlive(i)) {
+            aliveNPCs.push_back(npcs.view(i));
         }
     }
     return aliveNPCs;
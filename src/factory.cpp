@@ -2,25 +2,54 @@
 #include <sstream>
 #include <stdexcept>
 
-std::unique_ptr<NPC> NPCFactory::createNPC(const std::string& type, 
-                                          const std::string& name, 
-                                          float x, float y) {
-    if (x < 0 || x > 500 || y < 0 || y > 500) {
-        throw std::invalid_argument("Coordinates must be in range 0-500");
+// Общая проверка аргументов фабрики; возвращает тег типа
+static NPCType validateNPC(const std::string& type, float x, float y, const WorldBounds& bounds) {
+    if (!bounds.contains(x, y)) {
+        throw std::invalid_argument("Coordinates must be in range " + bounds.describe());
     }
     
-    if (type == "Orc") {
-        return std::make_unique<Orc>(name, x, y);
-    } else if (type == "Knight") {
-        return std::make_unique<Knight>(name, x, y);
-    } else if (type == "Bear") {
-        return std::make_unique<Bear>(name, x, y);
-    } else {
+    NPCType typeId;
+    if (!parseNPCType(type, typeId)) {
         throw std::invalid_argument("Unknown NPC type: " + type);
     }
+    return typeId;
+}
+
+std::unique_ptr<NPC> NPCFactory::createNPC(const std::string& type, 
+                                          const std::string& name, 
+                                          float x, float y,
+                                          const WorldBounds& bounds) {
+    // Конструктор выбирается по таблице, построенной из NPCTypeList
+    return visitNPCType(validateNPC(type, x, y, bounds), [&](auto tag) -> std::unique_ptr<NPC> {
+        return std::make_unique<typename decltype(tag)::type>(name, x, y);
+    });
+}
+
+NPCVariant NPCFactory::createNPCValue(const std::string& type, 
+                                      const std::string& name, 
+                                      float x, float y,
+                                      const WorldBounds& bounds) {
+    return visitNPCType(validateNPC(type, x, y, bounds), [&](auto tag) -> NPCVariant {
+        using T = typename decltype(tag)::type;
+        return NPCVariant(std::in_place_type<T>, name, x, y);
+    });
+}
+
+std::unique_ptr<NPC> NPCFactory::createNPCFromString(const std::string& data,
+                                                     const WorldBounds& bounds) {
+    std::istringstream iss(data);
+    std::string type, name;
+    float x, y;
+    
+    if (!(iss >> type >> name >> x >> y)) {
+        throw std::invalid_argument("Invalid NPC data format");
+    }
+    
+    return createNPC(type, name, x, y, bounds);
 }
 
-std::unique_ptr<NPC> NPCFactory::createNPCFromString(const std::string& data) {
+NPCVariant NPCFactory::createNPCValueFromString(const std::string& data,
+                                                const WorldBounds& bounds) {
     std::istringstream iss(data);
     std::string type, name;
     float x, y;
@@ -29,7 +58,7 @@ std::unique_ptr<NPC> NPCFactory::createNPCFromString(const std::string& data) {
         throw std::invalid_argument("Invalid NPC data format");
     }
     
-    return createNPC(type, name, x, y);
+    return createNPCValue(type, name, x, y, bounds);
 }
 
 std::string NPCFactory::serializeNPC(const NPC& npc) {
@@ -38,3 +67,10 @@ std::string NPCFactory::serializeNPC(const NPC& npc) {
         << npc.getX() << " " << npc.getY();
     return oss.str();
 }
+
+std::string NPCFactory::serializeNPC(const NPCStore& store, NPCStore::Index index) {
+    std::ostringstream oss;
+    oss << store.getTraits(index).name << " " << store.getName(index) << " " 
+        << store.getX(index) << " " << store.getY(index);
+    return oss.str();
+}
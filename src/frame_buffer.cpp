@@ -0,0 +1,93 @@
+#include "../include/frame_buffer.h"
+#include <thread>
+
+void FrameBuffer::ReadGuard::release() {
+    if (owner) {
+        owner->pins[index].fetch_sub(1, std::memory_order_release);
+        owner = nullptr;
+    }
+}
+
+void FrameBuffer::addWait(std::atomic<std::int64_t>& total, std::atomic<std::int64_t>& max,
+                          std::chrono::nanoseconds wait) {
+    std::int64_t value = wait.count();
+    total.fetch_add(value, std::memory_order_relaxed);
+    std::int64_t seen = max.load(std::memory_order_relaxed);
+    while (value > seen && !max.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+FrameBuffer::ReadGuard FrameBuffer::acquire() {
+    auto begin = std::chrono::steady_clock::now();
+
+    for (;;) {
+        int index = front.load(std::memory_order_seq_cst);
+        pins[index].fetch_add(1, std::memory_order_seq_cst);
+
+        // Кадр мог смениться между чтением front и закреплением: тогда
+        // писатель мог уже начать его перезапись, пробуем снова
+        if (front.load(std::memory_order_seq_cst) == index) {
+            reads.fetch_add(1, std::memory_order_relaxed);
+            addWait(readWaitTotal, readWaitMax,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - begin));
+            return ReadGuard(this, index);
+        }
+
+        pins[index].fetch_sub(1, std::memory_order_release);
+        readRetries.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void FrameBuffer::publish(const NPCStore& npcs, std::uint32_t tick,
+                          const std::array<size_t, NPC_TYPE_COUNT>& typeCounts,
+                          size_t aliveCount) {
+    int back = 1 - front.load(std::memory_order_relaxed);
+
+    // Ждем читателей, закрепивших задний кадр, пока он был передним
+    auto begin = std::chrono::steady_clock::now();
+    while (pins[back].load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+    }
+    addWait(writeWaitTotal, writeWaitMax,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - begin));
+
+    WorldFrame& frame = frames[back];
+    size_t count = npcs.size();
+    frame.tick = tick;
+    frame.xs.assign(npcs.xData(), npcs.xData() + count);
+    frame.ys.assign(npcs.yData(), npcs.yData() + count);
+    frame.types.assign(npcs.typeData(), npcs.typeData() + count);
+    frame.alive.resize(count);
+    for (NPCStore::Index i = 0; i < count; ++i) {
+        frame.alive[i] = npcs.isAlive(i);
+    }
+
+    // Имена меняются только при добавлении NPC, поэтому обычно не копируются
+    if (frame.nameVersion != npcs.getNameVersion() || frame.names.size() != count) {
+        frame.names.resize(count);
+        for (NPCStore::Index i = 0; i < count; ++i) {
+            frame.names[i] = npcs.getName(i);
+        }
+        frame.nameVersion = npcs.getNameVersion();
+    }
+
+    frame.typeCounts = typeCounts;
+    frame.aliveCount = aliveCount;
+
+    front.store(back, std::memory_order_seq_cst);
+    publishes.fetch_add(1, std::memory_order_relaxed);
+}
+
+FrameBufferStats FrameBuffer::stats() const {
+    FrameBufferStats result;
+    result.publishes = publishes.load(std::memory_order_relaxed);
+    result.reads = reads.load(std::memory_order_relaxed);
+    result.readRetries = readRetries.load(std::memory_order_relaxed);
+    result.readWaitTotal = std::chrono::nanoseconds(readWaitTotal.load(std::memory_order_relaxed));
+    result.readWaitMax = std::chrono::nanoseconds(readWaitMax.load(std::memory_order_relaxed));
+    result.writeWaitTotal = std::chrono::nanoseconds(writeWaitTotal.load(std::memory_order_relaxed));
+    result.writeWaitMax = std::chrono::nanoseconds(writeWaitMax.load(std::memory_order_relaxed));
+    return result;
+}
@@ -0,0 +1,140 @@
+#include "../include/game_config.h"
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+
+std::uint64_t GameConfig::totalTicks() const {
+    if (tickCount > 0) return tickCount;
+    return static_cast<std::uint64_t>(std::llround(duration * tickRate));
+}
+
+std::chrono::nanoseconds GameConfig::tickInterval() const {
+    return std::chrono::nanoseconds(static_cast<std::int64_t>(1e9 / tickRate));
+}
+
+namespace {
+
+// Значение после флага; бросает, если его нет или оно не число
+template <typename T>
+T parseValue(int& i, int argc, const char* const* argv) {
+    std::string flag = argv[i];
+    if (i + 1 >= argc) throw std::invalid_argument("missing value for " + flag);
+    std::string text = argv[++i];
+    try {
+        size_t used = 0;
+        T value;
+        if constexpr (std::is_floating_point<T>::value) {
+            value = static_cast<T>(std::stod(text, &used));
+        } else if constexpr (std::is_signed<T>::value) {
+            value = static_cast<T>(std::stoll(text, &used));
+        } else {
+            if (!text.empty() && text[0] == '-') throw std::invalid_argument(text);
+            value = static_cast<T>(std::stoull(text, &used));
+        }
+        if (used != text.size()) throw std::invalid_argument(text);
+        return value;
+    } catch (const std::logic_error&) {
+        throw std::invalid_argument("invalid value '" + text + "' for " + flag);
+    }
+}
+
+}  // namespace
+
+GameConfig GameConfig::fromArgs(int argc, const char* const* argv) {
+    GameConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--headless") {
+            config.headless = true;
+        } else if (arg == "--ticks") {
+            config.tickCount = parseValue<std::uint64_t>(i, argc, argv);
+        } else if (arg == "--duration") {
+            config.duration = parseValue<double>(i, argc, argv);
+        } else if (arg == "--tick-rate") {
+            config.tickRate = parseValue<double>(i, argc, argv);
+        } else if (arg == "--width") {
+            config.mapWidth = parseValue<int>(i, argc, argv);
+        } else if (arg == "--height") {
+            config.mapHeight = parseValue<int>(i, argc, argv);
+        } else if (arg == "--scenario") {
+            if (i + 1 >= argc) throw std::invalid_argument("missing value for --scenario");
+            std::string name = argv[++i];
+            auto kind = ScenarioGenerator::parse(name);
+            if (!kind) throw std::invalid_argument("unknown scenario '" + name + "'");
+            config.scenario = *kind;
+        } else if (arg == "--npcs") {
+            config.npcCount = parseValue<int>(i, argc, argv);
+        } else if (arg == "--workers") {
+            config.workerCount = parseValue<size_t>(i, argc, argv);
+        } else if (arg == "--seed") {
+            config.seed = parseValue<std::uint64_t>(i, argc, argv);
+        } else if (arg == "--metrics") {
+            if (i + 1 >= argc) throw std::invalid_argument("missing value for --metrics");
+            config.metricsPath = argv[++i];
+        } else if (arg == "--alloc-report") {
+            config.allocReport = true;
+        } else if (arg == "--battle-log") {
+            if (i + 1 >= argc) throw std::invalid_argument("missing value for --battle-log");
+            std::string mode = argv[++i];
+            if (mode != "summary" && mode != "verbose") {
+                throw std::invalid_argument("unknown battle log mode '" + mode + "'");
+            }
+            config.verboseBattles = mode == "verbose";
+        } else if (arg == "--battle-sample") {
+            config.battleSample = parseValue<std::uint32_t>(i, argc, argv);
+        } else if (arg == "--battle-rate") {
+            config.battleRate = parseValue<std::uint32_t>(i, argc, argv);
+        } else if (arg == "--battle-record") {
+            if (i + 1 >= argc) throw std::invalid_argument("missing value for --battle-record");
+            config.battleRecordPath = argv[++i];
+        } else if (arg == "--shm-name") {
+            if (i + 1 >= argc) throw std::invalid_argument("missing value for --shm-name");
+            config.shmName = argv[++i];
+            if (config.shmName.size() < 2 || config.shmName[0] != '/' ||
+                config.shmName.find('/', 1) != std::string::npos) {
+                throw std::invalid_argument("--shm-name must look like /name");
+            }
+        } else if (arg == "--no-shm") {
+            config.sharedSnapshot = false;
+        } else {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+
+    if (config.tickRate <= 0) throw std::invalid_argument("--tick-rate must be positive");
+    if (config.duration < 0) throw std::invalid_argument("--duration must not be negative");
+    if (config.mapWidth <= 0 || config.mapHeight <= 0) {
+        throw std::invalid_argument("--width and --height must be positive");
+    }
+    if (config.npcCount < 0) throw std::invalid_argument("--npcs must not be negative");
+    if (config.battleSample == 0) throw std::invalid_argument("--battle-sample must be positive");
+    return config;
+}
+
+std::string GameConfig::usage(const std::string& program) {
+    return "Usage: " + program + " [options]\n"
+           "  --headless          run ticks back to back without output or sleeps\n"
+           "  --ticks N           number of ticks (overrides --duration)\n"
+           "  --duration S        simulated seconds (default 30)\n"
+           "  --tick-rate R       ticks per simulated second (default 10)\n"
+           "  --width W           map width (default 100)\n"
+           "  --height H          map height (default 100)\n"
+           "  --npcs N            initial NPC count (default 50)\n"
+           "  --scenario NAME     initial placement: uniform (default), clusters,\n"
+           "                      one-cell, single-type, balanced\n"
+           "  --workers N         job system threads (default: hardware concurrency)\n"
+           "  --seed S            random seed (default: random)\n"
+           "  --battle-log MODE   battles on the console: summary (default, once\n"
+           "                      a second) or verbose (a line per battle)\n"
+           "  --battle-sample N   verbose: print every N-th battle\n"
+           "  --battle-rate N     verbose: at most N battle lines a second\n"
+           "  --battle-record F   write every battle to binary log F, also in\n"
+           "                      headless mode (query with battle_log_query)\n"
+           "  --shm-name /NAME    shared memory segment (default /laba7_world);\n"
+           "                      one per running game, pass it to world_viewer\n"
+           "  --no-shm            do not publish frames to shared memory\n"
+           "  --metrics FILE      collect metrics and write them at exit\n"
+           "                      (FILE.json - JSON, otherwise Prometheus text)\n"
+           "  --alloc-report      print allocations per subsystem at exit\n"
+           "                      (needs a build with -DALLOC_TRACKING=ON)\n";
+}
@@ -6,10 +6,60 @@
 #include <thread>
 #include <sstream>
 #include <map>
-#include <unordered_set>
 
-GameManager::GameManager() : gen(rd()), diceDist(1, 6), lastPrintedSecond(-1) {
+namespace {
+
+// Строки битв печатает исполнитель уведомлений, поэтому под мьютексом
+// вывода, чтобы не разрывать карту
+class GuardedConsoleLogger : public ConsoleLogger {
+public:
+    GuardedConsoleLogger(const ConsoleLoggerOptions& options, InstrumentedMutex& mutex)
+        : ConsoleLogger(options), mutex(mutex) {}
+    
+protected:
+    void write(const std::string& text) override {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+        ConsoleLogger::write(text);
+    }
+    
+private:
+    InstrumentedMutex& mutex;
+};
+
+ConsoleLoggerOptions battleConsoleOptions(const GameConfig& config) {
+    ConsoleLoggerOptions options;
+    options.mode = config.verboseBattles ? ConsoleMode::Verbose : ConsoleMode::Summary;
+    options.sampleEvery = config.battleSample;
+    options.maxLinesPerSecond = config.battleRate;
+    return options;
+}
+
+// Медленные консоль или журнал теряют уведомления, но не задерживают тик
+NotifierOptions battleNotifierOptions() {
+    NotifierOptions options;
+    options.capacity = 1 << 14;
+    options.backpressure = NotifyBackpressure::DropNewest;
+    return options;
+}
+
+}  // namespace
+
+GameManager::GameManager(const GameConfig& config)
+    : config(config), seed(config.seed ? *config.seed : rd()),
+      jobs(config.workerCount ? config.workerCount : JobSystem::defaultWorkerCount()),
+      simulation(editor.getNPCs(), jobs, seed, config.mapWidth, config.mapHeight, config.killDistance),
+      lastPrintedSecond(-1) {
+    editor.setBounds(WorldBounds{static_cast<float>(config.mapWidth), static_cast<float>(config.mapHeight)});
+    battleConsole = std::make_shared<GuardedConsoleLogger>(battleConsoleOptions(config), printMutex);
+    if (!config.headless) battleLog.addObserver(battleConsole);
+    if (!config.battleRecordPath.empty()) {
+        battleRecord = std::make_shared<BattleLogWriter>(config.battleRecordPath);
+        battleLog.addObserver(battleRecord);
+    }
+    battleLog.setNames(&editor.getNames());
+    battleLog.startAsync(battleNotifierOptions());
     initializeNPCs();
+    simulation.reset();
 }
 
 GameManager::~GameManager() {
@@ -17,71 +67,52 @@ GameManager::~GameManager() {
 }
 
 void GameManager::initializeNPCs() {
-    std::uniform_int_distribution<> typeDist(0, 2);
-    std::uniform_int_distribution<> xDist(0, MAP_WIDTH - 1);
-    std::uniform_int_distribution<> yDist(0, MAP_HEIGHT - 1);
-    
-    for (int i = 0; i < INITIAL_NPC_COUNT; ++i) {
-        int type = typeDist(gen);
-        int x = xDist(gen);
-        int y = yDist(gen);
-        
+    auto spawns = ScenarioGenerator::generate(config.scenario, config.npcCount,
+                                              config.mapWidth, config.mapHeight, seed);
+    for (size_t i = 0; i < spawns.size(); ++i) {
         std::string name = "NPC_" + std::to_string(i);
-        
-        switch (type) {
-            case 0:
-                editor.addNPC("Orc", name, x, y);
-                break;
-            case 1:
-                editor.addNPC("Knight", name, x, y);
-                break;
-            case 2:
-                editor.addNPC("Bear", name, x, y);
-                break;
-        }
+        editor.addNPC(traitsOf(spawns[i].type).name, name, spawns[i].x, spawns[i].y);
     }
 }
 
 void GameManager::printMap() {
-    // Получаем позиции живых NPC
-    std::vector<NPC*> aliveNPCs;
-    {
-        std::shared_lock lock(npcMutex);
-        aliveNPCs = editor.getAliveNPCs();
-    }
-    
-    // Создаем полную карту 100x100
-    std::vector<std::vector<char>> fullMap(MAP_HEIGHT, std::vector<char>(MAP_WIDTH, '.'));
-    
-    // Счетчики для статистики наложения
+    ScopedAllocTag tag(AllocTag::Render);
+    // Живые NPC из последнего опубликованного кадра; симуляция тем временем
+    // пишет в другой кадр
+    auto frame = simulation.getFrames().acquire();
+    std::vector<FrameView> aliveNPCs = frame->getAliveNPCs();
+    
+    // Карта разреженная: хранятся только занятые клетки, память не зависит
+    // от размеров мира
     std::map<std::pair<int, int>, int> cellCounts;
     std::map<std::pair<int, int>, char> cellSymbols;
     
     // Заполняем карту NPC
     for (auto npc : aliveNPCs) {
-        auto pos = npc->getPosition();
-        if (pos.first >= 0 && pos.first < MAP_WIDTH && 
-            pos.second >= 0 && pos.second < MAP_HEIGHT) {
+        auto pos = npc.getPosition();
+        if (pos.first >= 0 && pos.first < config.mapWidth && 
+            pos.second >= 0 && pos.second < config.mapHeight) {
             
             std::pair<int, int> cell = {pos.second, pos.first};
             cellCounts[cell]++;
-            cellSymbols[cell] = npc->getSymbol();
-            
-            if (cellCounts[cell] == 1) {
-                fullMap[pos.second][pos.first] = npc->getSymbol();
-            } else {
-                // Если в клетке более одного NPC, показываем цифру количества
-                fullMap[pos.second][pos.first] = '0' + std::min(cellCounts[cell], 9);
-            }
+            cellSymbols[cell] = npc.getSymbol();
         }
     }
     
+    // Символ клетки: точка, символ NPC или количество NPC (2-9)
+    auto cellChar = [&](int x, int y) {
+        auto it = cellCounts.find({y, x});
+        if (it == cellCounts.end()) return '.';
+        if (it->second == 1) return cellSymbols[{y, x}];
+        return static_cast<char>('0' + std::min(it->second, 9));
+    };
+    
     // Находим область с NPC для отображения
-    int minX = MAP_WIDTH, maxX = -1;
-    int minY = MAP_HEIGHT, maxY = -1;
+    int minX = config.mapWidth, maxX = -1;
+    int minY = config.mapHeight, maxY = -1;
     
     for (auto npc : aliveNPCs) {
-        auto pos = npc->getPosition();
+        auto pos = npc.getPosition();
         if (pos.first < minX) minX = pos.first;
         if (pos.first > maxX) maxX = pos.first;
         if (pos.second < minY) minY = pos.second;
@@ -91,17 +122,17 @@ void GameManager::printMap() {
     // Если NPC нет, показываем центр карты
     if (aliveNPCs.empty() || minX > maxX || minY > maxY) {
         minX = 0;
-        maxX = MAP_WIDTH - 1;
+        maxX = config.mapWidth - 1;
         minY = 0;
-        maxY = MAP_HEIGHT - 1;
+        maxY = config.mapHeight - 1;
     }
     
     // Добавляем отступы
     int padding = 5;
     minX = std::max(0, minX - padding);
-    maxX = std::min(MAP_WIDTH - 1, maxX + padding);
+    maxX = std::min(config.mapWidth - 1, maxX + padding);
     minY = std::max(0, minY - padding);
-    maxY = std::min(MAP_HEIGHT - 1, maxY + padding);
+    maxY = std::min(config.mapHeight - 1, maxY + padding);
     
     // Ограничиваем размер отображаемой области для читаемости
     const int MAX_DISPLAY_WIDTH = 80;
@@ -113,24 +144,24 @@ void GameManager::printMap() {
     if (width > MAX_DISPLAY_WIDTH) {
         int centerX = (minX + maxX) / 2;
         minX = std::max(0, centerX - MAX_DISPLAY_WIDTH / 2);
-        maxX = std::min(MAP_WIDTH - 1, minX + MAX_DISPLAY_WIDTH - 1);
+        maxX = std::min(config.mapWidth - 1, minX + MAX_DISPLAY_WIDTH - 1);
         width = maxX - minX + 1;
     }
     
     if (height > MAX_DISPLAY_HEIGHT) {
         int centerY = (minY + maxY) / 2;
         minY = std::max(0, centerY - MAX_DISPLAY_HEIGHT / 2);
-        maxY = std::min(MAP_HEIGHT - 1, minY + MAX_DISPLAY_HEIGHT - 1);
+        maxY = std::min(config.mapHeight - 1, minY + MAX_DISPLAY_HEIGHT - 1);
         height = maxY - minY + 1;
     }
     
     // Выводим карту
-    std::lock_guard<std::mutex> lock(printMutex);
+    std::lock_guard<InstrumentedMutex> lock(printMutex);
     
     std::cout << "\n=== GAME MAP ===" << std::endl;
-    std::cout << "Time: " << lastPrintedSecond << "/" << GAME_DURATION << "s" << std::endl;
+    std::cout << "Time: " << lastPrintedSecond << "/" << config.simulatedSeconds() << "s" << std::endl;
     std::cout << "Showing area: X[" << minX << "-" << maxX << "] Y[" << minY << "-" << maxY << "]" << std::endl;
-    std::cout << "Full map: 100x100, Alive NPCs: " << aliveNPCs.size() << std::endl;
+    std::cout << "Full map: " << config.mapWidth << "x" << config.mapHeight << ", Alive NPCs: " << aliveNPCs.size() << std::endl;
     
     // Выводим координаты X (десятки и единицы)
     std::cout << "    ";
@@ -156,7 +187,7 @@ void GameManager::printMap() {
     for (int y = minY; y <= maxY; ++y) {
         std::cout << std::setw(2) << y << " |";
         for (int x = minX; x <= maxX; ++x) {
-            std::cout << fullMap[y][x];
+            std::cout << cellChar(x, y);
         }
         std::cout << "| " << std::setw(2) << y << std::endl;
     }
@@ -183,14 +214,11 @@ void GameManager::printMap() {
     
     // Статистика
     int alive = aliveNPCs.size();
-    int orcs = 0, knights = 0, bears = 0;
+    int typeCounts[NPC_TYPE_COUNT] = {};
     int overlappingCells = 0;
     
     for (auto npc : aliveNPCs) {
-        auto type = npc->getType();
-        if (type == "Orc") orcs++;
-        else if (type == "Knight") knights++;
-        else if (type == "Bear") bears++;
+        typeCounts[typeIndex(npc.getTypeId())]++;
     }
     
     // Подсчитываем клетки с наложением 
@@ -202,26 +230,45 @@ void GameManager::printMap() {
     
     std::cout << "\n=== STATISTICS ===" << std::endl;
     std::cout << "Alive NPCs: " << alive << std::endl;
-    std::cout << "  Orcs: " << orcs << " (O)" << std::endl;
-    std::cout << "  Knights: " << knights << " (K)" << std::endl;
-    std::cout << "  Bears: " << bears << " (B)" << std::endl;
+    for (size_t t = 0; t < NPC_TYPE_COUNT; ++t) {
+        std::cout << "  " << NPC_TRAITS[t].name << "s: " << typeCounts[t]
+                  << " (" << NPC_TRAITS[t].symbol << ")" << std::endl;
+    }
     std::cout << "Cells with multiple NPCs: " << overlappingCells << " (shown as numbers 2-9)" << std::endl;
     std::cout << "=============================" << std::endl;
 }
 
 void GameManager::printSurvivors() {
-    std::vector<NPC*> aliveNPCs;
-    {
-        std::shared_lock lock(npcMutex);
-        aliveNPCs = editor.getAliveNPCs();
-    }
+    ScopedAllocTag tag(AllocTag::Render);
+    auto frame = simulation.getFrames().acquire();
+    std::vector<FrameView> aliveNPCs = frame->getAliveNPCs();
     
-    std::lock_guard<std::mutex> printLock(printMutex);
+    std::lock_guard<InstrumentedMutex> printLock(printMutex);
     
     std::cout << "\n" << std::string(50, '=') << std::endl;
     std::cout << "=== GAME OVER ===" << std::endl;
-    std::cout << "Game duration: " << GAME_DURATION << " seconds" << std::endl;
-    std::cout << "Total survivors: " << aliveNPCs.size() << " out of " << INITIAL_NPC_COUNT << std::endl;
+    std::cout << "Game duration: " << config.simulatedSeconds() << " seconds" << std::endl;
+    std::cout << "Total survivors: " << aliveNPCs.size() << " out of " << config.npcCount << std::endl;
+    
+    BattleQueueStats queueStats = simulation.getBattleQueue().stats();
+    std::cout << "Battle queue: " << queueStats.enqueued << " enqueued, "
+              << queueStats.coalesced << " coalesced, "
+              << queueStats.dropped + droppedRun << " dropped, max depth "
+              << queueStats.maxDepth << "/" << queueStats.capacity << std::endl;
+    
+    auto workerStats = jobs.stats();
+    std::cout << "Ticks: " << simulation.getTick() << ", worker utilisation:";
+    for (size_t w = 0; w < workerStats.size(); ++w) {
+        std::cout << (w ? ", " : " ") << std::fixed << std::setprecision(1)
+                  << workerStats[w].utilisation * 100 << "%";
+    }
+    std::cout << std::defaultfloat << std::endl;
+    
+    FrameBufferStats frameStats = simulation.getFrames().stats();
+    std::cout << "Frames: " << frameStats.publishes << " published, "
+              << frameStats.reads << " read, reader wait max "
+              << frameStats.readWaitMax.count() << " ns, writer wait max "
+              << frameStats.writeWaitMax.count() << " ns" << std::endl;
     std::cout << std::string(50, '=') << std::endl;
     
     if (aliveNPCs.empty()) {
@@ -230,23 +277,20 @@ void GameManager::printSurvivors() {
     }
     
     // Подсчет по типам
-    int orcs = 0, knights = 0, bears = 0;
+    int typeCounts[NPC_TYPE_COUNT] = {};
     for (auto npc : aliveNPCs) {
-        auto type = npc->getType();
-        if (type == "Orc") orcs++;
-        else if (type == "Knight") knights++;
-        else if (type == "Bear") bears++;
+        typeCounts[typeIndex(npc.getTypeId())]++;
     }
     
     std::cout << "\nSurvivors by type:" << std::endl;
-    std::cout << "  Orcs: " << orcs << std::endl;
-    std::cout << "  Knights: " << knights << std::endl;
-    std::cout << "  Bears: " << bears << std::endl;
+    for (size_t t = 0; t < NPC_TYPE_COUNT; ++t) {
+        std::cout << "  " << NPC_TRAITS[t].name << "s: " << typeCounts[t] << std::endl;
+    }
     
     // Группируем по позициям
-    std::map<std::pair<int, int>, std::vector<NPC*>> npcsByPosition;
+    std::map<std::pair<int, int>, std::vector<FrameView>> npcsByPosition;
     for (auto npc : aliveNPCs) {
-        auto pos = npc->getPosition();
+        auto pos = npc.getPosition();
         npcsByPosition[pos].push_back(npc);
     }
     
@@ -267,7 +311,7 @@ void GameManager::printSurvivors() {
         std::stringstream npcList;
         for (size_t i = 0; i < npcs.size(); ++i) {
             if (i > 0) npcList << ", ";
-            npcList << npcs[i]->getType() << " " << npcs[i]->getName();
+            npcList << npcs[i].getType() << " " << npcs[i].getName();
         }
         
         std::cout << std::left << std::setw(15) << posStr.str()
@@ -291,213 +335,265 @@ void GameManager::printSurvivors() {
     }
 }
 
-void GameManager::run() {
+RunReport GameManager::run() {
+    ticksRun = 0;
+    killsRun = 0;
+    battlesRun = 0;
+    droppedRun = 0;
+    tickMillis.clear();
+    if (!config.metricsPath.empty()) {
+        Metrics::reset();
+        Metrics::setEnabled(true);
+    }
+    if (config.allocReport) {
+        AllocTracker::reset();
+        AllocTracker::setEnabled(true);
+    }
+    RunReport report = config.headless ? runHeadless() : runRealtime();
+    printRunSummary(report);
+    if (!config.metricsPath.empty()) {
+        writeMetrics();
+    }
+    if (config.allocReport) {
+        AllocTracker::setEnabled(false);
+        std::lock_guard<InstrumentedMutex> printLock(printMutex);
+        std::cout << AllocTracker::format(AllocTracker::report());
+    }
+    return report;
+}
+
+void GameManager::startSharedSnapshot() {
+    if (!config.sharedSnapshot) return;
+    
+    // Кадры тиков дублируются в разделяемую память; без нее игра идет как обычно
+    try {
+        auto capacity = static_cast<std::uint32_t>(
+            std::max<size_t>(editor.getNPCs().size(), config.npcCount));
+        const std::string& name = config.shmName.empty() ? shared_snapshot::DEFAULT_NAME : config.shmName;
+        sharedSnapshot = std::make_unique<SharedSnapshotWriter>(name, capacity);
+        simulation.setSharedSnapshot(sharedSnapshot.get());
+        std::lock_guard<InstrumentedMutex> lock(printMutex);
+        std::cout << "World snapshot: shared memory " << sharedSnapshot->getName() << std::endl;
+    } catch (const std::exception& e) {
+        std::lock_guard<InstrumentedMutex> lock(printMutex);
+        std::cout << "World snapshot disabled: " << e.what() << std::endl;
+    }
+}
+
+RunReport GameManager::runRealtime() {
     running = true;
     lastPrintedSecond = -1;
     
     {
-        std::lock_guard<std::mutex> lock(printMutex);
+        std::lock_guard<InstrumentedMutex> lock(printMutex);
         std::cout << "=== NPC BATTLE SIMULATION (Lab 7) ===" << std::endl;
-        std::cout << "Map size: " << MAP_WIDTH << "x" << MAP_HEIGHT << std::endl;
-        std::cout << "Game duration: " << GAME_DURATION << " seconds" << std::endl;
-        std::cout << "Initial NPCs: " << INITIAL_NPC_COUNT << std::endl;
-        std::cout << "NPC types: Orc (O), Knight (K), Bear (B)" << std::endl;
-        std::cout << "Movement distances: Orc=20, Knight=30, Bear=5" << std::endl;
-        std::cout << "Kill distance: 10 for all NPCs" << std::endl;
+        std::cout << "Map size: " << config.mapWidth << "x" << config.mapHeight << std::endl;
+        std::cout << "Game duration: " << config.simulatedSeconds() << " seconds ("
+                  << config.totalTicks() << " ticks at " << config.tickRate << " ticks/s)" << std::endl;
+        std::cout << "Initial NPCs: " << config.npcCount << std::endl;
+        std::cout << "NPC types:";
+        for (size_t t = 0; t < NPC_TYPE_COUNT; ++t) {
+            std::cout << (t ? ", " : " ") << NPC_TRAITS[t].name << " (" << NPC_TRAITS[t].symbol << ")";
+        }
+        std::cout << std::endl;
+        std::cout << "Movement distances:";
+        for (size_t t = 0; t < NPC_TYPE_COUNT; ++t) {
+            std::cout << (t ? ", " : " ") << NPC_TRAITS[t].name << "=" << NPC_TRAITS[t].moveDistance;
+        }
+        std::cout << std::endl;
+        std::cout << "Kill distance: " << config.killDistance << " for all NPCs" << std::endl;
+        std::cout << "Worker threads: " << jobs.getWorkerCount() << std::endl;
         std::cout << std::string(50, '=') << std::endl;
-        std::cout << "\nInitial NPC positions are being generated..." << std::endl;
     }
     
-    // Даем немного времени на инициализацию
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    
     // Выводим начальную карту (время 0)
     lastPrintedSecond = 0;
     printMap();
     
-    auto movementLambda = [this]() {
-        std::uniform_int_distribution<> dirDist(-1, 1);
-        
-        while (running) {
-            // Получаем список живых NPC
-            std::vector<NPC*> aliveNPCs;
-            {
-                std::shared_lock lock(npcMutex);
-                aliveNPCs = editor.getAliveNPCs();
-            }
-            
-            // Перемещаем живых NPC
-            for (auto npc : aliveNPCs) {
-                npc->move(dirDist(gen), dirDist(gen), MAP_WIDTH, MAP_HEIGHT);
-            }
-            
-            // Множество уже проверенных пар для избежания дублирования битв
-            std::unordered_set<std::string> checkedPairs;
-            
-            // Проверяем столкновения
-            for (size_t i = 0; i < aliveNPCs.size(); ++i) {
-                NPC* npc1 = aliveNPCs[i];
-                if (!npc1->isAlive()) continue;
-                
-                for (size_t j = i + 1; j < aliveNPCs.size(); ++j) {
-                    NPC* npc2 = aliveNPCs[j];
-                    if (!npc2->isAlive()) continue;
-                    
-                    // Создаем уникальный идентификатор пары
-                    std::string pairId = std::to_string(reinterpret_cast<uintptr_t>(npc1)) + 
-                                         "-" + 
-                                         std::to_string(reinterpret_cast<uintptr_t>(npc2));
-                    
-                    if (checkedPairs.find(pairId) != checkedPairs.end()) {
-                        continue; // Уже проверяли эту пару
-                    }
-                    checkedPairs.insert(pairId);
-                    
-                    double distance = npc1->distanceTo(*npc2);
-                    
-                    // Проверяем дистанцию убийства (10 для всех)
-                    if (distance <= 10.0) {
-                        // Проверяем, могут ли они атаковать друг друга
-                        bool canAttack1to2 = npc1->canAttack(*npc2);
-                        bool canAttack2to1 = npc2->canAttack(*npc1);
-                        
-                        if (canAttack1to2 || canAttack2to1) {
-                            // Определяем атакующего и защищающегося
-                            ThreadBattle battle;
-                            
-                            if (canAttack1to2 && !canAttack2to1) {
-                                battle.attacker = npc1;
-                                battle.defender = npc2;
-                            } else if (!canAttack1to2 && canAttack2to1) {
-                                battle.attacker = npc2;
-                                battle.defender = npc1;
-                            } else {
-                                // Оба могут атаковать - выбираем случайно
-                                if (dirDist(gen) > 0) {
-                                    battle.attacker = npc1;
-                                    battle.defender = npc2;
-                                } else {
-                                    battle.attacker = npc2;
-                                    battle.defender = npc1;
-                                }
-                            }
-                            
-                            {
-                                std::lock_guard<std::mutex> lock(battleQueueMutex);
-                                battleQueue.push(battle);
-                            }
-                            battleCV.notify_one();
-                        }
-                    }
-                }
-            }
-            
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        }
-    };
-    
-    auto battleLambda = [this]() {
-        while (running) {
-            ThreadBattle battle{nullptr, nullptr};
-            bool hasBattle = false;
-            
-            // Берем битву из очереди
-            {
-                std::unique_lock<std::mutex> lock(battleQueueMutex);
-                if (battleCV.wait_for(lock, std::chrono::milliseconds(100), 
-                    [this]() { return !battleQueue.empty(); })) {
-                    
-                    battle = battleQueue.front();
-                    battleQueue.pop();
-                    hasBattle = true;
-                }
-            }
-            
-            // Обрабатываем битву
-            if (hasBattle && battle.attacker && battle.defender) {
-                // Проверяем, что оба еще живы и могут сражаться
-                if (!battle.attacker->isAlive() || !battle.defender->isAlive()) {
-                    continue;
-                }
-                
-                if (!battle.attacker->canAttack(*battle.defender)) {
-                    continue;
-                }
-                
-                // Бросаем 6-гранные кубики
-                int attackRoll = diceDist(gen);   // 1-6
-                int defenseRoll = diceDist(gen);  // 1-6
-                
-                std::string battleResult;
-                
-                if (attackRoll > defenseRoll) {
-                    // Атака успешна - убиваем защитника
-                    {
-                        std::lock_guard<std::mutex> npcLock(printMutex);
-                        battle.defender->die();
-                    }
-                    battleResult = " -> " + battle.defender->getName() + " KILLED!";
-                } else {
-                    battleResult = " -> " + battle.defender->getName() + " DEFENDED!";
-                }
-                
-                // Выводим результат битвы в одну строку
-                {
-                    std::lock_guard<std::mutex> printLock(printMutex);
-                    std::cout << "Battle: " << battle.attacker->getType() 
-                              << " " << battle.attacker->getName()
-                              << " [" << attackRoll << "] vs "
-                              << battle.defender->getType()
-                              << " " << battle.defender->getName()
-                              << " [" << defenseRoll << "]"
-                              << battleResult << std::endl;
-                }
-            }
-        }
-    };
-    
-    movementThread = std::thread(movementLambda);
-    battleThread = std::thread(battleLambda);
+    startSharedSnapshot();
     
+    // Сетка заполняется заново: NPC могли измениться после конструктора
+    simulation.reset();
+    jobs.resetStats();
+    AllocTracker::startTick();
     auto startTime = std::chrono::steady_clock::now();
+    simulationThread = std::thread(&GameManager::simulationWorker, this);
     
-    // Основной цикл
+    // Основной цикл: игра заканчивается, когда поток симуляции сыграет все тики
     while (running) {
         auto currentTime = std::chrono::steady_clock::now();
         auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(currentTime - startTime);
         int currentSecond = elapsed.count();
         
-        if (currentSecond >= GAME_DURATION) {
-            running = false;
-            break;
-        }
-        
         // Выводим карту и статистику каждую секунду
         if (currentSecond > lastPrintedSecond) {
             lastPrintedSecond = currentSecond;
             printMap();
         }
         
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // Спим до начала следующей секунды, просыпаясь раньше к концу игры
+        auto nextSecond = startTime + std::chrono::seconds(currentSecond + 1);
+        while (running && std::chrono::steady_clock::now() < nextSecond) {
+            std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                config.tickInterval(), nextSecond - std::chrono::steady_clock::now()));
+        }
     }
     
     // Завершаем игру
     stop();
-    
-    // Небольшая задержка для завершения всех битв
-    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
     
     printSurvivors();
+    return makeReport(wallSeconds, simulation.getFrames().acquire()->aliveCount);
+}
+
+RunReport GameManager::runHeadless() {
+    startSharedSnapshot();
+    simulation.reset();
+    jobs.resetStats();
+    AllocTracker::startTick();
+    
+    // Тики подряд на вызывающем потоке: без вывода карты, битв и пауз;
+    // битвы идут только в --battle-record
+    std::uint64_t total = config.totalTicks();
+    tickMillis.reserve(total);
+    auto startTime = std::chrono::steady_clock::now();
+    size_t alive = simulation.getFrames().acquire()->aliveCount;
+    for (std::uint64_t t = 0; t < total; ++t) {
+        auto tickStart = std::chrono::steady_clock::now();
+        const TickReport& report = simulation.step();
+        recordTick(report, std::chrono::steady_clock::now() - tickStart);
+        alive = report.alive;
+        if (battleRecord) publishBattles(report);
+    }
+    battleLog.flush();
+    if (battleRecord) battleRecord->close();
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    
+    simulation.setSharedSnapshot(nullptr);
+    sharedSnapshot.reset();
+    return makeReport(wallSeconds, alive);
+}
+
+void GameManager::recordTick(const TickReport& report, std::chrono::steady_clock::duration elapsed) {
+    ++ticksRun;
+    killsRun += report.kills;
+    droppedRun += report.battlesDropped;
+    for (const auto& outcome : report.outcomes) {
+        battlesRun += outcome.fought;
+    }
+    tickMillis.push_back(std::chrono::duration<double, std::milli>(elapsed).count());
+    if (AllocTracker::enabled()) AllocTracker::nextTick();
+}
+
+RunReport GameManager::makeReport(double wallSeconds, size_t alive) const {
+    RunReport report;
+    report.ticks = ticksRun;
+    report.simulatedSeconds = ticksRun / config.tickRate;
+    report.wallSeconds = wallSeconds;
+    report.ticksPerSecond = wallSeconds > 0 ? ticksRun / wallSeconds : 0.0;
+    report.kills = killsRun;
+    report.alive = alive;
+    report.battles = battlesRun;
+    report.battlesDropped = droppedRun;
+    
+    // Процентили по ближайшему рангу
+    if (!tickMillis.empty()) {
+        std::vector<double> sorted = tickMillis;
+        std::sort(sorted.begin(), sorted.end());
+        auto at = [&sorted](double q) {
+            return sorted[static_cast<size_t>(q * (sorted.size() - 1) + 0.5)];
+        };
+        report.tickP50Ms = at(0.50);
+        report.tickP99Ms = at(0.99);
+    }
+    return report;
+}
+
+void GameManager::printRunSummary(const RunReport& report) {
+    std::lock_guard<InstrumentedMutex> printLock(printMutex);
+    std::cout << std::fixed << std::setprecision(3)
+              << "Run: " << report.ticks << " ticks (" << report.simulatedSeconds
+              << " s simulated) in " << report.wallSeconds << " s wall, "
+              << std::setprecision(1) << report.ticksPerSecond << " ticks/sec, "
+              << report.kills << " kills, " << report.alive << " alive, "
+              << std::setprecision(3) << "tick p50 " << report.tickP50Ms << " ms, p99 "
+              << report.tickP99Ms << " ms" << std::defaultfloat << std::endl;
+    if (report.battlesDropped > 0) {
+        std::cout << "Battle limit: " << report.battlesDropped
+                  << " contacts over the per-tick battle limit were not fought" << std::endl;
+    }
+    if (std::uint64_t dropped = battleLog.stats().dropped) {
+        std::cout << "Battle notifications: " << dropped
+                  << " dropped, the console or battle record could not keep up" << std::endl;
+    }
+    if (battleRecord) {
+        BattleLogStats recorded = battleRecord->stats();
+        std::cout << "Battle record: " << config.battleRecordPath << " (" << recorded.events
+                  << " battles, " << recorded.blocks << " blocks)"
+                  << (recorded.failed ? ", write failed: log truncated" : "") << std::endl;
+    }
+}
+
+void GameManager::writeMetrics() {
+    bool written = Metrics::dump(config.metricsPath);
+    std::lock_guard<InstrumentedMutex> printLock(printMutex);
+    if (written) {
+        std::cout << "Metrics: " << config.metricsPath << std::endl;
+    } else {
+        std::cerr << "Cannot write metrics to " << config.metricsPath << std::endl;
+    }
 }
 
 void GameManager::stop() {
     running = false;
-    battleCV.notify_all();
     
-    if (movementThread.joinable()) {
-        movementThread.join();
+    if (simulationThread.joinable()) {
+        simulationThread.join();
+    }
+    // Битвы последних тиков выводятся до итогов игры
+    battleLog.flush();
+    battleConsole->flush();
+    if (battleRecord) battleRecord->close();
+    simulation.setSharedSnapshot(nullptr);
+    sharedSnapshot.reset();
+}
+
+void GameManager::publishBattles(const TickReport& report) {
+    const NPCStore& npcs = editor.getNPCs();
+    for (const auto& outcome : report.outcomes) {
+        if (!outcome.fought) continue;
+        
+        BattleEvent event;
+        event.attacker = npcs.handleOf(outcome.attacker);
+        event.defender = npcs.handleOf(outcome.defender);
+        event.attackerType = npcs.getType(outcome.attacker);
+        event.defenderType = npcs.getType(outcome.defender);
+        event.result = outcome.killed ? BattleResult::AttackerKills : BattleResult::Defended;
+        event.attackRoll = static_cast<std::uint8_t>(outcome.attackRoll);
+        event.defenseRoll = static_cast<std::uint8_t>(outcome.defenseRoll);
+        event.tick = report.tick;
+        event.x = npcs.getX(outcome.defender);
+        event.y = npcs.getY(outcome.defender);
+        battleLog.notifyObservers(event);
     }
-    if (battleThread.joinable()) {
-        battleThread.join();
+}
+
+void GameManager::simulationWorker() {
+    auto nextTick = std::chrono::steady_clock::now();
+    std::uint64_t total = config.totalTicks();
+    
+    while (running && ticksRun < total) {
+        auto tickStart = std::chrono::steady_clock::now();
+        const TickReport& report = simulation.step();
+        recordTick(report, std::chrono::steady_clock::now() - tickStart);
+        
+        // Медленная консоль не задерживает следующий тик
+        publishBattles(report);
+        
+        if (ticksRun == total) break;
+        nextTick += config.tickInterval();
+        std::this_thread::sleep_until(nextTick);
     }
+    running = false;
 }
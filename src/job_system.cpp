@@ -0,0 +1,182 @@
+#include "../include/job_system.h"
+
+// Поток знает свой слот только в "своем" планировщике
+static thread_local const JobSystem* currentSystem = nullptr;
+static thread_local size_t currentIndex = 0;
+// Поток выполняет задание: вложенная работа уже входит в его время
+static thread_local bool insideJob = false;
+
+// Сколько раз простаивающий поток уступает квант, прежде чем уснуть
+static constexpr int IDLE_SPINS = 64;
+static constexpr std::chrono::milliseconds IDLE_SLEEP(1);
+
+JobSystem::JobSystem(size_t workerCount) : statsStart(std::chrono::steady_clock::now()) {
+    workerCount = std::max<size_t>(1, workerCount);
+    for (size_t i = 0; i < workerCount; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 1; i < workerCount; ++i) {
+        threads.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    stopping.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    sleepCV.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+size_t JobSystem::defaultWorkerCount() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+size_t JobSystem::currentWorker() const {
+    // Посторонние потоки (main, поток симуляции) работают через слот 0
+    return currentSystem == this ? currentIndex : 0;
+}
+
+void JobSystem::recordInline(std::chrono::steady_clock::duration elapsed) {
+    if (insideJob) return;
+
+    Worker& own = *workers[currentWorker()];
+    own.jobs.fetch_add(1, std::memory_order_relaxed);
+    own.busyNanos.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+        std::memory_order_relaxed);
+}
+
+void JobSystem::submit(Job job, JobCounter& counter) {
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+
+    Worker& worker = *workers[currentWorker()];
+    {
+        std::lock_guard<InstrumentedMutex> lock(worker.mutex);
+        worker.tasks.push_back(Task{std::move(job), &counter, AllocTracker::currentTag()});
+    }
+    queued.fetch_add(1, std::memory_order_release);
+    sleepCV.notify_one();
+}
+
+bool JobSystem::tryRunOne(size_t self) {
+    if (queued.load(std::memory_order_acquire) == 0) return false;
+
+    Task task;
+    bool found = false;
+    bool stolen = false;
+
+    // Сначала своя очередь (с конца: свежие задания, теплый кэш)
+    {
+        Worker& own = *workers[self];
+        std::lock_guard<InstrumentedMutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            found = true;
+        }
+    }
+
+    // Затем кража с начала чужих очередей
+    if (!found) {
+        size_t start = nextVictim.fetch_add(1, std::memory_order_relaxed);
+        for (size_t k = 0; k < workers.size() && !found; ++k) {
+            size_t victim = (start + k) % workers.size();
+            if (victim == self) continue;
+
+            Worker& other = *workers[victim];
+            std::lock_guard<InstrumentedMutex> lock(other.mutex);
+            if (!other.tasks.empty()) {
+                task = std::move(other.tasks.front());
+                other.tasks.pop_front();
+                found = stolen = true;
+            }
+        }
+    }
+
+    if (!found) return false;
+    queued.fetch_sub(1, std::memory_order_relaxed);
+
+    bool nested = insideJob;
+    insideJob = true;
+    auto begin = std::chrono::steady_clock::now();
+    {
+        ScopedAllocTag tag(task.tag);
+        task.job();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - begin;
+    insideJob = nested;
+
+    Worker& own = *workers[self];
+    own.jobs.fetch_add(1, std::memory_order_relaxed);
+    if (stolen) own.steals.fetch_add(1, std::memory_order_relaxed);
+    if (!nested) {
+        own.busyNanos.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+            std::memory_order_relaxed);
+    }
+
+    task.counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    size_t self = currentWorker();
+    while (counter.pending.load(std::memory_order_acquire) != 0) {
+        if (!tryRunOne(self)) {
+            // Оставшиеся задания уже выполняются другими потоками
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::workerLoop(size_t index) {
+    currentSystem = this;
+    currentIndex = index;
+
+    int idle = 0;
+    while (!stopping.load(std::memory_order_acquire)) {
+        if (tryRunOne(index)) {
+            idle = 0;
+            continue;
+        }
+        if (++idle < IDLE_SPINS) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCV.wait_for(lock, IDLE_SLEEP, [this]() {
+            return stopping.load(std::memory_order_acquire) ||
+                   queued.load(std::memory_order_acquire) != 0;
+        });
+        idle = 0;
+    }
+}
+
+std::vector<JobSystem::WorkerStats> JobSystem::stats() const {
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - statsStart).count();
+
+    std::vector<WorkerStats> result;
+    for (const auto& worker : workers) {
+        WorkerStats entry;
+        entry.jobs = worker->jobs.load(std::memory_order_relaxed);
+        entry.steals = worker->steals.load(std::memory_order_relaxed);
+        entry.busySeconds = worker->busyNanos.load(std::memory_order_relaxed) * 1e-9;
+        entry.utilisation = elapsed > 0 ? std::min(1.0, entry.busySeconds / elapsed) : 0.0;
+        result.push_back(entry);
+    }
+    return result;
+}
+
+void JobSystem::resetStats() {
+    for (auto& worker : workers) {
+        worker->jobs.store(0, std::memory_order_relaxed);
+        worker->steals.store(0, std::memory_order_relaxed);
+        worker->busyNanos.store(0, std::memory_order_relaxed);
+    }
+    statsStart = std::chrono::steady_clock::now();
+}
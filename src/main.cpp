@@ -1,14 +1,34 @@
 #include "game_manager.h"
 #include <iostream>
+#include <string>
 
-int main() {
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--help") {
+            std::cout << GameConfig::usage(argv[0]);
+            return 0;
+        }
+    }
+    
+    GameConfig config;
+    try {
+        config = GameConfig::fromArgs(argc, argv);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << "Error: " << e.what() << "\n" << GameConfig::usage(argv[0]);
+        return 2;
+    }
+    
     try {
-        std::cout << "Starting NPC Battle Simulation..." << std::endl;
+        if (!config.headless) {
+            std::cout << "Starting NPC Battle Simulation..." << std::endl;
+        }
         
-        GameManager game;
+        GameManager game(config);
         game.run();
         
-        std::cout << "\nSimulation completed!" << std::endl;
+        if (!config.headless) {
+            std::cout << "\nSimulation completed!" << std::endl;
+        }
         
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
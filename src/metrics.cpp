@@ -0,0 +1,368 @@
+#include "../include/metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+static unsigned highestBit(std::uint64_t value) {
+    unsigned bit = 0;
+    for (unsigned step = 32; step > 0; step >>= 1) {
+        if (value >> step) {
+            value >>= step;
+            bit += step;
+        }
+    }
+    return bit;
+}
+
+size_t Histogram::bucketOf(std::uint64_t value) {
+    if (value < SUB_BUCKETS) return static_cast<size_t>(value);
+    unsigned exponent = highestBit(value);
+    size_t sub = static_cast<size_t>(value >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1);
+    return (exponent - SUB_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+std::uint64_t Histogram::bucketLow(size_t bucket) {
+    if (bucket < SUB_BUCKETS) return bucket;
+    unsigned exponent = static_cast<unsigned>(bucket / SUB_BUCKETS) + SUB_BITS - 1;
+    std::uint64_t sub = bucket % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub) << (exponent - SUB_BITS);
+}
+
+std::uint64_t Histogram::bucketHigh(size_t bucket) {
+    return bucket + 1 < BUCKET_COUNT ? bucketLow(bucket + 1) - 1 : ~std::uint64_t(0);
+}
+
+void Histogram::record(std::uint64_t value, std::uint64_t times) {
+    buckets[bucketOf(value)] += times;
+    total += times;
+    valueSum += value * times;
+    minValue = std::min(minValue, value);
+    maxValue = std::max(maxValue, value);
+}
+
+void Histogram::merge(const Histogram& other) {
+    for (size_t b = 0; b < BUCKET_COUNT; ++b) {
+        buckets[b] += other.buckets[b];
+    }
+    total += other.total;
+    valueSum += other.valueSum;
+    minValue = std::min(minValue, other.minValue);
+    maxValue = std::max(maxValue, other.maxValue);
+}
+
+std::uint64_t Histogram::percentile(double q) const {
+    if (total == 0) return 0;
+    if (q <= 0.0) return min();
+    auto rank = static_cast<std::uint64_t>(std::ceil(std::min(q, 1.0) * total));
+    std::uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKET_COUNT; ++b) {
+        seen += buckets[b];
+        if (seen >= rank) return std::min(bucketHigh(b), maxValue);
+    }
+    return maxValue;
+}
+
+// Гистограмма потока: пишет только владелец, читает snapshot()
+struct AtomicHistogram {
+    std::array<std::atomic<std::uint64_t>, Histogram::BUCKET_COUNT> buckets;
+    std::atomic<std::uint64_t> total;
+    std::atomic<std::uint64_t> valueSum;
+    std::atomic<std::uint64_t> minValue;
+    std::atomic<std::uint64_t> maxValue;
+
+    AtomicHistogram() { clear(); }
+
+    void record(std::uint64_t value) {
+        buckets[Histogram::bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        valueSum.fetch_add(value, std::memory_order_relaxed);
+        if (value < minValue.load(std::memory_order_relaxed)) minValue.store(value, std::memory_order_relaxed);
+        if (value > maxValue.load(std::memory_order_relaxed)) maxValue.store(value, std::memory_order_relaxed);
+    }
+
+    void addTo(Histogram& out) const {
+        for (size_t b = 0; b < Histogram::BUCKET_COUNT; ++b) {
+            out.buckets[b] += buckets[b].load(std::memory_order_relaxed);
+        }
+        out.total += total.load(std::memory_order_relaxed);
+        out.valueSum += valueSum.load(std::memory_order_relaxed);
+        out.minValue = std::min(out.minValue, minValue.load(std::memory_order_relaxed));
+        out.maxValue = std::max(out.maxValue, maxValue.load(std::memory_order_relaxed));
+    }
+
+    void clear() {
+        for (auto& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        valueSum.store(0, std::memory_order_relaxed);
+        minValue.store(~std::uint64_t(0), std::memory_order_relaxed);
+        maxValue.store(0, std::memory_order_relaxed);
+    }
+};
+
+namespace {
+
+struct ThreadMetrics {
+    struct Lock {
+        std::atomic<std::uint64_t> acquisitions{0};
+        std::atomic<std::uint64_t> contended{0};
+        AtomicHistogram wait;
+        AtomicHistogram hold;
+    };
+
+    std::array<std::atomic<std::uint64_t>, METRIC_COUNTER_COUNT> counters{};
+    std::array<AtomicHistogram, METRIC_HISTOGRAM_COUNT> histograms;
+    std::array<Lock, LOCK_ID_COUNT> locks;
+
+    void addTo(MetricsSnapshot& out) const {
+        for (size_t c = 0; c < METRIC_COUNTER_COUNT; ++c) {
+            out.counters[c] += counters[c].load(std::memory_order_relaxed);
+        }
+        for (size_t h = 0; h < METRIC_HISTOGRAM_COUNT; ++h) {
+            histograms[h].addTo(out.histograms[h]);
+        }
+        for (size_t l = 0; l < LOCK_ID_COUNT; ++l) {
+            out.locks[l].acquisitions += locks[l].acquisitions.load(std::memory_order_relaxed);
+            out.locks[l].contended += locks[l].contended.load(std::memory_order_relaxed);
+            locks[l].wait.addTo(out.locks[l].wait);
+            locks[l].hold.addTo(out.locks[l].hold);
+        }
+    }
+
+    void clear() {
+        for (auto& counter : counters) counter.store(0, std::memory_order_relaxed);
+        for (auto& histogram : histograms) histogram.clear();
+        for (auto& lock : locks) {
+            lock.acquisitions.store(0, std::memory_order_relaxed);
+            lock.contended.store(0, std::memory_order_relaxed);
+            lock.wait.clear();
+            lock.hold.clear();
+        }
+    }
+};
+
+// Данные живых потоков и накопленные данные завершившихся
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadMetrics*> threads;
+    MetricsSnapshot retired;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+// Данные потока создаются при первом замере, при выходе потока
+// переносятся в Registry::retired
+struct ThreadSlot {
+    std::unique_ptr<ThreadMetrics> data;
+
+    ThreadMetrics& get() {
+        if (!data) {
+            data = std::make_unique<ThreadMetrics>();
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.threads.push_back(data.get());
+        }
+        return *data;
+    }
+
+    ~ThreadSlot() {
+        if (!data) return;
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        data->addTo(r.retired);
+        r.threads.erase(std::find(r.threads.begin(), r.threads.end(), data.get()));
+    }
+};
+
+ThreadMetrics& local() {
+    thread_local ThreadSlot slot;
+    return slot.get();
+}
+
+struct CounterInfo {
+    const char* key;
+    const char* family;
+};
+
+struct HistogramInfo {
+    const char* key;
+    const char* family;
+    const char* labels;
+    bool nanos;         // значения - наносекунды (в Prometheus - секунды)
+};
+
+const CounterInfo COUNTER_INFO[METRIC_COUNTER_COUNT] = {
+    {"ticks", "laba7_ticks_total"},
+    {"pairs_checked", "laba7_pairs_checked_total"},
+    {"battles_queued", "laba7_battles_queued_total"},
+    {"battles_dropped", "laba7_battles_dropped_total"},
+    {"battles_resolved", "laba7_battles_resolved_total"},
+    {"kills", "laba7_kills_total"},
+    {"observer_events", "laba7_observer_events_total"},
+};
+
+const HistogramInfo HISTOGRAM_INFO[METRIC_HISTOGRAM_COUNT] = {
+    {"tick_total", "laba7_tick_duration_seconds", "", true},
+    {"tick_move", "laba7_tick_phase_seconds", "phase=\"move\"", true},
+    {"tick_broad_phase", "laba7_tick_phase_seconds", "phase=\"broad_phase\"", true},
+    {"tick_battle", "laba7_tick_phase_seconds", "phase=\"battle\"", true},
+    {"tick_stats", "laba7_tick_phase_seconds", "phase=\"stats\"", true},
+    {"tick_publish", "laba7_tick_phase_seconds", "phase=\"publish\"", true},
+    {"battle_queue_depth", "laba7_battle_queue_depth", "", false},
+    {"observer_dispatch", "laba7_observer_dispatch_seconds", "", true},
+};
+
+const char* LOCK_NAMES[LOCK_ID_COUNT] = {"print", "job_queue"};
+
+void writeJsonHistogram(std::ostream& out, const Histogram& h, bool nanos) {
+    out << "{\"unit\":\"" << (nanos ? "ns" : "count") << "\",\"count\":" << h.count()
+        << ",\"sum\":" << h.sum() << ",\"min\":" << h.min() << ",\"max\":" << h.max()
+        << ",\"mean\":" << h.mean() << ",\"p50\":" << h.percentile(0.50)
+        << ",\"p90\":" << h.percentile(0.90) << ",\"p99\":" << h.percentile(0.99)
+        << ",\"p999\":" << h.percentile(0.999) << "}";
+}
+
+std::string joinLabels(const std::string& labels, const std::string& extra) {
+    if (labels.empty()) return extra;
+    if (extra.empty()) return labels;
+    return labels + "," + extra;
+}
+
+void writeType(std::ostream& out, std::string& lastFamily, const std::string& family, const char* type) {
+    if (family == lastFamily) return;
+    out << "# TYPE " << family << " " << type << "\n";
+    lastFamily = family;
+}
+
+void writePromHistogram(std::ostream& out, const std::string& family, const std::string& labels,
+                        const Histogram& h, bool nanos) {
+    double scale = nanos ? 1e-9 : 1.0;
+    std::uint64_t cumulative = 0;
+    for (size_t b = 0; b < Histogram::BUCKET_COUNT; ++b) {
+        if (h.bucket(b) == 0) continue;
+        cumulative += h.bucket(b);
+        out << family << "_bucket{" << joinLabels(labels, "le=\"")
+            << Histogram::bucketHigh(b) * scale << "\"} " << cumulative << "\n";
+    }
+    out << family << "_bucket{" << joinLabels(labels, "le=\"+Inf\"") << "} " << h.count() << "\n";
+    std::string suffix = labels.empty() ? "" : "{" + labels + "}";
+    out << family << "_sum" << suffix << " " << h.sum() * scale << "\n";
+    out << family << "_count" << suffix << " " << h.count() << "\n";
+}
+
+}  // namespace
+
+void Metrics::add(MetricCounter counter, std::uint64_t value) {
+    local().counters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+}
+
+void Metrics::record(MetricHistogram histogram, std::uint64_t value) {
+    local().histograms[static_cast<size_t>(histogram)].record(value);
+}
+
+void Metrics::recordLock(LockId id, std::uint64_t waitNanos, std::uint64_t holdNanos, bool contended) {
+    auto& lock = local().locks[static_cast<size_t>(id)];
+    lock.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    if (contended) {
+        lock.contended.fetch_add(1, std::memory_order_relaxed);
+    }
+    lock.wait.record(waitNanos);
+    lock.hold.record(holdNanos);
+}
+
+MetricsSnapshot Metrics::snapshot() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    MetricsSnapshot result = r.retired;
+    result.enabled = enabled();
+    for (const ThreadMetrics* thread : r.threads) {
+        thread->addTo(result);
+    }
+    return result;
+}
+
+void Metrics::reset() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.retired = MetricsSnapshot();
+    for (ThreadMetrics* thread : r.threads) {
+        thread->clear();
+    }
+}
+
+std::string Metrics::toJson(const MetricsSnapshot& snapshot) {
+    std::ostringstream out;
+    out << std::setprecision(6);
+    out << "{\"compiled\":" << (COMPILED ? "true" : "false")
+        << ",\"enabled\":" << (snapshot.enabled ? "true" : "false") << ",\"counters\":{";
+    for (size_t c = 0; c < METRIC_COUNTER_COUNT; ++c) {
+        out << (c ? "," : "") << "\"" << COUNTER_INFO[c].key << "\":" << snapshot.counters[c];
+    }
+    out << "},\"histograms\":{";
+    for (size_t h = 0; h < METRIC_HISTOGRAM_COUNT; ++h) {
+        out << (h ? "," : "") << "\"" << HISTOGRAM_INFO[h].key << "\":";
+        writeJsonHistogram(out, snapshot.histograms[h], HISTOGRAM_INFO[h].nanos);
+    }
+    out << "},\"locks\":{";
+    for (size_t l = 0; l < LOCK_ID_COUNT; ++l) {
+        const auto& lock = snapshot.locks[l];
+        out << (l ? "," : "") << "\"" << LOCK_NAMES[l] << "\":{\"acquisitions\":" << lock.acquisitions
+            << ",\"contended\":" << lock.contended << ",\"wait\":";
+        writeJsonHistogram(out, lock.wait, true);
+        out << ",\"hold\":";
+        writeJsonHistogram(out, lock.hold, true);
+        out << "}";
+    }
+    out << "}}\n";
+    return out.str();
+}
+
+std::string Metrics::toPrometheus(const MetricsSnapshot& snapshot) {
+    std::ostringstream out;
+    out << std::setprecision(9);
+    std::string lastFamily;
+    for (size_t c = 0; c < METRIC_COUNTER_COUNT; ++c) {
+        writeType(out, lastFamily, COUNTER_INFO[c].family, "counter");
+        out << COUNTER_INFO[c].family << " " << snapshot.counters[c] << "\n";
+    }
+    for (size_t h = 0; h < METRIC_HISTOGRAM_COUNT; ++h) {
+        const auto& info = HISTOGRAM_INFO[h];
+        writeType(out, lastFamily, info.family, "histogram");
+        writePromHistogram(out, info.family, info.labels, snapshot.histograms[h], info.nanos);
+    }
+
+    // Семейства замков - подряд по всем замкам
+    auto lockLabel = [](size_t l) { return std::string("lock=\"") + LOCK_NAMES[l] + "\""; };
+    writeType(out, lastFamily, "laba7_lock_acquisitions_total", "counter");
+    for (size_t l = 0; l < LOCK_ID_COUNT; ++l) {
+        out << "laba7_lock_acquisitions_total{" << lockLabel(l) << "} " << snapshot.locks[l].acquisitions << "\n";
+    }
+    writeType(out, lastFamily, "laba7_lock_contended_total", "counter");
+    for (size_t l = 0; l < LOCK_ID_COUNT; ++l) {
+        out << "laba7_lock_contended_total{" << lockLabel(l) << "} " << snapshot.locks[l].contended << "\n";
+    }
+    writeType(out, lastFamily, "laba7_lock_wait_seconds", "histogram");
+    for (size_t l = 0; l < LOCK_ID_COUNT; ++l) {
+        writePromHistogram(out, "laba7_lock_wait_seconds", lockLabel(l), snapshot.locks[l].wait, true);
+    }
+    writeType(out, lastFamily, "laba7_lock_hold_seconds", "histogram");
+    for (size_t l = 0; l < LOCK_ID_COUNT; ++l) {
+        writePromHistogram(out, "laba7_lock_hold_seconds", lockLabel(l), snapshot.locks[l].hold, true);
+    }
+    return out.str();
+}
+
+bool Metrics::dump(const std::string& path) {
+    std::ofstream file(path);
+    if (!file) return false;
+    MetricsSnapshot current = snapshot();
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    file << (json ? toJson(current) : toPrometheus(current));
+    return static_cast<bool>(file);
+}
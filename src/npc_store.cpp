@@ -0,0 +1,203 @@
+#include "../include/npc_store.h"
+#include "../include/simd_kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+NPCStore::Index NPCStore::add(NPCType type, const std::string& name, float x, float y) {
+    if (typeIndex(type) >= NPC_TYPE_COUNT) {
+        throw std::invalid_argument("Unknown NPC type");
+    }
+    ++nameVersion;
+
+    if (!freeSlots.empty()) {
+        Index index = freeSlots.back();
+        freeSlots.pop_back();
+
+        xs[index] = x;
+        ys[index] = y;
+        types[index] = type;
+        alive.store(index, 1);
+        used[index] = 1;
+        names[nameIndices[index]] = name;
+        return index;
+    }
+
+    auto index = static_cast<Index>(xs.size());
+    xs.push_back(x);
+    ys.push_back(y);
+    types.push_back(type);
+    alive.pushBack(1);
+    used.push_back(1);
+    nameIndices.push_back(static_cast<std::uint32_t>(names.size()));
+    names.push_back(name);
+    if (generations.size() <= index) {
+        generations.pushBack(0);
+    }
+    return index;
+}
+
+NPCStore::Index NPCStore::add(const NPC& npc) {
+    Index index = add(npc.getTypeId(), npc.getName(), npc.getX(), npc.getY());
+    if (!npc.isAlive()) {
+        kill(index);
+    }
+    return index;
+}
+
+void NPCStore::clear() {
+    // Поколения сохраняются: старые дескрипторы не должны ожить
+    for (size_t i = 0; i < xs.size(); ++i) {
+        generations.fetchAdd(i, 1);
+    }
+    freeSlots.clear();
+    ++nameVersion;
+    used.clear();
+    xs.clear();
+    ys.clear();
+    types.clear();
+    alive.clear();
+    nameIndices.clear();
+    names.clear();
+}
+
+void NPCStore::removeDead() {
+    std::vector<std::string> liveNames;
+    liveNames.reserve(aliveCount());
+
+    size_t out = 0;
+    for (size_t i = 0; i < xs.size(); ++i) {
+        if (!alive.load(i)) continue;
+
+        if (out != i) {
+            // Старые дескрипторы обоих слотов становятся устаревшими
+            std::uint32_t generation = std::max(generations.load(out), generations.load(i)) + 1;
+            generations.store(out, generation);
+        }
+        xs[out] = xs[i];
+        ys[out] = ys[i];
+        types[out] = types[i];
+        alive.store(out, 1);
+        used[out] = 1;
+        nameIndices[out] = static_cast<std::uint32_t>(liveNames.size());
+        liveNames.push_back(std::move(names[nameIndices[i]]));
+        ++out;
+    }
+
+    for (size_t i = out; i < xs.size(); ++i) {
+        generations.fetchAdd(i, 1);
+    }
+    freeSlots.clear();
+
+    xs.resize(out);
+    ys.resize(out);
+    types.resize(out);
+    alive.resize(out);
+    used.resize(out);
+    nameIndices.resize(out);
+    names = std::move(liveNames);
+    ++nameVersion;
+}
+
+void NPCStore::release(Index i) {
+    if (!used[i]) return;
+
+    alive.store(i, 0);
+    used[i] = 0;
+    generations.fetchAdd(i, 1);
+    freeSlots.push_back(i);
+}
+
+size_t NPCStore::releaseDead() {
+    size_t released = 0;
+    for (Index i = 0; i < xs.size(); ++i) {
+        if (used[i] && !alive.load(i)) {
+            release(i);
+            ++released;
+        }
+    }
+    return released;
+}
+
+size_t NPCStore::aliveCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < alive.size(); ++i) {
+        count += alive.load(i, std::memory_order_relaxed);
+    }
+    return count;
+}
+
+void NPCStore::move(Index i, int dx, int dy, int maxX, int maxY) {
+    if (!alive.load(i)) return;
+
+    int distance = traitsOf(types[i]).moveDistance;
+    float x = xs[i] + dx * distance;
+    float y = ys[i] + dy * distance;
+
+    // Проверяем границы карты
+    if (x < 0) x = 0;
+    if (x >= maxX) x = maxX - 1;
+    if (y < 0) y = 0;
+    if (y >= maxY) y = maxY - 1;
+
+    xs[i] = x;
+    ys[i] = y;
+}
+
+void NPCStore::moveAll(const float* dirX, const float* dirY, int maxX, int maxY) {
+    moveRange(0, static_cast<Index>(xs.size()), dirX, dirY, maxX, maxY);
+}
+
+void NPCStore::moveRange(Index begin, Index end, const float* dirX, const float* dirY,
+                         int maxX, int maxY) {
+    // Буфер свой у каждого потока
+    thread_local std::vector<float> moveDistances;
+    moveDistances.resize(end - begin);
+    for (Index i = begin; i < end; ++i) {
+        moveDistances[i - begin] = alive.load(i, std::memory_order_relaxed)
+                                       ? static_cast<float>(traitsOf(types[i]).moveDistance)
+                                       : 0.0f;
+    }
+
+    SimdKernels::moveBatch(xs.data() + begin, ys.data() + begin, dirX + begin, dirY + begin,
+                           moveDistances.data(), end - begin,
+                           static_cast<float>(maxX), static_cast<float>(maxY));
+}
+
+void NPCStore::moveIndices(const Index* ids, size_t count, const float* dirX, const float* dirY,
+                           int maxX, int maxY) {
+    thread_local std::vector<float> gatheredX, gatheredY, moveDistances;
+    gatheredX.resize(count);
+    gatheredY.resize(count);
+    moveDistances.resize(count);
+    for (size_t k = 0; k < count; ++k) {
+        Index i = ids[k];
+        gatheredX[k] = xs[i];
+        gatheredY[k] = ys[i];
+        moveDistances[k] = alive.load(i, std::memory_order_relaxed)
+                               ? static_cast<float>(traitsOf(types[i]).moveDistance)
+                               : 0.0f;
+    }
+
+    SimdKernels::moveBatch(gatheredX.data(), gatheredY.data(), dirX, dirY, moveDistances.data(),
+                           count, static_cast<float>(maxX), static_cast<float>(maxY));
+
+    for (size_t k = 0; k < count; ++k) {
+        xs[ids[k]] = gatheredX[k];
+        ys[ids[k]] = gatheredY[k];
+    }
+}
+
+std::pair<int, int> NPCView::getPosition() const {
+    return {static_cast<int>(getX()), static_cast<int>(getY())};
+}
+
+float NPCView::distanceTo(const NPCView& other) const {
+    float dx = getX() - other.getX();
+    float dy = getY() - other.getY();
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+bool NPCView::isInRange(const NPCView& other, float range) const {
+    return distanceTo(other) <= range;
+}
@@ -2,11 +2,19 @@
 #include <cmath>
 #include <iostream>
 
+bool parseNPCType(const std::string& name, NPCType& type) {
+    for (std::size_t i = 0; i < NPC_TYPE_COUNT; ++i) {
+        if (name == NPC_TRAITS[i].name) {
+            type = static_cast<NPCType>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
 // Реализация базового класса NPC
-NPC::NPC(const std::string& name, float x, float y, 
-         int moveDist, int killDist, char sym) 
-    : name(name), x(x), y(y), alive(true), 
-      moveDistance(moveDist), killDistance(killDist), symbol(sym) {}
+NPC::NPC(const std::string& name, float x, float y, NPCType type) 
+    : name(name), x(x), y(y), alive(true), type(type) {}
 
 std::string NPC::getName() const { return name; }
 float NPC::getX() const { return x; }
@@ -28,6 +36,7 @@ bool NPC::isInRange(const NPC& other, float range) const {
 void NPC::move(int dx, int dy, int maxX, int maxY) {
     if (!alive) return;
     
+    int moveDistance = getMoveDistance();
     dx *= moveDistance;
     dy *= moveDistance;
     
@@ -41,56 +50,7 @@ void NPC::move(int dx, int dy, int maxX, int maxY) {
     if (y >= maxY) y = maxY - 1;
 }
 
-// Реализация Orc (20 - дистанция хода, 10 - дистанция убийства)
-Orc::Orc(const std::string& name, float x, float y) 
-    : NPC(name, x, y, 20, 10, 'O') {}
-
-std::string Orc::getType() const { return "Orc"; }
-
-void Orc::accept(NPCVisitor& visitor) {
-    visitor.visit(*this);
-}
-
-bool Orc::canAttack(const NPC& other) const {
-    return other.getType() == "Bear";
-}
-
-bool Orc::canBeAttackedBy(const NPC& other) const {
-    return other.getType() == "Knight";
-}
-
-// Реализация Knight (30 - дистанция хода, 10 - дистанция убийства)
-Knight::Knight(const std::string& name, float x, float y) 
-    : NPC(name, x, y, 30, 10, 'K') {}
-
-std::string Knight::getType() const { return "Knight"; }
-
-void Knight::accept(NPCVisitor& visitor) {
-    visitor.visit(*this);
-}
-
-bool Knight::canAttack(const NPC& other) const {
-    return other.getType() == "Orc";
-}
-
-bool Knight::canBeAttackedBy(const NPC& other) const {
-    return other.getType() == "Bear";
-}
-
-// Реализация Bear (5 - дистанция хода, 10 - дистанция убийства)
-Bear::Bear(const std::string& name, float x, float y) 
-    : NPC(name, x, y, 5, 10, 'B') {}
-
-std::string Bear::getType() const { return "Bear"; }
-
-void Bear::accept(NPCVisitor& visitor) {
-    visitor.visit(*this);
-}
-
-bool Bear::canAttack(const NPC& other) const {
-    return other.getType() == "Knight";
-}
-
-bool Bear::canBeAttackedBy(const NPC& other) const {
-    return other.getType() == "Orc";
-}
+// Orc, Knight и Bear целиком описаны в npcs.h через NPCOf<T> и TRAITS:
+// Orc: 20 - дистанция хода, 10 - дистанция убийства
+// Knight: 30 - дистанция хода, 10 - дистанция убийства
+// Bear: 5 - дистанция хода, 10 - дистанция убийства
@@ -1,34 +1,714 @@
 #include "../include/observer.h"
-#include <fstream>
+#include "../include/metrics.h"
+#include "../include/alloc_tracker.h"
 #include <iostream>
 #include <algorithm> 
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <fcntl.h>
+#include <unistd.h>
 
-FileLogger::FileLogger(const std::string& filename) : filename(filename) {}
+// Строк за одно извлечение из кольца
+static constexpr size_t DRAIN_BATCH = 256;
+
+FileLogger::FileLogger(const std::string& filename, const FileLoggerOptions& options)
+    : filename(filename), options(options), ring(std::max<size_t>(2, options.capacity)),
+      wakeThreshold(std::max<size_t>(1, ring.capacity() / 2)) {
+}
+
+void FileLogger::open() {
+    int opened = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (opened < 0) return;
+    fd.store(opened, std::memory_order_release);
+    writer = std::thread(&FileLogger::writerLoop, this);
+    started.store(true, std::memory_order_release);
+}
+
+FileLogger::~FileLogger() {
+    if (writer.joinable()) {
+        stopping.store(true, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+        }
+        wakeCV.notify_one();
+        writer.join();
+    }
+    int opened = fd.load(std::memory_order_relaxed);
+    if (opened >= 0) {
+        ::close(opened);
+    }
+}
 
 void FileLogger::onBattleResult(const std::string& result) {
-    std::ofstream file(filename, std::ios_base::app);
-    if (file.is_open()) {
-        file << result << std::endl;
+    Line line;
+    line.names = nullptr;
+    line.length = static_cast<std::uint16_t>(std::min(result.size(), MAX_LINE));
+    std::memcpy(line.text, result.data(), line.length);
+    if (result.size() > MAX_LINE) {
+        truncated.fetch_add(1, std::memory_order_relaxed);
+    }
+    push(line);
+}
+
+void FileLogger::onBattleEvent(const BattleEvent& event, const NameTable& names) {
+    Line line;
+    line.names = &names;
+    line.event = event;
+    line.length = 0;
+    push(line);
+}
+
+void FileLogger::push(const Line& line) {
+    std::call_once(openOnce, [this]() { open(); });
+    if (fd.load(std::memory_order_relaxed) < 0 || !ring.tryPush(line)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    logged.fetch_add(1, std::memory_order_relaxed);
+
+    // Поток записи спит до flushInterval; наполовину полное кольцо будит его раньше
+    if (writerSleeping.load(std::memory_order_relaxed) && ring.sizeApprox() >= wakeThreshold) {
+        {
+            std::lock_guard<std::mutex> lock(wakeMutex);
+        }
+        wakeCV.notify_one();
+    }
+}
+
+void FileLogger::flush() {
+    if (!started.load(std::memory_order_acquire)) return;
+
+    std::uint64_t request = flushRequested.fetch_add(1, std::memory_order_acq_rel) + 1;
+    std::unique_lock<std::mutex> lock(wakeMutex);
+    wakeCV.notify_one();
+    while (flushDone.load(std::memory_order_acquire) < request) {
+        flushCV.wait_for(lock, options.flushInterval);
+    }
+}
+
+FileLoggerStats FileLogger::stats() const {
+    FileLoggerStats result;
+    result.logged = logged.load(std::memory_order_relaxed);
+    result.dropped = dropped.load(std::memory_order_relaxed);
+    result.truncated = truncated.load(std::memory_order_relaxed);
+    result.writes = writes.load(std::memory_order_relaxed);
+    result.bytesWritten = bytesWritten.load(std::memory_order_relaxed);
+    result.syncs = syncs.load(std::memory_order_relaxed);
+    return result;
+}
+
+void FileLogger::writeOut(std::string& buffer) {
+    size_t done = 0;
+    while (done < buffer.size()) {
+        ssize_t n = ::write(fd.load(std::memory_order_relaxed), buffer.data() + done, buffer.size() - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;      // диск полон или файл недоступен: остаток теряется
+        }
+        done += static_cast<size_t>(n);
+    }
+    writes.fetch_add(1, std::memory_order_relaxed);
+    bytesWritten.fetch_add(done, std::memory_order_relaxed);
+    buffer.clear();
+    unsynced = true;
+    if (options.sync == SyncPolicy::EveryBatch) {
+        sync();
+    }
+}
+
+void FileLogger::sync() {
+    if (!unsynced) return;
+    ::fsync(fd.load(std::memory_order_relaxed));
+    syncs.fetch_add(1, std::memory_order_relaxed);
+    unsynced = false;
+}
+
+void FileLogger::writerLoop() {
+    using Clock = std::chrono::steady_clock;
+    std::vector<Line> batch(DRAIN_BATCH);
+    std::string buffer;
+    buffer.reserve(options.batchBytes + MAX_LINE + 1);
+    Clock::time_point firstPending = Clock::time_point::max();
+    Clock::time_point lastSync = Clock::now();
+
+    for (;;) {
+        // Запросы и остановка читаются до разбора кольца: все, что принято
+        // до них, будет извлечено ниже
+        bool stop = stopping.load(std::memory_order_acquire);
+        std::uint64_t request = flushRequested.load(std::memory_order_acquire);
+
+        size_t count;
+        while ((count = ring.tryPopBatch(batch.data(), batch.size())) > 0) {
+            for (size_t i = 0; i < count; ++i) {
+                if (batch[i].names) {
+                    appendBattleEvent(buffer, batch[i].event, *batch[i].names);
+                } else {
+                    buffer.append(batch[i].text, batch[i].length);
+                }
+                buffer.push_back('\n');
+            }
+            if (firstPending == Clock::time_point::max()) firstPending = Clock::now();
+            if (buffer.size() >= options.batchBytes) {
+                writeOut(buffer);
+                firstPending = Clock::time_point::max();
+            }
+        }
+
+        auto now = Clock::now();
+        bool flushing = request != flushDone.load(std::memory_order_relaxed);
+        if (!buffer.empty() && (stop || flushing || now - firstPending >= options.flushInterval)) {
+            writeOut(buffer);
+            firstPending = Clock::time_point::max();
+        }
+        if (options.sync == SyncPolicy::Periodic && unsynced && now - lastSync >= options.syncInterval) {
+            sync();
+            lastSync = now;
+        }
+        if (stop || flushing) {
+            if (options.sync != SyncPolicy::None) sync();
+            std::lock_guard<std::mutex> lock(wakeMutex);
+            flushDone.store(request, std::memory_order_release);
+            flushCV.notify_all();
+        }
+        if (stop) break;
+
+        // Сон до срока ближайшей записи (или fsync), пока кольцо не наполнится
+        Clock::duration timeout = options.flushInterval;
+        if (!buffer.empty()) {
+            timeout = std::max<Clock::duration>(Clock::duration::zero(), firstPending + options.flushInterval - now);
+        }
+        if (options.sync == SyncPolicy::Periodic && unsynced) {
+            timeout = std::min<Clock::duration>(timeout, lastSync + options.syncInterval - now);
+        }
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        writerSleeping.store(true, std::memory_order_relaxed);
+        if (!stopping.load(std::memory_order_acquire) &&
+            flushRequested.load(std::memory_order_acquire) == request &&
+            ring.sizeApprox() < wakeThreshold && timeout > Clock::duration::zero()) {
+            wakeCV.wait_for(lock, timeout);
+        }
+        writerSleeping.store(false, std::memory_order_relaxed);
     }
 }
 
+ConsoleLogger::ConsoleLogger(const ConsoleLoggerOptions& options, std::ostream& out)
+    : options(options), out(out), windowStart(Clock::now()) {
+    this->options.sampleEvery = std::max<std::uint32_t>(1, options.sampleEvery);
+}
+
+void ConsoleLogger::write(const std::string& text) {
+    out << text << std::flush;
+}
+
 void ConsoleLogger::onBattleResult(const std::string& result) {
-    std::cout << result << std::endl;
+    std::string text;
+    std::lock_guard<std::mutex> lock(mutex);
+    ++totals.events;
+    rollWindow(Clock::now(), text);
+    if (options.mode == ConsoleMode::Summary) {
+        ++windowMessages;
+    } else if (admitLine()) {
+        text += result;
+        text += '\n';
+    }
+    if (!text.empty()) write(text);
+}
+
+void ConsoleLogger::onBattleEvent(const BattleEvent& event, const NameTable& table) {
+    std::string text;
+    std::lock_guard<std::mutex> lock(mutex);
+    ++totals.events;
+    names = &table;
+    rollWindow(Clock::now(), text);
+    if (options.mode == ConsoleMode::Summary) {
+        ++windowFought;
+        switch (event.result) {
+            case BattleResult::AttackerKills:
+                countKill(event.attackerType, event.attacker, event.defenderType);
+                break;
+            case BattleResult::DefenderKills:
+                countKill(event.defenderType, event.defender, event.attackerType);
+                break;
+            case BattleResult::BothDie:
+                countKill(event.attackerType, event.attacker, event.defenderType);
+                countKill(event.defenderType, event.defender, event.attackerType);
+                break;
+            case BattleResult::Defended:
+                ++windowDefended;
+                break;
+        }
+    } else if (admitLine()) {
+        // Текст собирается только для строк, которые будут напечатаны
+        appendBattleEvent(text, event, table);
+        text += '\n';
+    }
+    if (!text.empty()) write(text);
+}
+
+void ConsoleLogger::flush() {
+    std::string text;
+    std::lock_guard<std::mutex> lock(mutex);
+    closeWindow(Clock::now(), text);
+    if (!text.empty()) write(text);
+}
+
+ConsoleLoggerStats ConsoleLogger::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return totals;
+}
+
+bool ConsoleLogger::admitLine() {
+    if (sampleCounter++ % options.sampleEvery != 0) {
+        ++totals.sampledOut;
+        ++windowSuppressed;
+        return false;
+    }
+    if (options.maxLinesPerSecond != 0 && windowLines >= options.maxLinesPerSecond) {
+        ++totals.rateLimited;
+        ++windowSuppressed;
+        return false;
+    }
+    ++windowLines;
+    ++totals.printed;
+    return true;
+}
+
+void ConsoleLogger::countKill(NPCType killer, EntityHandle handle, NPCType victim) {
+    ++pairKills[typeIndex(killer)][typeIndex(victim)];
+    auto it = killers.try_emplace(handle.packed(), Killer{killer, 0}).first;
+    ++it->second.kills;
+}
+
+void ConsoleLogger::rollWindow(Clock::time_point now, std::string& text) {
+    Clock::duration length = options.mode == ConsoleMode::Summary
+        ? Clock::duration(options.summaryInterval) : Clock::duration(std::chrono::seconds(1));
+    if (now - windowStart >= length) {
+        closeWindow(now, text);
+    }
+}
+
+void ConsoleLogger::closeWindow(Clock::time_point now, std::string& text) {
+    if (options.mode == ConsoleMode::Verbose) {
+        if (windowSuppressed > 0) {
+            text += "... " + std::to_string(windowSuppressed) + " battle lines suppressed\n";
+        }
+    } else if (windowFought + windowMessages > 0) {
+        std::uint64_t kills = 0;
+        std::string pairs;
+        for (size_t a = 0; a < NPC_TYPE_COUNT; ++a) {
+            for (size_t d = 0; d < NPC_TYPE_COUNT; ++d) {
+                if (pairKills[a][d] == 0) continue;
+                kills += pairKills[a][d];
+                pairs += pairs.empty() ? " " : ", ";
+                pairs += std::string(NPC_TRAITS[a].name) + ">" + NPC_TRAITS[d].name + " " +
+                         std::to_string(pairKills[a][d]);
+            }
+        }
+
+        char seconds[32];
+        std::snprintf(seconds, sizeof(seconds), "%.1f", std::chrono::duration<double>(now - windowStart).count());
+        text += "Battles (last " + std::string(seconds) + " s): " + std::to_string(windowFought) +
+                " fought, " + std::to_string(kills) + " kills, " + std::to_string(windowDefended) + " defended";
+        if (windowMessages > 0) text += ", " + std::to_string(windowMessages) + " messages";
+        text += '\n';
+        if (!pairs.empty()) text += "  kills:" + pairs + "\n";
+
+        // Лучшие бойцы окна; при равенстве - по дескриптору, чтобы порядок не плавал
+        std::vector<std::pair<std::uint64_t, Killer>> top(killers.begin(), killers.end());
+        size_t shown = std::min(options.topKillers, top.size());
+        std::partial_sort(top.begin(), top.begin() + shown, top.end(), [](const auto& a, const auto& b) {
+            return a.second.kills != b.second.kills ? a.second.kills > b.second.kills : a.first < b.first;
+        });
+        if (shown > 0) {
+            text += "  top killers:";
+            for (size_t i = 0; i < shown; ++i) {
+                EntityHandle handle{static_cast<std::uint32_t>(top[i].first),
+                                    static_cast<std::uint32_t>(top[i].first >> 32)};
+                text += i ? ", " : " ";
+                text += traitsOf(top[i].second.type).name;
+                text += ' ';
+                if (names) {
+                    names->appendName(handle, text);
+                } else {
+                    text += '#' + std::to_string(handle.index);
+                }
+                text += " (" + std::to_string(top[i].second.kills) + ")";
+            }
+            text += '\n';
+        }
+        ++totals.summaries;
+    }
+
+    windowStart = now;
+    windowLines = 0;
+    windowSuppressed = 0;
+    windowFought = 0;
+    windowDefended = 0;
+    windowMessages = 0;
+    for (auto& row : pairKills) {
+        for (auto& count : row) count = 0;
+    }
+    killers.clear();
+}
+
+// Событий за одно извлечение из очереди исполнителя
+static constexpr size_t EXECUTOR_BATCH = 64;
+// Сон исполнителя без событий; будит его производитель, срок - страховка
+static constexpr std::chrono::milliseconds EXECUTOR_IDLE{50};
+
+static const NameTable& namesOrEmpty(const NameTable* names) {
+    static const NameTable empty;
+    return names ? *names : empty;
+}
+
+BattleNotifier::~BattleNotifier() {
+    stopAsync();
 }
 
 void BattleNotifier::addObserver(std::shared_ptr<BattleObserver> observer) {
-    observers.push_back(observer);
+    subscribe(std::move(observer));
 }
 
 void BattleNotifier::removeObserver(std::shared_ptr<BattleObserver> observer) {
-    observers.erase(
-        std::remove(observers.begin(), observers.end(), observer),
-        observers.end()
-    );
+    std::vector<SubscriptionId> ids;
+    for (auto& subscription : subscriptions) {
+        if (subscription->observer == observer) ids.push_back(subscription->id);
+    }
+    for (SubscriptionId id : ids) {
+        unsubscribe(id);
+    }
+}
+
+SubscriptionId BattleNotifier::subscribe(std::shared_ptr<BattleObserver> observer, const BattleFilter& filter) {
+    auto subscription = std::make_shared<Subscription>();
+    subscription->observer = std::move(observer);
+    subscription->filter = filter;
+
+    std::unique_lock<std::shared_mutex> lock(observersMutex);
+    subscription->eventsBefore = events.load(std::memory_order_relaxed);
+    subscription->id = nextId++;
+    index.add(subscription.get());
+    if (!executors.empty()) assign(subscription);
+    subscriptions.push_back(std::move(subscription));
+    return subscriptions.back()->id;
+}
+
+void BattleNotifier::unsubscribe(SubscriptionId id) {
+    std::unique_lock<std::shared_mutex> lock(observersMutex);
+    auto it = std::find_if(subscriptions.begin(), subscriptions.end(),
+                           [id](const auto& subscription) { return subscription->id == id; });
+    if (it == subscriptions.end()) return;
+
+    index.remove(it->get());
+    for (auto& executor : executors) {
+        std::shared_ptr<const Targets> current;
+        {
+            std::lock_guard<std::mutex> targetsLock(executor->targetsMutex);
+            current = executor->targets;
+        }
+        auto owned = std::find(current->subscriptions.begin(), current->subscriptions.end(), *it);
+        if (owned == current->subscriptions.end()) continue;
+        
+        auto next = std::make_shared<Targets>(*current);
+        next->index.remove(it->get());
+        next->subscriptions.erase(next->subscriptions.begin() + (owned - current->subscriptions.begin()));
+        publish(*executor, std::move(next));
+    }
+    subscriptions.erase(it);
+}
+
+SubscriptionStats BattleNotifier::subscriptionStats(SubscriptionId id) const {
+    SubscriptionStats result;
+    std::shared_lock<std::shared_mutex> lock(observersMutex);
+    for (auto& subscription : subscriptions) {
+        if (subscription->id != id) continue;
+        result.delivered = subscription->delivered.load(std::memory_order_relaxed);
+        result.filtered = filteredOf(*subscription);
+    }
+    return result;
+}
+
+std::uint64_t BattleNotifier::filteredOf(const Subscription& subscription) const {
+    std::uint64_t processed = events.load(std::memory_order_relaxed);
+    if (!executors.empty()) {
+        Executor& executor = *executors[subscription.executor];
+        std::lock_guard<std::mutex> lock(executor.targetsMutex);
+        processed = executor.processed;
+    }
+    // Совпадения пачки в работе уже учтены, а сама пачка еще нет
+    std::uint64_t seen = processed - subscription.eventsBefore;
+    std::uint64_t matched = subscription.matched.load(std::memory_order_relaxed) - subscription.matchedBefore;
+    return subscription.filteredBefore + seen - std::min(seen, matched);
+}
+
+void BattleNotifier::rebaseFiltered(std::uint64_t processed) {
+    for (auto& subscription : subscriptions) {
+        subscription->filteredBefore = filteredOf(*subscription);
+        subscription->eventsBefore = processed;
+        subscription->matchedBefore = subscription->matched.load(std::memory_order_relaxed);
+    }
+}
+
+void BattleNotifier::assign(const std::shared_ptr<Subscription>& subscription) {
+    subscription->executor = nextExecutor++ % executors.size();
+    Executor& executor = *executors[subscription->executor];
+    std::shared_ptr<const Targets> current;
+    {
+        std::lock_guard<std::mutex> lock(executor.targetsMutex);
+        current = executor.targets;
+    }
+    auto next = current ? std::make_shared<Targets>(*current) : std::make_shared<Targets>();
+    next->index.add(subscription.get());
+    next->subscriptions.push_back(subscription);
+    publish(executor, std::move(next), subscription.get());
+}
+
+void BattleNotifier::publish(Executor& executor, std::shared_ptr<Targets> targets, Subscription* added) {
+    size_t count = targets->index.size();
+    {
+        std::lock_guard<std::mutex> lock(executor.targetsMutex);
+        executor.targets = std::move(targets);
+        // Пачка в работе идет по старому снимку: ее события не для added
+        if (added) {
+            added->eventsBefore = executor.processed + executor.inflight;
+            added->matchedBefore = added->matched.load(std::memory_order_relaxed);
+        }
+    }
+    executor.subscriptionCount.store(count, std::memory_order_release);
+    // Поток исполнителя появляется вместе с его первой подпиской
+    if (count > 0 && !executor.thread.joinable()) {
+        executor.thread = std::thread(&BattleNotifier::executorLoop, this, std::ref(executor));
+    }
+}
+
+void BattleNotifier::startAsync(const NotifierOptions& asyncOptions) {
+    stopAsync();
+    if (asyncOptions.executors == 0) return;
+
+    options = asyncOptions;
+    stopping.store(false, std::memory_order_release);
+    {
+        std::unique_lock<std::shared_mutex> lock(observersMutex);
+        rebaseFiltered(0);
+        for (size_t i = 0; i < options.executors; ++i) {
+            executors.push_back(std::make_unique<Executor>(std::max<size_t>(2, options.capacity)));
+        }
+        // Снимки собираются целиком, а не по подписке
+        std::vector<std::shared_ptr<Targets>> initial(executors.size());
+        for (auto& targets : initial) targets = std::make_shared<Targets>();
+        for (size_t i = 0; i < subscriptions.size(); ++i) {
+            subscriptions[i]->executor = i % initial.size();
+            Targets& targets = *initial[i % initial.size()];
+            targets.index.add(subscriptions[i].get());
+            targets.subscriptions.push_back(subscriptions[i]);
+        }
+        for (size_t e = 0; e < executors.size(); ++e) {
+            publish(*executors[e], std::move(initial[e]));
+        }
+        nextExecutor = subscriptions.size();
+    }
+}
+
+void BattleNotifier::stopAsync() {
+    if (executors.empty()) return;
+
+    stopping.store(true, std::memory_order_release);
+    for (auto& executor : executors) {
+        {
+            std::lock_guard<std::mutex> lock(executor->mutex);
+        }
+        executor->wakeCV.notify_one();
+        if (executor->thread.joinable()) executor->thread.join();
+    }
+    // Счетчики остановленных исполнителей переходят в общий итог
+    NotifierStats last = stats();
+    std::unique_lock<std::shared_mutex> lock(observersMutex);
+    rebaseFiltered(events.load(std::memory_order_relaxed));
+    retiredQueued = last.queued;
+    retiredDelivered = last.delivered;
+    retiredMaxDepth = last.maxDepth;
+    executors.clear();
+}
+
+void BattleNotifier::flush() {
+    for (auto& executor : executors) {
+        std::uint64_t target = executor->accepted.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(executor->mutex);
+        executor->flushWaiters.fetch_add(1, std::memory_order_acq_rel);
+        executor->wakeCV.notify_one();
+        while (executor->retired.load(std::memory_order_acquire) < target) {
+            executor->doneCV.wait_for(lock, EXECUTOR_IDLE);
+        }
+        executor->flushWaiters.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+NotifierStats BattleNotifier::stats() const {
+    NotifierStats result;
+    result.queued = retiredQueued;
+    result.delivered = retiredDelivered;
+    result.maxDepth = retiredMaxDepth;
+    for (auto& executor : executors) {
+        result.queued += executor->accepted.load(std::memory_order_relaxed);
+        result.delivered += executor->delivered.load(std::memory_order_relaxed);
+        result.maxDepth = std::max(result.maxDepth, executor->maxDepth.load(std::memory_order_relaxed));
+    }
+    result.dropped = dropped.load(std::memory_order_relaxed);
+    return result;
 }
 
 void BattleNotifier::notifyObservers(const std::string& result) {
-    for (auto& observer : observers) {
-        observer->onBattleResult(result);
+    notifyObservers(result, EntityHandle{}, EntityHandle{});
+}
+
+void BattleNotifier::notifyObservers(const std::string& result, 
+                                     EntityHandle attacker, EntityHandle defender) {
+    ScopedTimer timer(MetricHistogram::ObserverDispatch);
+    ScopedAllocTag tag(AllocTag::Logging);
+    if (Metrics::enabled()) Metrics::add(MetricCounter::ObserverEvents);
+    if (!executors.empty()) {
+        Message message;
+        message.structured = false;
+        message.event.attacker = attacker;
+        message.event.defender = defender;
+        message.text = result;
+        enqueue(message);
+        return;
+    }
+    for (Subscription* subscription : index.unfiltered()) {
+        subscription->delivered.fetch_add(1, std::memory_order_relaxed);
+        subscription->observer->onBattle(attacker, defender, result);
+    }
+}
+
+void BattleNotifier::notifyObservers(const BattleEvent& event) {
+    ScopedTimer timer(MetricHistogram::ObserverDispatch);
+    ScopedAllocTag tag(AllocTag::Logging);
+    if (Metrics::enabled()) Metrics::add(MetricCounter::ObserverEvents);
+    events.fetch_add(1, std::memory_order_relaxed);
+    if (!executors.empty()) {
+        Message message;
+        message.event = event;
+        enqueue(message);
+        return;
+    }
+    const NameTable& table = namesOrEmpty(names);
+    index.forEachMatch(event, [&](Subscription& subscription) {
+        subscription.delivered.fetch_add(1, std::memory_order_relaxed);
+        subscription.matched.fetch_add(1, std::memory_order_relaxed);
+        subscription.observer->onBattleEvent(event, table);
+    });
+}
+
+void BattleNotifier::enqueue(const Message& message) {
+    for (auto& executor : executors) {
+        // Исполнителю без подписок событие не нужно
+        if (executor->subscriptionCount.load(std::memory_order_acquire) == 0) continue;
+        push(*executor, message);
+    }
+}
+
+void BattleNotifier::push(Executor& executor, const Message& message) {
+    while (!executor.queue.tryPush(message)) {
+        if (options.backpressure == NotifyBackpressure::DropOldest) {
+            Message oldest;
+            if (executor.queue.tryPop(oldest)) {
+                executor.retired.fetch_add(1, std::memory_order_release);
+                dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else if (options.backpressure == NotifyBackpressure::Block &&
+                   !stopping.load(std::memory_order_acquire)) {
+            wake(executor);
+            std::this_thread::yield();
+        } else {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    executor.accepted.fetch_add(1, std::memory_order_release);
+
+    size_t depth = executor.queue.sizeApprox();
+    size_t seen = executor.maxDepth.load(std::memory_order_relaxed);
+    while (depth > seen &&
+           !executor.maxDepth.compare_exchange_weak(seen, depth, std::memory_order_relaxed)) {
+    }
+    wake(executor);
+}
+
+void BattleNotifier::wake(Executor& executor) {
+    // Пара к барьеру исполнителя перед сном: либо он увидит событие,
+    // либо мы увидим, что он спит
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!executor.sleeping.load(std::memory_order_relaxed)) return;
+    {
+        std::lock_guard<std::mutex> lock(executor.mutex);
+    }
+    executor.wakeCV.notify_one();
+}
+
+void BattleNotifier::deliver(const Message& message, const SubscriptionIndex& targets) {
+    if (message.structured) {
+        const NameTable& table = namesOrEmpty(names);
+        targets.forEachMatch(message.event, [&](Subscription& subscription) {
+            subscription.delivered.fetch_add(1, std::memory_order_relaxed);
+            subscription.matched.fetch_add(1, std::memory_order_relaxed);
+            subscription.observer->onBattleEvent(message.event, table);
+        });
+    } else {
+        for (Subscription* subscription : targets.unfiltered()) {
+            subscription->delivered.fetch_add(1, std::memory_order_relaxed);
+            subscription->observer->onBattle(message.event.attacker, message.event.defender, message.text);
+        }
+    }
+}
+
+void BattleNotifier::executorLoop(Executor& executor) {
+    ScopedAllocTag tag(AllocTag::Logging);
+    std::vector<Message> batch(EXECUTOR_BATCH);
+
+    for (;;) {
+        // Остановка читается до разбора очереди: принятое до нее будет доставлено
+        bool stop = stopping.load(std::memory_order_acquire);
+
+        size_t count;
+        while ((count = executor.queue.tryPopBatch(batch.data(), batch.size())) > 0) {
+            // Рассылка по снимку: подписка и отписка не ждут наблюдателей
+            // Отсеянное считается здесь: processed растет вместе с рассылкой
+            std::uint64_t structured = 0;
+            for (size_t i = 0; i < count; ++i) {
+                structured += batch[i].structured;
+            }
+            std::shared_ptr<const Targets> targets;
+            {
+                std::lock_guard<std::mutex> lock(executor.targetsMutex);
+                targets = executor.targets;
+                executor.inflight = structured;
+            }
+            for (size_t i = 0; i < count; ++i) {
+                deliver(batch[i], targets->index);
+            }
+            {
+                std::lock_guard<std::mutex> lock(executor.targetsMutex);
+                executor.processed += structured;
+                executor.inflight = 0;
+            }
+            executor.delivered.fetch_add(count, std::memory_order_relaxed);
+            executor.retired.fetch_add(count, std::memory_order_release);
+            if (executor.flushWaiters.load(std::memory_order_acquire) > 0) {
+                std::lock_guard<std::mutex> lock(executor.mutex);
+                executor.doneCV.notify_all();
+            }
+        }
+        if (stop) break;
+
+        std::unique_lock<std::mutex> lock(executor.mutex);
+        executor.sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (executor.queue.sizeApprox() == 0 && !stopping.load(std::memory_order_acquire)) {
+            executor.wakeCV.wait_for(lock, EXECUTOR_IDLE);
+        }
+        executor.sleeping.store(false, std::memory_order_relaxed);
     }
 }
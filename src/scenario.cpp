@@ -0,0 +1,93 @@
+#include "../include/scenario.h"
+#include <algorithm>
+#include <random>
+
+std::vector<NPCSpawn> ScenarioGenerator::generate(ScenarioKind kind, int count, int width, int height,
+                                                  std::uint64_t seed) {
+    std::mt19937 gen(static_cast<std::mt19937::result_type>(seed));
+    std::uniform_int_distribution<> typeDist(0, NPC_TYPE_COUNT - 1);
+    std::uniform_int_distribution<> xDist(0, width - 1);
+    std::uniform_int_distribution<> yDist(0, height - 1);
+
+    std::vector<NPCSpawn> spawns;
+    spawns.reserve(std::max(count, 0));
+
+    switch (kind) {
+        case ScenarioKind::Uniform:
+            // Тот же порядок выборок, что у прежней расстановки GameManager
+            for (int i = 0; i < count; ++i) {
+                auto type = static_cast<NPCType>(typeDist(gen));
+                int x = xDist(gen);
+                int y = yDist(gen);
+                spawns.push_back({type, static_cast<float>(x), static_cast<float>(y)});
+            }
+            break;
+
+        case ScenarioKind::Clusters: {
+            int clusters = std::max(1, (count + CLUSTER_SIZE - 1) / CLUSTER_SIZE);
+            std::vector<std::pair<float, float>> centres;
+            for (int c = 0; c < clusters; ++c) {
+                centres.emplace_back(static_cast<float>(xDist(gen)), static_cast<float>(yDist(gen)));
+            }
+            std::normal_distribution<float> offset(0.0f, CLUSTER_RADIUS / 2);
+            for (int i = 0; i < count; ++i) {
+                const auto& centre = centres[i % clusters];
+                float x = std::clamp(centre.first + offset(gen), 0.0f, width - 1.0f);
+                float y = std::clamp(centre.second + offset(gen), 0.0f, height - 1.0f);
+                spawns.push_back({static_cast<NPCType>(typeDist(gen)), x, y});
+            }
+            break;
+        }
+
+        case ScenarioKind::OneCell: {
+            // Квадрат 1 x 1 в центре меньше любой дистанции убийства
+            std::uniform_real_distribution<float> inCell(0.0f, 1.0f);
+            float baseX = static_cast<float>(width / 2);
+            float baseY = static_cast<float>(height / 2);
+            for (int i = 0; i < count; ++i) {
+                auto type = static_cast<NPCType>(typeDist(gen));
+                float x = std::min(baseX + inCell(gen), width - 1.0f);
+                float y = std::min(baseY + inCell(gen), height - 1.0f);
+                spawns.push_back({type, x, y});
+            }
+            break;
+        }
+
+        case ScenarioKind::SingleType:
+        case ScenarioKind::Balanced:
+            for (int i = 0; i < count; ++i) {
+                auto type = kind == ScenarioKind::SingleType
+                                ? NPCType::Orc : static_cast<NPCType>(i % NPC_TYPE_COUNT);
+                int x = xDist(gen);
+                int y = yDist(gen);
+                spawns.push_back({type, static_cast<float>(x), static_cast<float>(y)});
+            }
+            break;
+    }
+    return spawns;
+}
+
+std::string ScenarioGenerator::name(ScenarioKind kind) {
+    switch (kind) {
+        case ScenarioKind::Uniform: return "uniform";
+        case ScenarioKind::Clusters: return "clusters";
+        case ScenarioKind::OneCell: return "one-cell";
+        case ScenarioKind::SingleType: return "single-type";
+        case ScenarioKind::Balanced: return "balanced";
+    }
+    return "unknown";
+}
+
+std::optional<ScenarioKind> ScenarioGenerator::parse(const std::string& name) {
+    for (ScenarioKind kind : all()) {
+        if (ScenarioGenerator::name(kind) == name) return kind;
+    }
+    return std::nullopt;
+}
+
+const std::vector<ScenarioKind>& ScenarioGenerator::all() {
+    static const std::vector<ScenarioKind> kinds = {
+        ScenarioKind::Uniform, ScenarioKind::Clusters, ScenarioKind::OneCell,
+        ScenarioKind::SingleType, ScenarioKind::Balanced};
+    return kinds;
+}
@@ -0,0 +1,190 @@
+#include "../include/shared_snapshot.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+size_t headerSize() {
+    return (sizeof(shared_snapshot::Header) + 63) / 64 * 64;
+}
+
+// Колонки сегмента по порядку: xs, ys, types, alive
+struct Columns {
+    float* xs;
+    float* ys;
+    std::uint8_t* types;
+    std::uint8_t* alive;
+};
+
+Columns columnsOf(void* memory, std::uint32_t capacity) {
+    auto* base = static_cast<unsigned char*>(memory) + headerSize();
+    Columns columns;
+    columns.xs = reinterpret_cast<float*>(base);
+    columns.ys = columns.xs + capacity;
+    columns.types = reinterpret_cast<std::uint8_t*>(columns.ys + capacity);
+    columns.alive = columns.types + capacity;
+    return columns;
+}
+
+std::runtime_error systemError(const std::string& what, const std::string& name) {
+    return std::runtime_error(what + " '" + name + "': " + std::strerror(errno));
+}
+
+}  // namespace
+
+size_t shared_snapshot::segmentSize(std::uint32_t capacity) {
+    return headerSize() + size_t(capacity) * (2 * sizeof(float) + 2 * sizeof(std::uint8_t));
+}
+
+SharedSnapshotWriter::SharedSnapshotWriter(const std::string& name, std::uint32_t capacity)
+    : name(name), capacity(capacity), size(shared_snapshot::segmentSize(capacity)) {
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 && errno == EEXIST) {
+        throw std::runtime_error("shared memory '" + name + "' is already in use; pass another --shm-name"
+                                 " or remove /dev/shm" + name + " left by a crashed run");
+    }
+    if (fd < 0) throw systemError("shm_open failed for", name);
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw systemError("ftruncate failed for", name);
+    }
+    memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        memory = nullptr;
+        shm_unlink(name.c_str());
+        throw systemError("mmap failed for", name);
+    }
+
+    // Заголовок заполняется до magic: читатель не примет недописанный сегмент
+    header = static_cast<shared_snapshot::Header*>(memory);
+    header->version = shared_snapshot::VERSION;
+    header->capacity = capacity;
+    header->typeCount = NPC_TYPE_COUNT;
+    new (&header->sequence) std::atomic<std::uint64_t>(0);
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = shared_snapshot::MAGIC;
+}
+
+SharedSnapshotWriter::~SharedSnapshotWriter() {
+    if (memory) {
+        munmap(memory, size);
+        shm_unlink(name.c_str());
+    }
+}
+
+void SharedSnapshotWriter::publish(const NPCStore& npcs, std::uint64_t tick,
+                                   const std::array<size_t, NPC_TYPE_COUNT>& typeCounts,
+                                   size_t aliveCount) {
+    std::uint32_t count = static_cast<std::uint32_t>(std::min<size_t>(npcs.size(), capacity));
+    Columns columns = columnsOf(memory, capacity);
+
+    // Нечетный sequence: кадр пишется
+    std::uint64_t seq = header->sequence.load(std::memory_order_relaxed);
+    header->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    header->tick = tick;
+    header->publishNanos = static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    header->count = count;
+    header->totalCount = static_cast<std::uint32_t>(npcs.size());
+    header->aliveCount = aliveCount;
+    for (size_t t = 0; t < NPC_TYPE_COUNT; ++t) {
+        header->typeCounts[t] = typeCounts[t];
+    }
+
+    std::memcpy(columns.xs, npcs.xData(), count * sizeof(float));
+    std::memcpy(columns.ys, npcs.yData(), count * sizeof(float));
+    for (NPCStore::Index i = 0; i < count; ++i) {
+        columns.types[i] = static_cast<std::uint8_t>(typeIndex(npcs.getType(i)));
+        columns.alive[i] = npcs.isAlive(i);
+    }
+
+    header->sequence.store(seq + 2, std::memory_order_release);
+    ++publishes;
+}
+
+SharedSnapshotReader::SharedSnapshotReader(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) throw systemError("shm_open failed for", name);
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < headerSize()) {
+        close(fd);
+        throw std::runtime_error("shared snapshot '" + name + "' is too small");
+    }
+    size = static_cast<size_t>(info.st_size);
+    memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) {
+        memory = nullptr;
+        throw systemError("mmap failed for", name);
+    }
+
+    header = static_cast<const shared_snapshot::Header*>(memory);
+    if (header->magic != shared_snapshot::MAGIC || header->version != shared_snapshot::VERSION ||
+        header->typeCount != NPC_TYPE_COUNT ||
+        shared_snapshot::segmentSize(header->capacity) > size) {
+        munmap(memory, size);
+        memory = nullptr;
+        throw std::runtime_error("shared snapshot '" + name + "' has an unknown format");
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    capacity = header->capacity;
+}
+
+SharedSnapshotReader::~SharedSnapshotReader() {
+    if (memory) {
+        munmap(memory, size);
+    }
+}
+
+std::uint64_t SharedSnapshotReader::sequence() const {
+    return header->sequence.load(std::memory_order_acquire);
+}
+
+bool SharedSnapshotReader::tryRead(SnapshotFrame& out) const {
+    std::uint64_t before = header->sequence.load(std::memory_order_acquire);
+    if (before & 1) return false;
+
+    std::uint32_t count = std::min(header->count, capacity);
+    out.tick = header->tick;
+    out.publishNanos = header->publishNanos;
+    out.totalCount = header->totalCount;
+    out.aliveCount = header->aliveCount;
+    for (size_t t = 0; t < NPC_TYPE_COUNT; ++t) {
+        out.typeCounts[t] = header->typeCounts[t];
+    }
+
+    Columns columns = columnsOf(memory, capacity);
+    out.xs.assign(columns.xs, columns.xs + count);
+    out.ys.assign(columns.ys, columns.ys + count);
+    out.types.assign(columns.types, columns.types + count);
+    out.alive.assign(columns.alive, columns.alive + count);
+
+    // Кадр согласован, если писатель не начинал новую запись во время копирования
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return header->sequence.load(std::memory_order_relaxed) == before;
+}
+
+size_t SharedSnapshotReader::read(SnapshotFrame& out) const {
+    size_t retries = 0;
+    while (!tryRead(out)) {
+        ++retries;
+        std::this_thread::yield();
+    }
+    return retries;
+}
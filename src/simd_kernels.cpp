@@ -0,0 +1,214 @@
+#include "../include/simd_kernels.h"
+#include <atomic>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LABA7_X86 1
+#include <immintrin.h>
+#endif
+
+// Скалярная реализация - эталон и запасной вариант
+static std::uint64_t maskScalar(float px, float py, const float* xs, const float* ys,
+                                std::size_t count, float radius) {
+    float radiusSq = radius * radius;
+    std::uint64_t mask = 0;
+    for (std::size_t k = 0; k < count; ++k) {
+        float dx = px - xs[k];
+        float dy = py - ys[k];
+        if (dx * dx + dy * dy <= radiusSq) {
+            mask |= std::uint64_t(1) << k;
+        }
+    }
+    return mask;
+}
+
+static void moveScalar(float* xs, float* ys, const float* dirX, const float* dirY,
+                       const float* distance, std::size_t count, float maxX, float maxY) {
+    for (std::size_t i = 0; i < count; ++i) {
+        float x = xs[i] + dirX[i] * distance[i];
+        float y = ys[i] + dirY[i] * distance[i];
+
+        if (x < 0) x = 0;
+        if (x >= maxX) x = maxX - 1;
+        if (y < 0) y = 0;
+        if (y >= maxY) y = maxY - 1;
+
+        xs[i] = x;
+        ys[i] = y;
+    }
+}
+
+#ifdef LABA7_X86
+
+static std::uint64_t maskSSE2(float px, float py, const float* xs, const float* ys,
+                              std::size_t count, float radius) {
+    __m128 vpx = _mm_set1_ps(px);
+    __m128 vpy = _mm_set1_ps(py);
+    __m128 vr2 = _mm_set1_ps(radius * radius);
+    std::uint64_t mask = 0;
+
+    std::size_t k = 0;
+    for (; k + 4 <= count; k += 4) {
+        __m128 dx = _mm_sub_ps(vpx, _mm_loadu_ps(xs + k));
+        __m128 dy = _mm_sub_ps(vpy, _mm_loadu_ps(ys + k));
+        __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        auto bits = static_cast<std::uint64_t>(_mm_movemask_ps(_mm_cmple_ps(d2, vr2)));
+        mask |= bits << k;
+    }
+    if (k < count) {
+        mask |= maskScalar(px, py, xs + k, ys + k, count - k, radius) << k;
+    }
+    return mask;
+}
+
+static inline __m128 clampSSE2(__m128 v, __m128 limit, __m128 limitMinusOne) {
+    v = _mm_max_ps(v, _mm_setzero_ps());
+    __m128 over = _mm_cmpge_ps(v, limit);
+    return _mm_or_ps(_mm_and_ps(over, limitMinusOne), _mm_andnot_ps(over, v));
+}
+
+static void moveSSE2(float* xs, float* ys, const float* dirX, const float* dirY,
+                     const float* distance, std::size_t count, float maxX, float maxY) {
+    __m128 vmaxX = _mm_set1_ps(maxX);
+    __m128 vmaxY = _mm_set1_ps(maxY);
+    __m128 vlastX = _mm_set1_ps(maxX - 1);
+    __m128 vlastY = _mm_set1_ps(maxY - 1);
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 d = _mm_loadu_ps(distance + i);
+        __m128 x = _mm_add_ps(_mm_loadu_ps(xs + i), _mm_mul_ps(_mm_loadu_ps(dirX + i), d));
+        __m128 y = _mm_add_ps(_mm_loadu_ps(ys + i), _mm_mul_ps(_mm_loadu_ps(dirY + i), d));
+        _mm_storeu_ps(xs + i, clampSSE2(x, vmaxX, vlastX));
+        _mm_storeu_ps(ys + i, clampSSE2(y, vmaxY, vlastY));
+    }
+    moveScalar(xs + i, ys + i, dirX + i, dirY + i, distance + i, count - i, maxX, maxY);
+}
+
+__attribute__((target("avx2")))
+static std::uint64_t maskAVX2(float px, float py, const float* xs, const float* ys,
+                              std::size_t count, float radius) {
+    __m256 vpx = _mm256_set1_ps(px);
+    __m256 vpy = _mm256_set1_ps(py);
+    __m256 vr2 = _mm256_set1_ps(radius * radius);
+    std::uint64_t mask = 0;
+
+    std::size_t k = 0;
+    for (; k + 8 <= count; k += 8) {
+        __m256 dx = _mm256_sub_ps(vpx, _mm256_loadu_ps(xs + k));
+        __m256 dy = _mm256_sub_ps(vpy, _mm256_loadu_ps(ys + k));
+        __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        auto bits = static_cast<std::uint64_t>(
+            _mm256_movemask_ps(_mm256_cmp_ps(d2, vr2, _CMP_LE_OQ)));
+        mask |= bits << k;
+    }
+    if (k < count) {
+        mask |= maskScalar(px, py, xs + k, ys + k, count - k, radius) << k;
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+static inline __m256 clampAVX2(__m256 v, __m256 limit, __m256 limitMinusOne) {
+    v = _mm256_max_ps(v, _mm256_setzero_ps());
+    return _mm256_blendv_ps(v, limitMinusOne, _mm256_cmp_ps(v, limit, _CMP_GE_OQ));
+}
+
+__attribute__((target("avx2")))
+static void moveAVX2(float* xs, float* ys, const float* dirX, const float* dirY,
+                     const float* distance, std::size_t count, float maxX, float maxY) {
+    __m256 vmaxX = _mm256_set1_ps(maxX);
+    __m256 vmaxY = _mm256_set1_ps(maxY);
+    __m256 vlastX = _mm256_set1_ps(maxX - 1);
+    __m256 vlastY = _mm256_set1_ps(maxY - 1);
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 d = _mm256_loadu_ps(distance + i);
+        __m256 x = _mm256_add_ps(_mm256_loadu_ps(xs + i),
+                                 _mm256_mul_ps(_mm256_loadu_ps(dirX + i), d));
+        __m256 y = _mm256_add_ps(_mm256_loadu_ps(ys + i),
+                                 _mm256_mul_ps(_mm256_loadu_ps(dirY + i), d));
+        _mm256_storeu_ps(xs + i, clampAVX2(x, vmaxX, vlastX));
+        _mm256_storeu_ps(ys + i, clampAVX2(y, vmaxY, vlastY));
+    }
+    moveScalar(xs + i, ys + i, dirX + i, dirY + i, distance + i, count - i, maxX, maxY);
+}
+
+#endif
+
+using MaskFn = std::uint64_t (*)(float, float, const float*, const float*, std::size_t, float);
+using MoveFn = void (*)(float*, float*, const float*, const float*, const float*,
+                        std::size_t, float, float);
+
+struct KernelTable {
+    SimdKernels::Level level;
+    MaskFn mask;
+    MoveFn move;
+};
+
+static const KernelTable TABLES[] = {
+    {SimdKernels::Level::Scalar, maskScalar, moveScalar},
+#ifdef LABA7_X86
+    {SimdKernels::Level::SSE2, maskSSE2, moveSSE2},
+    {SimdKernels::Level::AVX2, maskAVX2, moveAVX2},
+#endif
+};
+
+static const KernelTable* tableFor(SimdKernels::Level level) {
+    for (const auto& table : TABLES) {
+        if (table.level == level) return &table;
+    }
+    return &TABLES[0];
+}
+
+static std::atomic<const KernelTable*> activeTable{nullptr};
+
+static const KernelTable* currentTable() {
+    const KernelTable* table = activeTable.load(std::memory_order_acquire);
+    if (!table) {
+        table = tableFor(SimdKernels::bestSupportedLevel());
+        activeTable.store(table, std::memory_order_release);
+    }
+    return table;
+}
+
+std::uint64_t SimdKernels::withinRadiusMask(float px, float py,
+                                            const float* xs, const float* ys,
+                                            std::size_t count, float radius) {
+    return currentTable()->mask(px, py, xs, ys, count, radius);
+}
+
+void SimdKernels::moveBatch(float* xs, float* ys,
+                            const float* dirX, const float* dirY,
+                            const float* distance, std::size_t count,
+                            float maxX, float maxY) {
+    currentTable()->move(xs, ys, dirX, dirY, distance, count, maxX, maxY);
+}
+
+SimdKernels::Level SimdKernels::bestSupportedLevel() {
+#ifdef LABA7_X86
+    if (__builtin_cpu_supports("avx2")) return Level::AVX2;
+    return Level::SSE2;
+#else
+    return Level::Scalar;
+#endif
+}
+
+SimdKernels::Level SimdKernels::activeLevel() {
+    return currentTable()->level;
+}
+
+void SimdKernels::setLevel(Level level) {
+    if (static_cast<int>(level) > static_cast<int>(bestSupportedLevel())) {
+        level = bestSupportedLevel();
+    }
+    activeTable.store(tableFor(level), std::memory_order_release);
+}
+
+const char* SimdKernels::levelName(Level level) {
+    switch (level) {
+        case Level::AVX2: return "AVX2";
+        case Level::SSE2: return "SSE2";
+        default: return "Scalar";
+    }
+}
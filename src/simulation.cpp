@@ -0,0 +1,378 @@
+#include "../include/simulation.h"
+#include <algorithm>
+
+// Размер куска NPC для одного задания в фазах перемещения и статистики
+static constexpr size_t NPC_GRAIN = 4096;
+// Сторона чанка в клетках сетки
+static constexpr float CHUNK_CELLS = 16.0f;
+// Частей сетки на поток в фазе поиска пар (для балансировки кражей работы)
+static constexpr size_t SHARDS_PER_WORKER = 4;
+// Битв за одно извлечение из очереди
+static constexpr size_t BATTLE_BATCH = 1024;
+// Емкость очереди битв - предел битв за тик. Битвы тика не больше
+// свободного места, поэтому политика SkipTick - только страховка
+static constexpr size_t BATTLE_QUEUE_CAPACITY = 1 << 16;
+
+// Приоритет выборки битв: перемешивание splitmix64
+static std::uint64_t mixPriority(std::uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xBF58476D1CE4E5B9ull;
+    key ^= key >> 27;
+    key *= 0x94D049BB133111EBull;
+    return key ^ (key >> 31);
+}
+
+static_assert(NPC_TYPE_COUNT <= ChunkMap::MAX_TAGS, "every NPC type needs a chunk tag");
+static_assert(static_cast<size_t>(MetricHistogram::TickPublish) - static_cast<size_t>(MetricHistogram::TickMove) + 1
+              == TickReport::PHASE_COUNT, "every tick phase needs a histogram");
+
+Simulation::Simulation(NPCStore& npcs, JobSystem& jobs, std::uint64_t seed,
+                       int mapWidth, int mapHeight, float killDistance)
+    : npcs(npcs), jobs(jobs), seed(seed), mapWidth(mapWidth), mapHeight(mapHeight),
+      killDistance(killDistance), grid(killDistance), chunks(killDistance * CHUNK_CELLS),
+      battleQueue(BATTLE_QUEUE_CAPACITY, BackpressurePolicy::SkipTick), resolver(jobs, seed), rng(seed) {
+    // Теги сетки и чанков - типы NPC; взаимодействуют враждебные типы
+    std::vector<std::uint32_t> interactions(NPC_TYPE_COUNT);
+    for (size_t t = 0; t < NPC_TYPE_COUNT; ++t) {
+        interactions[t] = hostileMask(static_cast<NPCType>(t));
+    }
+    grid.setInteractions(std::move(interactions));
+    reset();
+}
+
+void Simulation::reset() {
+    grid.clear();
+    chunks.clear();
+    for (NPCStore::Index i = 0; i < npcs.size(); ++i) {
+        if (npcs.isAlive(i)) {
+            auto tag = static_cast<std::uint8_t>(typeIndex(npcs.getType(i)));
+            grid.insert(i, npcs.getX(i), npcs.getY(i), tag);
+            chunks.insert(i, npcs.getX(i), npcs.getY(i), tag);
+        }
+    }
+
+    countTypes();
+    publishPhase();
+}
+
+template <typename Phase>
+static std::chrono::nanoseconds timed(Phase&& phase) {
+    auto begin = std::chrono::steady_clock::now();
+    phase();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - begin);
+}
+
+const TickReport& Simulation::step() {
+    ++tick;
+    report.tick = tick;
+
+    // Убитые с прошлого тика больше не участвуют в поиске пар,
+    // их слоты освобождаются, а дескрипторы в очереди устаревают
+    auto dead = [this](NPCStore::Index i) { return !npcs.isAlive(i); };
+    grid.removeIf(dead);
+    chunks.removeIf(dead);
+    npcs.releaseDead();
+
+    report.phaseTime[TickReport::Move] = timed([this]() {
+        ScopedAllocTag tag(AllocTag::Movement);
+        movePhase();
+    });
+    report.phaseTime[TickReport::BroadPhase] = timed([this]() {
+        ScopedAllocTag tag(AllocTag::Battle);
+        broadPhase();
+    });
+    report.phaseTime[TickReport::Battle] = timed([this]() {
+        ScopedAllocTag tag(AllocTag::Battle);
+        battlePhase();
+    });
+    report.phaseTime[TickReport::Stats] = timed([this]() { statsPhase(); });
+    report.phaseTime[TickReport::Publish] = timed([this]() {
+        ScopedAllocTag tag(AllocTag::Render);
+        publishPhase();
+    });
+    if (Metrics::enabled()) recordMetrics();
+    return report;
+}
+
+void Simulation::recordMetrics() {
+    std::chrono::nanoseconds total{0};
+    for (size_t phase = 0; phase < TickReport::PHASE_COUNT; ++phase) {
+        auto histogram = static_cast<MetricHistogram>(static_cast<size_t>(MetricHistogram::TickMove) + phase);
+        Metrics::record(histogram, report.phaseTime[phase].count());
+        total += report.phaseTime[phase];
+    }
+    Metrics::record(MetricHistogram::TickTotal, total.count());
+
+    size_t fought = 0;
+    for (const auto& outcome : report.outcomes) {
+        fought += outcome.fought;
+    }
+    Metrics::add(MetricCounter::Ticks);
+    Metrics::add(MetricCounter::PairsChecked, report.pairs);
+    Metrics::add(MetricCounter::BattlesQueued, report.battlesQueued);
+    Metrics::add(MetricCounter::BattlesDropped, report.battlesDropped);
+    Metrics::add(MetricCounter::BattlesResolved, fought);
+    Metrics::add(MetricCounter::Kills, report.kills);
+}
+
+void Simulation::buildChunkTasks() {
+    // Мелкие чанки собираются в пакеты примерно по NPC_GRAIN NPC, крупные
+    // режутся на куски: одно задание - один пакет
+    chunkTasks.clear();
+    taskBatches.assign(1, 0);
+    report.moved = 0;
+    size_t batchSize = 0;
+    for (const ChunkMap::Chunk* chunk : chunks.awakeChunks()) {
+        for (size_t begin = 0; begin < chunk->members.size(); begin += NPC_GRAIN) {
+            size_t end = std::min(begin + NPC_GRAIN, chunk->members.size());
+            chunkTasks.push_back({chunk, begin, end});
+            batchSize += end - begin;
+            report.moved += end - begin;
+            if (batchSize >= NPC_GRAIN) {
+                taskBatches.push_back(chunkTasks.size());
+                batchSize = 0;
+            }
+        }
+    }
+    if (batchSize > 0) {
+        taskBatches.push_back(chunkTasks.size());
+    }
+}
+
+void Simulation::sleepPhase() {
+    // Чанк занят, если в нем или у соседей есть враждебные друг другу типы.
+    // Спящие NPC остаются в сетке, чтобы их находили враги: пара со спящим
+    // находится в тот же тик, а его чанк проснется на следующем
+    chunks.updateSleep([this](const ChunkMap::Chunk& chunk) {
+        return grid.interacts(chunk.mask, ChunkMap::neighbourhoodMask(chunk));
+    }, sleepAfter, [this](const ChunkMap::Chunk& chunk, bool asleep) {
+        for (NPCStore::Index i : chunk.members) {
+            grid.setDormant(i, npcs.getX(i), npcs.getY(i), asleep);
+        }
+    });
+
+    // Острова: бодрствующие чанки, связанные враждебными контактами
+    // внутри себя или с соседом (каждая пара соседей проверяется один раз)
+    static constexpr int NEIGHBOURS[4][2] = {{1, 0}, {1, 1}, {0, 1}, {-1, 1}};
+    islands.clear();
+    for (const ChunkMap::Chunk* chunk : chunks.awakeChunks()) {
+        if (!chunk->busy) continue;
+        ChunkMap::ChunkKey key = ChunkMap::makeKey(chunk->cx, chunk->cy);
+        if (grid.interacts(chunk->mask, chunk->mask)) islands.add(key);
+        for (const auto& offset : NEIGHBOURS) {
+            const ChunkMap::Chunk* other = chunks.find(chunk->cx + offset[0], chunk->cy + offset[1]);
+            if (other && other->busy && grid.interacts(chunk->mask, other->mask)) {
+                islands.unite(key, ChunkMap::makeKey(other->cx, other->cy));
+            }
+        }
+    }
+    report.islands = islands.setCount();
+    report.sleepingChunks = chunks.sleepingCount();
+    report.activeChunks = chunks.chunkCount() - report.sleepingChunks;
+}
+
+void Simulation::movePhase() {
+    sleepPhase();
+    buildChunkTasks();
+    size_t batchCount = taskBatches.size() - 1;
+    batchMovers.resize(batchCount);
+
+    // Направления (-1, 0, 1) по ключу (seed, тик, NPC), затем пакетное
+    // перемещение NPC пакета чанков; пустые и спящие области мира не обходятся.
+    // Заодно задание отмечает, кто сменил клетку или чанк
+    jobs.parallelFor(batchCount, 1, [this](size_t first, size_t last) {
+        thread_local std::vector<NPCStore::Index> ids;
+        thread_local std::vector<float> oldX, oldY, dirX, dirY;
+        for (size_t b = first; b < last; ++b) {
+            ids.clear();
+            for (size_t t = taskBatches[b]; t < taskBatches[b + 1]; ++t) {
+                const ChunkTask& task = chunkTasks[t];
+                ids.insert(ids.end(), task.chunk->members.begin() + task.begin,
+                           task.chunk->members.begin() + task.end);
+            }
+
+            size_t count = ids.size();
+            oldX.resize(count);
+            oldY.resize(count);
+            for (size_t k = 0; k < count; ++k) {
+                oldX[k] = npcs.getX(ids[k]);
+                oldY[k] = npcs.getY(ids[k]);
+            }
+            dirX.resize(count);
+            dirY.resize(count);
+            rng.fillDirections(tick, ids.data(), count, dirX.data(), dirY.data());
+            npcs.moveIndices(ids.data(), count, dirX.data(), dirY.data(), mapWidth, mapHeight);
+
+            auto& movers = batchMovers[b];
+            movers.clear();
+            for (size_t k = 0; k < count; ++k) {
+                NPCStore::Index i = ids[k];
+                float x = npcs.getX(i);
+                float y = npcs.getY(i);
+                if (!grid.isSameCell(oldX[k], oldY[k], x, y) || !chunks.isInChunk(i, x, y)) {
+                    movers.push_back({i, oldX[k], oldY[k]});
+                }
+            }
+        }
+    });
+
+    // Хеш-таблицы сетки и чанков не потокобезопасны: переносы сменивших
+    // клетку или чанк - по очереди, в порядке пакетов
+    for (const auto& movers : batchMovers) {
+        for (const Mover& mover : movers) {
+            float x = npcs.getX(mover.id);
+            float y = npcs.getY(mover.id);
+            grid.update(mover.id, mover.oldX, mover.oldY, x, y);
+            chunks.update(mover.id, x, y);
+        }
+    }
+}
+
+void Simulation::broadPhase() {
+    size_t shardCount = jobs.getWorkerCount() * SHARDS_PER_WORKER;
+    shardBattles.resize(shardCount);
+    shardPairs.assign(shardCount, 0);
+    shardContacts.assign(shardCount, 0);
+
+    // Битв за тик не больше свободного места в очереди. Часть сетки
+    // оставляет кандидатов с наименьшим приоритетом: вместе в них есть все
+    // budget лучших кандидатов тика при любом числе частей
+    size_t budget = std::min(battleLimit,
+                             battleQueue.capacity() - std::min(battleQueue.capacity(), battleQueue.depth()));
+    auto byPriority = [](const BattleCandidate& a, const BattleCandidate& b) {
+        return a.priority < b.priority;
+    };
+
+    // Каждая часть сетки собирает свои битвы; сетка отдает каждую пару один раз
+    jobs.parallelFor(shardCount, 1, [this, shardCount, budget, byPriority](size_t first, size_t last) {
+        for (size_t shard = first; shard < last; ++shard) {
+            auto& battles = shardBattles[shard];
+            battles.clear();
+
+            grid.forEachPairInRange(killDistance, npcs.xData(), npcs.yData(), shard, shardCount,
+                                    [&](NPCStore::Index npc1, NPCStore::Index npc2) {
+                ++shardPairs[shard];
+                if (!npcs.isAlive(npc1) || !npcs.isAlive(npc2)) return;
+
+                // Проверяем, могут ли они атаковать друг друга
+                bool canAttack1to2 = npcs.canAttack(npc1, npc2);
+                bool canAttack2to1 = npcs.canAttack(npc2, npc1);
+                if (!canAttack1to2 && !canAttack2to1) return;
+
+                // Оба могут атаковать - атакующий выбирается по ключу пары
+                std::uint64_t key = (std::uint64_t(std::min(npc1, npc2)) << 32) | std::max(npc1, npc2);
+                bool firstAttacks = canAttack1to2;
+                if (canAttack1to2 && canAttack2to1) {
+                    firstAttacks = rng.draw(tick, key, RandomPurpose::Attacker)[0] & 1;
+                }
+
+                BattleCandidate candidate;
+                candidate.priority = mixPriority(key ^ (std::uint64_t(tick) * 0x9E3779B97F4A7C15ull));
+                candidate.order = static_cast<std::uint32_t>(shardContacts[shard]++);
+                candidate.battle.attacker = npcs.handleOf(firstAttacks ? npc1 : npc2);
+                candidate.battle.defender = npcs.handleOf(firstAttacks ? npc2 : npc1);
+                candidate.battle.tick = tick;
+
+                // Сверх бюджета - куча по приоритету: вытесняется худший
+                if (battles.size() < budget) {
+                    battles.push_back(candidate);
+                    if (battles.size() == budget) std::make_heap(battles.begin(), battles.end(), byPriority);
+                } else if (budget > 0 && candidate.priority < battles.front().priority) {
+                    std::pop_heap(battles.begin(), battles.end(), byPriority);
+                    battles.back() = candidate;
+                    std::push_heap(battles.begin(), battles.end(), byPriority);
+                }
+            });
+        }
+    });
+
+    // Сборка в порядке частей, внутри части - в порядке обхода: порядок
+    // битв не зависит от числа потоков
+    tickCandidates.clear();
+    report.pairs = 0;
+    size_t contacts = 0;
+    for (size_t shard = 0; shard < shardCount; ++shard) {
+        auto& battles = shardBattles[shard];
+        if (battles.size() == budget) {
+            std::sort(battles.begin(), battles.end(), [](const BattleCandidate& a, const BattleCandidate& b) {
+                return a.order < b.order;
+            });
+        }
+        tickCandidates.insert(tickCandidates.end(), battles.begin(), battles.end());
+        report.pairs += shardPairs[shard];
+        contacts += shardContacts[shard];
+    }
+    if (tickCandidates.size() > budget) {
+        for (size_t k = 0; k < tickCandidates.size(); ++k) {
+            tickCandidates[k].order = static_cast<std::uint32_t>(k);
+        }
+        std::nth_element(tickCandidates.begin(), tickCandidates.begin() + budget, tickCandidates.end(), byPriority);
+        tickCandidates.resize(budget);
+        std::sort(tickCandidates.begin(), tickCandidates.end(), [](const BattleCandidate& a, const BattleCandidate& b) {
+            return a.order < b.order;
+        });
+    }
+    tickBattles.clear();
+    for (const auto& candidate : tickCandidates) {
+        tickBattles.push_back(candidate.battle);
+    }
+
+    // Все битвы тика - одной пакетной операцией; пары, которые еще
+    // ждут обработки, очередь отбросит сама и они тоже считаются потерянными
+    BattleQueueStats before = battleQueue.stats();
+    report.battlesQueued = battleQueue.pushBatch(tickBattles);
+    BattleQueueStats after = battleQueue.stats();
+    report.battlesDropped = contacts - tickBattles.size() +
+                            static_cast<size_t>(after.dropped - before.dropped) +
+                            static_cast<size_t>(after.coalesced - before.coalesced);
+    if (Metrics::enabled()) {
+        Metrics::record(MetricHistogram::BattleQueueDepth, battleQueue.depth());
+    }
+}
+
+void Simulation::battlePhase() {
+    // Забираем все ожидающие битвы и обрабатываем их волнами
+    tickBattles.clear();
+    size_t taken = 0;
+    do {
+        tickBattles.resize(taken + BATTLE_BATCH);
+        taken += battleQueue.popBatch(tickBattles.data() + taken, BATTLE_BATCH);
+    } while (tickBattles.size() == taken);
+    tickBattles.resize(taken);
+
+    resolver.resolve(npcs, tickBattles.data(), tickBattles.size(), report.outcomes);
+
+    report.kills = 0;
+    for (const auto& outcome : report.outcomes) {
+        report.kills += outcome.killed;
+    }
+}
+
+void Simulation::countTypes() {
+    // Счетчики чанков - по NPC, живым на начало тика
+    report.alive = 0;
+    for (size_t t = 0; t < NPC_TYPE_COUNT; ++t) {
+        report.typeCounts[t] = chunks.tagCount(static_cast<ChunkMap::Tag>(t));
+        report.alive += report.typeCounts[t];
+    }
+}
+
+void Simulation::statsPhase() {
+    // Живые по счетчикам чанков минус убитые в битвах этого тика:
+    // обходить NPC и чанки не нужно
+    countTypes();
+    for (const auto& outcome : report.outcomes) {
+        if (outcome.killed) {
+            --report.typeCounts[typeIndex(npcs.getType(outcome.defender))];
+            --report.alive;
+        }
+    }
+}
+
+void Simulation::publishPhase() {
+    frames.publish(npcs, tick, report.typeCounts, report.alive);
+    if (sharedSnapshot) {
+        sharedSnapshot->publish(npcs, tick, report.typeCounts, report.alive);
+    }
+}
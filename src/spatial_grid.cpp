@@ -0,0 +1,115 @@
+#include "../include/spatial_grid.h"
+#include <cmath>
+#include <utility>
+
+SpatialGrid::SpatialGrid(float cellSize)
+    : cellSize(cellSize), invCellSize(1.0f / cellSize) {}
+
+SpatialGrid::CellKey SpatialGrid::keyFor(float x, float y) const {
+    auto cx = static_cast<std::int32_t>(std::floor(x * invCellSize));
+    auto cy = static_cast<std::int32_t>(std::floor(y * invCellSize));
+    return makeKey(cx, cy);
+}
+
+void SpatialGrid::setInteractions(std::vector<std::uint32_t> interactions) {
+    interactionTable = std::move(interactions);
+}
+
+void SpatialGrid::ensureId(Id id) {
+    if (id >= tagOf.size()) {
+        tagOf.resize(id + 1, 0);
+        dormantOf.resize(id + 1, 0);
+    }
+}
+
+void SpatialGrid::add(CellKey key, Id id) {
+    Cell& cell = cells[key];
+    cell.ids.push_back(id);
+    cell.mask |= tagBit(id);
+    cell.dormant += dormantOf[id];
+}
+
+void SpatialGrid::refreshMask(Cell& cell) const {
+    cell.mask = 0;
+    for (Id id : cell.ids) {
+        cell.mask |= tagBit(id);
+    }
+}
+
+void SpatialGrid::insert(Id id, float x, float y, Tag tag) {
+    ensureId(id);
+    tagOf[id] = tag;
+    dormantOf[id] = 0;
+    add(keyFor(x, y), id);
+    ++count;
+}
+
+void SpatialGrid::setDormant(Id id, float x, float y, bool dormant) {
+    if (id >= dormantOf.size()) return;
+    auto it = cells.find(keyFor(x, y));
+    if (it == cells.end() || dormantOf[id] == dormant) return;
+    dormantOf[id] = dormant;
+    if (dormant) {
+        ++it->second.dormant;
+    } else {
+        --it->second.dormant;
+    }
+}
+
+void SpatialGrid::remove(Id id, float x, float y) {
+    auto it = cells.find(keyFor(x, y));
+    if (it == cells.end()) return;
+
+    auto& bucket = it->second.ids;
+    auto pos = std::find(bucket.begin(), bucket.end(), id);
+    if (pos == bucket.end()) return;
+
+    *pos = bucket.back();
+    bucket.pop_back();
+    it->second.dormant -= dormantOf[id];
+    dormantOf[id] = 0;
+    --count;
+
+    // Пустые клетки не храним, чтобы память зависела только от занятой площади
+    if (bucket.empty()) {
+        cells.erase(it);
+    } else {
+        refreshMask(it->second);
+    }
+}
+
+void SpatialGrid::update(Id id, float oldX, float oldY, float newX, float newY) {
+    CellKey oldKey = keyFor(oldX, oldY);
+    CellKey newKey = keyFor(newX, newY);
+    if (oldKey == newKey) return;
+
+    auto it = cells.find(oldKey);
+    if (it != cells.end()) {
+        auto& bucket = it->second.ids;
+        auto pos = std::find(bucket.begin(), bucket.end(), id);
+        if (pos != bucket.end()) {
+            *pos = bucket.back();
+            bucket.pop_back();
+            it->second.dormant -= dormantOf[id];
+            if (bucket.empty()) {
+                cells.erase(it);
+            } else {
+                refreshMask(it->second);
+            }
+            add(newKey, id);
+            return;
+        }
+    }
+
+    // NPC не был в сетке - просто добавляем
+    ensureId(id);
+    add(newKey, id);
+    ++count;
+}
+
+void SpatialGrid::clear() {
+    cells.clear();
+    tagOf.clear();
+    dormantOf.clear();
+    count = 0;
+}
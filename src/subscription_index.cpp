@@ -0,0 +1,98 @@
+#include "../include/subscription_index.h"
+#include <algorithm>
+#include <cmath>
+
+bool BattleFilter::matches(const BattleEvent& event) const {
+    if (!(results & resultBit(event.result))) return false;
+    if (!(types & (typeBit(event.attackerType) | typeBit(event.defenderType)))) return false;
+    if (region && !region->contains(event.x, event.y)) return false;
+    if (entity && !(event.attacker == *entity || event.defender == *entity)) return false;
+    return true;
+}
+
+std::int64_t SubscriptionIndex::cellOf(float coordinate) {
+    return static_cast<std::int64_t>(std::floor(coordinate / REGION_CELL));
+}
+
+std::uint64_t SubscriptionIndex::cellKey(std::int64_t cx, std::int64_t cy) {
+    return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(cx)) << 32) |
+           static_cast<std::uint32_t>(cy);
+}
+
+std::vector<SubscriptionIndex::Bucket*> SubscriptionIndex::bucketsOf(const Subscription* subscription,
+                                                                     bool create) {
+    std::vector<Bucket*> buckets;
+    const BattleFilter& filter = subscription->filter;
+    auto lookup = [&](std::unordered_map<std::uint64_t, Bucket>& map, std::uint64_t key) {
+        if (create) {
+            buckets.push_back(&map[key]);
+        } else if (auto it = map.find(key); it != map.end()) {
+            buckets.push_back(&it->second);
+        }
+    };
+
+    if (filter.entity) {
+        lookup(byEntity, filter.entity->packed());
+        return buckets;
+    }
+    if (filter.region) {
+        const BattleRegion& r = *filter.region;
+        double cells = (double(r.maxX - r.minX) / REGION_CELL + 1) * (double(r.maxY - r.minY) / REGION_CELL + 1);
+        if (!(r.maxX > r.minX && r.maxY > r.minY && cells <= MAX_REGION_CELLS)) {
+            buckets.push_back(&wideRegions);
+            return buckets;
+        }
+        std::int64_t x0 = cellOf(r.minX), x1 = cellOf(r.maxX);
+        std::int64_t y0 = cellOf(r.minY), y1 = cellOf(r.maxY);
+        for (std::int64_t cx = x0; cx <= x1; ++cx) {
+            for (std::int64_t cy = y0; cy <= y1; ++cy) {
+                lookup(byCell, cellKey(cx, cy));
+            }
+        }
+        return buckets;
+    }
+    if (filter.unfiltered()) {
+        buckets.push_back(&plain);
+    }
+    for (size_t r = 0; r < BATTLE_RESULT_COUNT; ++r) {
+        if (!(filter.results & (1u << r))) continue;
+        for (size_t a = 0; a < NPC_TYPE_COUNT; ++a) {
+            for (size_t d = 0; d < NPC_TYPE_COUNT; ++d) {
+                if (filter.types & ((1u << a) | (1u << d))) {
+                    buckets.push_back(&byKind[r][a][d]);
+                }
+            }
+        }
+    }
+    return buckets;
+}
+
+void SubscriptionIndex::add(Subscription* subscription) {
+    for (Bucket* bucket : bucketsOf(subscription, true)) {
+        bucket->push_back(subscription);
+    }
+    ++count;
+}
+
+void SubscriptionIndex::remove(const Subscription* subscription) {
+    bool found = false;
+    for (Bucket* bucket : bucketsOf(subscription, false)) {
+        auto it = std::find(bucket->begin(), bucket->end(), subscription);
+        if (it == bucket->end()) continue;
+        bucket->erase(it);
+        found = true;
+    }
+    if (!found) return;
+    --count;
+
+    // Пустые списки участников и клеток не держат память
+    const BattleFilter& filter = subscription->filter;
+    if (filter.entity) {
+        auto it = byEntity.find(filter.entity->packed());
+        if (it != byEntity.end() && it->second.empty()) byEntity.erase(it);
+    } else if (filter.region) {
+        for (auto it = byCell.begin(); it != byCell.end();) {
+            it = it->second.empty() ? byCell.erase(it) : std::next(it);
+        }
+    }
+}
@@ -1,5 +1,34 @@
 #include <gtest/gtest.h>
 #include "npcs.h"
+#include "factory.h"
+#include "spatial_grid.h"
+#include "chunk_map.h"
+#include "union_find.h"
+#include "npc_store.h"
+#include "simd_kernels.h"
+#include "battle_queue.h"
+#include "battle_resolver.h"
+#include "job_system.h"
+#include "simulation.h"
+#include "shared_snapshot.h"
+#include "philox.h"
+#include "game_manager.h"
+#include "scenario.h"
+#include "metrics.h"
+#include "alloc_tracker.h"
+#include "observer.h"
+#include "battle_log.h"
+#include <dirent.h>
+#include <unistd.h>
+#include <atomic>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <set>
+#include <sstream>
 #include <memory>
 #include <thread>
 
@@ -123,6 +152,1654 @@ TEST(NPCTest, AttackLogic) {
     EXPECT_FALSE(bear->canAttack(*orc));     // Медведь НЕ атакует орка
 }
 
+TEST(NPCTest, TypeTagsAndKillMatrix) {
+    Orc orc("Orc1", 0, 0);
+    Knight knight("Knight1", 0, 0);
+    Bear bear("Bear1", 0, 0);
+    
+    EXPECT_EQ(orc.getTypeId(), NPCType::Orc);
+    EXPECT_EQ(knight.getTypeId(), NPCType::Knight);
+    EXPECT_EQ(bear.getTypeId(), NPCType::Bear);
+    
+    // canAttack должен совпадать с таблицей для всех пар типов
+    const NPC* all[] = {&orc, &knight, &bear};
+    for (const NPC* a : all) {
+        for (const NPC* d : all) {
+            EXPECT_EQ(a->canAttack(*d), canKill(a->getTypeId(), d->getTypeId()));
+            EXPECT_EQ(d->canBeAttackedBy(*a), a->canAttack(*d));
+        }
+    }
+    
+    NPCType parsed;
+    EXPECT_TRUE(parseNPCType("Knight", parsed));
+    EXPECT_EQ(parsed, NPCType::Knight);
+    EXPECT_FALSE(parseNPCType("Dragon", parsed));
+}
+
+TEST(NPCTest, VariantValuesAndStaticDispatch) {
+    std::vector<NPCVariant> npcs;
+    npcs.push_back(NPCFactory::createNPCValue("Orc", "Orc1", 1, 2));
+    npcs.push_back(NPCFactory::createNPCValue("Knight", "Knight1", 3, 4));
+    npcs.push_back(NPCFactory::createNPCValueFromString("Bear Bear1 5 6"));
+    
+    EXPECT_EQ(typeOf(npcs[0]), NPCType::Orc);
+    EXPECT_EQ(typeOf(npcs[2]), NPCType::Bear);
+    EXPECT_EQ(asNPC(npcs[1]).getName(), "Knight1");
+    EXPECT_EQ(asNPC(npcs[2]).getX(), 5.0f);
+    
+    for (const auto& a : npcs) {
+        for (const auto& d : npcs) {
+            EXPECT_EQ(canAttack(a, d), canKill(typeOf(a), typeOf(d)));
+        }
+    }
+    
+    // Фабрика и таблица диспетчеризации дают один и тот же класс
+    auto bear = NPCFactory::createNPC("Bear", "Bear2", 0, 0);
+    EXPECT_NE(dynamic_cast<Bear*>(bear.get()), nullptr);
+    EXPECT_STREQ(visitNPCType(NPCType::Knight, [](auto tag) {
+        return decltype(tag)::type::TRAITS.name;
+    }), "Knight");
+    EXPECT_THROW(NPCFactory::createNPCValue("Dragon", "D", 0, 0), std::invalid_argument);
+    
+    // Границы мира задаются во время выполнения; по умолчанию 0-500
+    EXPECT_THROW(NPCFactory::createNPCValue("Orc", "O", 600, 10), std::invalid_argument);
+    EXPECT_NO_THROW(NPCFactory::createNPCValue("Orc", "O", 600000, 10, WorldBounds{1e6f, 1e6f}));
+}
+
+// Тесты для сетки broad-phase
+TEST(SpatialGridTest, FindsSamePairsAsBruteForce) {
+    NPCStore store;
+    for (int i = 0; i < 60; ++i) {
+        float x = static_cast<float>((i * 37) % 100);
+        float y = static_cast<float>((i * 53) % 100);
+        store.add(NPCType::Orc, "Orc" + std::to_string(i), x, y);
+    }
+    
+    SpatialGrid grid(10.0f);
+    for (NPCStore::Index i = 0; i < store.size(); ++i) {
+        grid.insert(i, store.getX(i), store.getY(i));
+    }
+    
+    size_t expected = 0;
+    for (NPCStore::Index i = 0; i < store.size(); ++i) {
+        for (NPCStore::Index j = i + 1; j < store.size(); ++j) {
+            if (store.view(i).isInRange(store.view(j), 10.0f)) expected++;
+        }
+    }
+    
+    size_t found = 0;
+    grid.forEachPairInRange(10.0f, store.xData(), store.yData(),
+                            [&](NPCStore::Index, NPCStore::Index) { found++; });
+    EXPECT_EQ(found, expected);
+}
+
+TEST(SpatialGridTest, FindsHostilesOnEitherSideOfSleepingCell) {
+    NPCStore store;
+    auto orcA = store.add(NPCType::Orc, "Orc1", 55, 55);
+    auto orcB = store.add(NPCType::Orc, "Orc2", 56, 56);
+    // Соседи по обе стороны: восточную клетку проверяет клетка орков,
+    // западная сама проверяет клетку орков
+    store.add(NPCType::Knight, "East", 64, 55);
+    store.add(NPCType::Knight, "West", 47, 55);
+    store.add(NPCType::Knight, "North", 55, 47);
+    store.add(NPCType::Knight, "South", 55, 64);
+    
+    auto pairsFound = [&](bool sleeping) {
+        SpatialGrid grid(10.0f);
+        grid.setInteractions({typeBit(NPCType::Knight), typeBit(NPCType::Orc), 0});
+        for (NPCStore::Index i = 0; i < store.size(); ++i) {
+            grid.insert(i, store.getX(i), store.getY(i), static_cast<SpatialGrid::Tag>(typeIndex(store.getType(i))));
+        }
+        for (auto orc : {orcA, orcB}) {
+            grid.setDormant(orc, store.getX(orc), store.getY(orc), sleeping);
+        }
+        std::set<std::pair<NPCStore::Index, NPCStore::Index>> pairs;
+        grid.forEachPairInRange(10.0f, store.xData(), store.yData(), [&](NPCStore::Index a, NPCStore::Index b) {
+            pairs.insert({std::min(a, b), std::max(a, b)});
+        });
+        return pairs;
+    };
+    auto awake = pairsFound(false);
+    EXPECT_EQ(awake.size(), 8u);
+    EXPECT_EQ(pairsFound(true), awake);
+}
+
+TEST(SpatialGridTest, UpdateFollowsMovement) {
+    NPCStore store;
+    auto orc = store.add(NPCType::Orc, "Orc1", 5, 5);
+    auto bear = store.add(NPCType::Bear, "Bear1", 45, 5);
+    
+    SpatialGrid grid(10.0f);
+    grid.insert(orc, store.getX(orc), store.getY(orc));
+    grid.insert(bear, store.getX(bear), store.getY(bear));
+    
+    auto countPairs = [&]() {
+        size_t pairs = 0;
+        grid.forEachPairInRange(10.0f, store.xData(), store.yData(),
+                                [&](NPCStore::Index, NPCStore::Index) { pairs++; });
+        return pairs;
+    };
+    EXPECT_EQ(countPairs(), 0u);
+    
+    // Орк проходит 20 единиц за ход: 5 -> 25 -> 45
+    for (int i = 0; i < 2; ++i) {
+        float oldX = store.getX(orc), oldY = store.getY(orc);
+        store.move(orc, 1, 0, 100, 100);
+        grid.update(orc, oldX, oldY, store.getX(orc), store.getY(orc));
+    }
+    EXPECT_EQ(countPairs(), 1u);
+    EXPECT_EQ(grid.size(), 2u);
+    
+    store.kill(bear);
+    grid.removeIf([&](NPCStore::Index i) { return !store.isAlive(i); });
+    EXPECT_EQ(grid.size(), 1u);
+}
+
+// Тесты для хранилища NPC
+TEST(NPCStoreTest, ViewMatchesNPCApi) {
+    NPCStore store;
+    Knight knight("Knight1", 50, 50);
+    NPCView view = store.view(store.add(knight));
+    
+    EXPECT_EQ(view.getType(), knight.getType());
+    EXPECT_EQ(view.getName(), knight.getName());
+    EXPECT_EQ(view.getMoveDistance(), knight.getMoveDistance());
+    EXPECT_EQ(view.getKillDistance(), knight.getKillDistance());
+    EXPECT_EQ(view.getSymbol(), knight.getSymbol());
+    
+    knight.move(1, 0, 100, 100);
+    view.move(1, 0, 100, 100);
+    EXPECT_EQ(view.getPosition(), knight.getPosition());
+    
+    NPCView orc = store.view(store.add(NPCType::Orc, "Orc1", 0, 0));
+    EXPECT_TRUE(view.canAttack(orc));
+    EXPECT_FALSE(orc.canAttack(view));
+    EXPECT_TRUE(orc.canBeAttackedBy(view));
+}
+
+TEST(NPCStoreTest, RemoveDeadKeepsOrder) {
+    NPCStore store;
+    store.add(NPCType::Orc, "A", 1, 1);
+    store.add(NPCType::Bear, "B", 2, 2);
+    store.add(NPCType::Knight, "C", 3, 3);
+    
+    store.kill(1);
+    EXPECT_EQ(store.aliveCount(), 2u);
+    
+    store.removeDead();
+    ASSERT_EQ(store.size(), 2u);
+    EXPECT_EQ(store.getName(0), "A");
+    EXPECT_EQ(store.getName(1), "C");
+    EXPECT_EQ(store.getX(1), 3.0f);
+}
+
+// Тесты для поколенческих дескрипторов
+TEST(EntityHandleTest, StaleHandleIsRejectedAfterSlotReuse) {
+    NPCStore store;
+    EntityHandle orc = store.handleOf(store.add(NPCType::Orc, "A", 1, 1));
+    EntityHandle bear = store.handleOf(store.add(NPCType::Bear, "B", 2, 2));
+    
+    store.kill(orc.index);
+    EXPECT_EQ(store.releaseDead(), 1u);
+    EXPECT_FALSE(store.isValid(orc));
+    EXPECT_EQ(store.freeSlotCount(), 1u);
+    
+    // Новый NPC занимает тот же слот, но старый дескриптор на него не указывает
+    EntityHandle knight = store.handleOf(store.add(NPCType::Knight, "C", 3, 3));
+    EXPECT_EQ(knight.index, orc.index);
+    EXPECT_NE(knight, orc);
+    EXPECT_FALSE(store.resolve(orc).has_value());
+    ASSERT_TRUE(store.resolve(knight).has_value());
+    EXPECT_EQ(store.getName(*store.resolve(knight)), "C");
+    
+    EXPECT_TRUE(store.isValid(bear));
+    EXPECT_FALSE(store.isValid(EntityHandle{}));
+}
+
+TEST(EntityHandleTest, RemoveDeadInvalidatesMovedHandles) {
+    NPCStore store;
+    EntityHandle a = store.handleOf(store.add(NPCType::Orc, "A", 1, 1));
+    EntityHandle b = store.handleOf(store.add(NPCType::Bear, "B", 2, 2));
+    EntityHandle c = store.handleOf(store.add(NPCType::Knight, "C", 3, 3));
+    
+    store.kill(1);
+    store.removeDead();
+    EXPECT_TRUE(store.isValid(a));
+    EXPECT_FALSE(store.isValid(b));
+    EXPECT_FALSE(store.isValid(c));   // C переехал в слот 1
+    
+    store.clear();
+    EXPECT_FALSE(store.isValid(a));
+}
+
+// Тесты для очереди битв
+static ThreadBattle makeBattle(std::uint32_t a, std::uint32_t d) {
+    return ThreadBattle{EntityHandle{a, 0}, EntityHandle{d, 0}};
+}
+
+TEST(BattleQueueTest, CoalescesPendingPairs) {
+    BattleQueue queue(8);
+    std::vector<ThreadBattle> tick = {makeBattle(1, 2), makeBattle(3, 4), makeBattle(2, 1)};
+    
+    // (2, 1) - та же пара, что и (1, 2)
+    EXPECT_EQ(queue.pushBatch(tick), 2u);
+    EXPECT_EQ(queue.pushBatch(tick), 0u);
+    EXPECT_EQ(queue.stats().coalesced, 4u);
+    
+    ThreadBattle out[8];
+    ASSERT_EQ(queue.popBatch(out, 8), 2u);
+    EXPECT_EQ(out[0].attacker.index, 1u);
+    EXPECT_EQ(out[1].attacker.index, 3u);
+    
+    // После извлечения пара снова может встать в очередь
+    EXPECT_EQ(queue.pushBatch(tick), 2u);
+}
+
+TEST(BattleQueueTest, CoalescesOnlyEqualPairs) {
+    BattleQueue queue(1 << 15);
+    std::vector<ThreadBattle> tick;
+    for (std::uint32_t i = 0; i < 20000; ++i) {
+        tick.push_back(makeBattle(i, i + 100000));
+    }
+    
+    // Разные пары не склеиваются даже при совпадении хешей
+    EXPECT_EQ(queue.pushBatch(tick), tick.size());
+    EXPECT_EQ(queue.stats().coalesced, 0u);
+    
+    // Половина покидает очередь: вернуться может только она
+    std::vector<ThreadBattle> out(tick.size());
+    ASSERT_EQ(queue.popBatch(out.data(), 10000), 10000u);
+    EXPECT_EQ(queue.pushBatch(tick), 10000u);
+    EXPECT_EQ(queue.stats().coalesced, 10000u);
+    EXPECT_EQ(queue.popBatch(out.data(), out.size()), tick.size());
+    EXPECT_EQ(queue.pushBatch(tick), tick.size());
+}
+
+TEST(BattleQueueTest, BackpressurePolicies) {
+    std::vector<ThreadBattle> tick;
+    for (std::uint32_t i = 0; i < 6; ++i) {
+        tick.push_back(makeBattle(2 * i, 2 * i + 1));
+    }
+    ThreadBattle out[8];
+    
+    BattleQueue dropOldest(4, BackpressurePolicy::DropOldest);
+    EXPECT_EQ(dropOldest.pushBatch(tick), 6u);
+    EXPECT_EQ(dropOldest.stats().dropped, 2u);
+    ASSERT_EQ(dropOldest.popBatch(out, 8), 4u);
+    EXPECT_EQ(out[0].attacker.index, 4u);
+    
+    BattleQueue skipTick(4, BackpressurePolicy::SkipTick);
+    EXPECT_EQ(skipTick.pushBatch(tick), 0u);
+    EXPECT_EQ(skipTick.stats().skippedTicks, 1u);
+    EXPECT_EQ(skipTick.depth(), 0u);
+    
+    BattleQueue block(4, BackpressurePolicy::Block);
+    std::atomic<size_t> consumed{0};
+    std::thread consumer([&]() {
+        ThreadBattle batch[2];
+        for (;;) {
+            size_t count = block.waitPopBatch(batch, 2, std::chrono::milliseconds(10));
+            consumed += count;
+            if (count == 0 && block.isClosed()) break;
+        }
+    });
+    EXPECT_EQ(block.pushBatch(tick), 6u);
+    block.close();
+    consumer.join();
+    EXPECT_EQ(consumed.load(), 6u);
+    EXPECT_EQ(block.stats().dropped, 0u);
+}
+
+TEST(BattleQueueTest, ConcurrentProducersAndConsumersLoseNothing) {
+    BoundedQueue<std::uint32_t> queue(64);
+    constexpr std::uint32_t PER_PRODUCER = 20000;
+    std::atomic<std::uint64_t> sum{0};
+    std::atomic<std::uint32_t> received{0};
+    
+    std::vector<std::thread> threads;
+    for (std::uint32_t p = 0; p < 2; ++p) {
+        threads.emplace_back([&, p]() {
+            std::uint32_t batch[8];
+            for (std::uint32_t i = 0; i < PER_PRODUCER; i += 8) {
+                for (std::uint32_t k = 0; k < 8; ++k) batch[k] = p * PER_PRODUCER + i + k;
+                size_t pushed = 0;
+                while (pushed < 8) {
+                    pushed += queue.tryPushBatch(batch + pushed, 8 - pushed);
+                    if (pushed < 8) std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (int c = 0; c < 2; ++c) {
+        threads.emplace_back([&]() {
+            std::uint32_t batch[5];
+            while (received < 2 * PER_PRODUCER) {
+                size_t count = queue.tryPopBatch(batch, 5);
+                for (size_t k = 0; k < count; ++k) sum += batch[k];
+                received += static_cast<std::uint32_t>(count);
+                if (count == 0) std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    
+    std::uint64_t n = 2 * PER_PRODUCER;
+    EXPECT_EQ(received.load(), n);
+    EXPECT_EQ(sum.load(), n * (n - 1) / 2);
+}
+
+// Тесты для параллельной обработки битв
+static void fillBattleStore(NPCStore& store, std::vector<ThreadBattle>& battles) {
+    for (std::uint32_t i = 0; i < 60; ++i) {
+        store.add(static_cast<NPCType>(i % NPC_TYPE_COUNT), "NPC_" + std::to_string(i), 0, 0);
+    }
+    // Много битв с повторяющимися участниками, включая невозможные
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<std::uint32_t> pick(0, 59);
+    for (int k = 0; k < 500; ++k) {
+        std::uint32_t a = pick(gen);
+        std::uint32_t d = pick(gen);
+        if (a == d) continue;
+        battles.push_back(ThreadBattle{store.handleOf(a), store.handleOf(d),
+                                       static_cast<std::uint32_t>(k / 50)});
+    }
+}
+
+TEST(BattleResolverTest, SameResultsForAnyWorkerCount) {
+    NPCStore reference;
+    std::vector<ThreadBattle> battles;
+    fillBattleStore(reference, battles);
+    std::vector<BattleOutcome> expected;
+    BattleResolver(1, 12345).resolve(reference, battles.data(), battles.size(), expected);
+    
+    size_t kills = 0;
+    for (const auto& outcome : expected) kills += outcome.killed;
+    EXPECT_GT(kills, 0u);
+    EXPECT_LT(reference.aliveCount(), 60u);
+    
+    for (size_t workers : {2u, 4u}) {
+        NPCStore store;
+        std::vector<ThreadBattle> same;
+        fillBattleStore(store, same);
+        
+        BattleResolver resolver(workers, 12345);
+        std::vector<BattleOutcome> outcomes;
+        resolver.resolve(store, same.data(), same.size(), outcomes);
+        EXPECT_GT(resolver.getLastWaveCount(), 1u);
+        
+        ASSERT_EQ(outcomes.size(), expected.size());
+        for (size_t k = 0; k < outcomes.size(); ++k) {
+            EXPECT_EQ(outcomes[k].fought, expected[k].fought) << k;
+            EXPECT_EQ(outcomes[k].killed, expected[k].killed) << k;
+            EXPECT_EQ(outcomes[k].attackRoll, expected[k].attackRoll) << k;
+        }
+        for (NPCStore::Index i = 0; i < store.size(); ++i) {
+            EXPECT_EQ(store.isAlive(i), reference.isAlive(i)) << i;
+        }
+    }
+}
+
+TEST(BattleResolverTest, DeadNPCsDoNotFightAndDieOnce) {
+    NPCStore store;
+    auto knight = store.add(NPCType::Knight, "K", 0, 0);
+    auto orc = store.add(NPCType::Orc, "O", 0, 0);
+    EXPECT_TRUE(store.tryKill(orc));
+    EXPECT_FALSE(store.tryKill(orc));
+    
+    ThreadBattle battle{store.handleOf(knight), store.handleOf(orc), 1};
+    std::vector<BattleOutcome> outcomes;
+    BattleResolver(2, 1).resolve(store, &battle, 1, outcomes);
+    ASSERT_EQ(outcomes.size(), 1u);
+    EXPECT_FALSE(outcomes[0].fought);
+    EXPECT_FALSE(outcomes[0].killed);
+}
+
+// Тесты для планировщика заданий и тика симуляции
+TEST(JobSystemTest, ParallelForCoversEveryIndexOnce) {
+    JobSystem jobs(3);
+    std::vector<std::atomic<int>> hits(10000);
+    
+    jobs.parallelFor(hits.size(), 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) hits[i]++;
+        // Вложенный parallelFor: ожидание выполняет задания, а не спит
+        JobCounter nested;
+        jobs.submit([]() {}, nested);
+        jobs.wait(nested);
+    });
+    
+    for (const auto& hit : hits) {
+        ASSERT_EQ(hit.load(), 1);
+    }
+    
+    std::uint64_t totalJobs = 0;
+    for (const auto& worker : jobs.stats()) totalJobs += worker.jobs;
+    EXPECT_GE(totalJobs, hits.size() / 64);
+}
+
+static void fillSimulationStore(NPCStore& store) {
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> pos(0.0f, 199.0f);
+    for (int i = 0; i < 3000; ++i) {
+        store.add(static_cast<NPCType>(i % NPC_TYPE_COUNT), "NPC_" + std::to_string(i),
+                  pos(gen), pos(gen));
+    }
+}
+
+TEST(SimulationTest, TicksDoNotDependOnWorkerCount) {
+    NPCStore single;
+    fillSimulationStore(single);
+    JobSystem oneWorker(1);
+    Simulation reference(single, oneWorker, 99, 200, 200, 10.0f);
+    
+    NPCStore multi;
+    fillSimulationStore(multi);
+    JobSystem threeWorkers(3);
+    Simulation parallel(multi, threeWorkers, 99, 200, 200, 10.0f);
+    
+    size_t kills = 0;
+    for (int t = 0; t < 5; ++t) {
+        const TickReport& expected = reference.step();
+        const TickReport& actual = parallel.step();
+        EXPECT_EQ(actual.pairs, expected.pairs);
+        EXPECT_EQ(actual.outcomes.size(), expected.outcomes.size());
+        EXPECT_EQ(actual.kills, expected.kills);
+        EXPECT_EQ(actual.alive, expected.alive);
+        kills += expected.kills;
+    }
+    EXPECT_GT(kills, 0u);
+    
+    ASSERT_EQ(single.size(), multi.size());
+    for (NPCStore::Index i = 0; i < single.size(); ++i) {
+        EXPECT_EQ(single.getX(i), multi.getX(i));
+        EXPECT_EQ(single.getY(i), multi.getY(i));
+        EXPECT_EQ(single.isAlive(i), multi.isAlive(i));
+    }
+}
+
+TEST(SimulationTest, BattleLimitSamplesContactsIndependentlyOfWorkers) {
+    NPCStore full, single, multi;
+    fillSimulationStore(full);
+    fillSimulationStore(single);
+    fillSimulationStore(multi);
+    JobSystem oneWorker(1);
+    JobSystem threeWorkers(3);
+    Simulation unlimited(full, oneWorker, 99, 200, 200, 10.0f);
+    Simulation reference(single, oneWorker, 99, 200, 200, 10.0f);
+    Simulation parallel(multi, threeWorkers, 99, 200, 200, 10.0f);
+    reference.setBattleLimit(500);
+    parallel.setBattleLimit(500);
+    
+    const TickReport& all = unlimited.step();
+    // Очередь пуста к началу тика: ни одна пара не отброшена как повторная
+    EXPECT_EQ(all.battlesDropped, 0u);
+    EXPECT_EQ(unlimited.getBattleQueue().stats().coalesced, 0u);
+    ASSERT_GT(all.battlesQueued, 5000u);
+    std::set<std::pair<NPCStore::Index, NPCStore::Index>> firstContacts;
+    for (size_t k = 0; k < 500; ++k) {
+        firstContacts.insert({all.outcomes[k].attacker, all.outcomes[k].defender});
+    }
+    
+    for (int t = 0; t < 3; ++t) {
+        const TickReport& expected = reference.step();
+        const TickReport& actual = parallel.step();
+        EXPECT_LE(expected.battlesQueued, 500u);
+        EXPECT_GT(expected.battlesDropped, 0u);
+        EXPECT_EQ(actual.battlesQueued, expected.battlesQueued);
+        EXPECT_EQ(actual.battlesDropped, expected.battlesDropped);
+        ASSERT_EQ(actual.outcomes.size(), expected.outcomes.size());
+        for (size_t k = 0; k < expected.outcomes.size(); ++k) {
+            EXPECT_EQ(actual.outcomes[k].attacker, expected.outcomes[k].attacker);
+            EXPECT_EQ(actual.outcomes[k].defender, expected.outcomes[k].defender);
+            EXPECT_EQ(actual.outcomes[k].killed, expected.outcomes[k].killed);
+        }
+        if (t == 0) {
+            // Выборка по всему миру, а не первые контакты обхода сетки
+            EXPECT_EQ(expected.battlesQueued + expected.battlesDropped, all.battlesQueued + all.battlesDropped);
+            size_t fromPrefix = 0;
+            for (const auto& outcome : expected.outcomes) {
+                fromPrefix += firstContacts.count({outcome.attacker, outcome.defender});
+            }
+            EXPECT_LT(fromPrefix, 100u);
+        }
+    }
+}
+
+// Тесты для двойного буфера кадров
+TEST(FrameBufferTest, PinnedFrameIsNotOverwritten) {
+    NPCStore npcs;
+    npcs.add(NPCType::Bear, "Misha", 10.0f, 20.0f);
+    std::array<size_t, NPC_TYPE_COUNT> counts{};
+    counts[typeIndex(NPCType::Bear)] = 1;
+    
+    FrameBuffer frames;
+    frames.publish(npcs, 1, counts, 1);
+    auto guard = frames.acquire();
+    ASSERT_EQ(guard->tick, 1u);
+    ASSERT_EQ(guard->getAliveNPCs().size(), 1u);
+    EXPECT_EQ(guard->getAliveNPCs()[0].getName(), "Misha");
+    
+    // Второй кадр пишется в свободный буфер, третий ждет освобождения первого
+    std::atomic<std::uint32_t> published{0};
+    std::thread writer([&]() {
+        for (std::uint32_t tick = 2; tick <= 3; ++tick) {
+            npcs.move(0, 1, 0, 100, 100);
+            frames.publish(npcs, tick, counts, 1);
+            published = tick;
+        }
+    });
+    while (published < 2) std::this_thread::yield();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(published.load(), 2u);
+    EXPECT_EQ(guard->tick, 1u);
+    EXPECT_EQ(guard->xs[0], 10.0f);
+    
+    guard.release();
+    writer.join();
+    auto latest = frames.acquire();
+    EXPECT_EQ(latest->tick, 3u);
+    EXPECT_EQ(latest->xs[0], npcs.getX(0));
+    EXPECT_NE(latest->xs[0], 10.0f);
+    EXPECT_GT(frames.stats().writeWaitMax.count(), 0);
+}
+
+// Тесты для снимка мира в разделяемой памяти
+TEST(SharedSnapshotTest, ReaderSeesConsistentFrames) {
+    std::string name = "/laba7_test_" + std::to_string(getpid());
+    NPCStore npcs;
+    for (int i = 0; i < 64; ++i) {
+        npcs.add(NPCType::Bear, "NPC_" + std::to_string(i), 1.0f, 1.0f);
+    }
+    std::array<size_t, NPC_TYPE_COUNT> counts{};
+    
+    // В сегмент помещаются только первые 32 слота
+    SharedSnapshotWriter writer(name, 32);
+    writer.publish(npcs, 1, counts, 64);
+    // Второй писатель не захватывает чужой сегмент
+    EXPECT_THROW(SharedSnapshotWriter(name, 64), std::runtime_error);
+    SharedSnapshotReader reader(name);
+    SnapshotFrame frame;
+    ASSERT_TRUE(reader.tryRead(frame));
+    EXPECT_EQ(frame.tick, 1u);
+    EXPECT_EQ(frame.size(), 32u);
+    EXPECT_EQ(frame.totalCount, 64u);
+    
+    // Все NPC двигаются одинаково: в рваном кадре x разошлись бы
+    float step = static_cast<float>(traitsOf(NPCType::Bear).moveDistance);
+    std::vector<float> dirX(npcs.size(), 1.0f), dirY(npcs.size(), 0.0f);
+    std::atomic<bool> done{false};
+    std::thread simulation([&]() {
+        for (std::uint64_t tick = 2; tick <= 2000; ++tick) {
+            npcs.moveAll(dirX.data(), dirY.data(), 1 << 20, 100);
+            writer.publish(npcs, tick, counts, 64);
+        }
+        done = true;
+    });
+    // Хотя бы одно чтение, даже если поток симуляции успел все до него
+    size_t reads = 0;
+    do {
+        reader.read(frame);
+        for (float x : frame.xs) {
+            ASSERT_EQ(x, 1.0f + step * static_cast<float>(frame.tick - 1));
+        }
+        ++reads;
+    } while (!done);
+    simulation.join();
+    reader.read(frame);
+    EXPECT_EQ(frame.tick, 2000u);
+    EXPECT_GT(reads, 0u);
+    
+    EXPECT_THROW(SharedSnapshotReader("/laba7_missing_" + std::to_string(getpid())),
+                 std::runtime_error);
+}
+
+// Тесты для счетчикового генератора
+TEST(PhiloxTest, MatchesReferenceVectors) {
+    // Известные ответы Philox4x32-10 из Random123
+    EXPECT_EQ(philox::philox4x32({0, 0, 0, 0}, {0, 0}),
+              (philox::Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+    EXPECT_EQ(philox::philox4x32({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+                                 {0xffffffff, 0xffffffff}),
+              (philox::Counter{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+    EXPECT_EQ(philox::philox4x32({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+                                 {0xa4093822, 0x299f31d0}),
+              (philox::Counter{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+}
+
+TEST(PhiloxTest, BatchedDirectionsMatchSingleDraws) {
+    CounterRng rng(12345);
+    std::vector<float> dirX(1000), dirY(1000);
+    // Два куска в обратном порядке - как на разных потоках
+    rng.fillDirections(7, 500, 1000, dirX.data(), dirY.data());
+    rng.fillDirections(7, 0, 500, dirX.data(), dirY.data());
+    
+    int counts[3] = {};
+    for (size_t i = 0; i < dirX.size(); ++i) {
+        philox::Counter words = rng.draw(7, i, RandomPurpose::Direction);
+        EXPECT_EQ(dirX[i], static_cast<float>(static_cast<int>(philox::below(words[0], 3)) - 1));
+        ++counts[static_cast<int>(dirX[i]) + 1];
+    }
+    for (int count : counts) {
+        EXPECT_GT(count, 250);
+    }
+    // Другой тик или назначение - другие числа
+    EXPECT_NE(rng.draw(7, 1, RandomPurpose::Direction), rng.draw(8, 1, RandomPurpose::Direction));
+    EXPECT_NE(rng.draw(7, 1, RandomPurpose::Direction), rng.draw(7, 1, RandomPurpose::Dice));
+}
+
+// Тесты для разреженной карты чанков
+TEST(ChunkMapTest, AllocatesOnlyOccupiedChunks) {
+    ChunkMap chunks(100.0f);
+    chunks.insert(0, 950000.0f, 10.0f);
+    chunks.insert(1, 10.0f, 10.0f);
+    chunks.insert(2, 50.0f, 60.0f);
+    EXPECT_EQ(chunks.size(), 3u);
+    EXPECT_EQ(chunks.chunkCount(), 2u);
+    
+    const auto& active = chunks.activeChunks();
+    ASSERT_EQ(active.size(), 2u);
+    const ChunkMap::Chunk* origin = active[0]->cx == 0 ? active[0] : active[1];
+    const ChunkMap::Chunk* far = active[0]->cx == 0 ? active[1] : active[0];
+    EXPECT_EQ(origin->members.size(), 2u);
+    EXPECT_EQ(far->cx, 9500);
+    
+    // Переход в соседний чанк и освобождение опустевшего
+    EXPECT_FALSE(chunks.update(1, 20.0f, 20.0f));
+    EXPECT_TRUE(chunks.update(0, 10.0f, 150.0f));
+    EXPECT_EQ(chunks.chunkCount(), 2u);
+    EXPECT_TRUE(chunks.isInChunk(0, 99.0f, 199.0f));
+    
+    chunks.removeIf([](ChunkMap::Id id) { return id != 2; });
+    EXPECT_EQ(chunks.size(), 1u);
+    EXPECT_EQ(chunks.chunkCount(), 1u);
+    EXPECT_FALSE(chunks.contains(0));
+    EXPECT_EQ(chunks.activeChunks()[0]->members, std::vector<ChunkMap::Id>{2});
+}
+
+TEST(SimulationTest, HugeSparseWorldOnlyTouchesHotSpots) {
+    // Мир 10^6 x 10^6 с двумя скоплениями NPC
+    NPCStore npcs;
+    for (int i = 0; i < 2000; ++i) {
+        float base = i % 2 ? 900000.0f : 1000.0f;
+        npcs.add(static_cast<NPCType>(i % NPC_TYPE_COUNT), "NPC_" + std::to_string(i),
+                 base + static_cast<float>((i * 37) % 200), base + static_cast<float>((i * 91) % 200));
+    }
+    JobSystem jobs(2);
+    Simulation simulation(npcs, jobs, 3, 1000000, 1000000, 10.0f);
+    
+    size_t kills = 0;
+    for (int t = 0; t < 10; ++t) {
+        const TickReport& report = simulation.step();
+        kills += report.kills;
+        EXPECT_LE(report.activeChunks, 64u);
+    }
+    EXPECT_GT(kills, 0u);
+    // Убитые на последнем тике уходят из чанков в начале следующего
+    EXPECT_GE(simulation.getChunks().size(), npcs.aliveCount());
+    EXPECT_LT(simulation.getChunks().memoryBytes(), 1u << 20);
+}
+
+TEST(ChunkMapTest, SingleTypeChunkSleepsUntilEnemyIsAdjacent) {
+    ChunkMap chunks(100.0f);
+    auto tag = [](NPCType type) { return static_cast<ChunkMap::Tag>(typeIndex(type)); };
+    for (ChunkMap::Id id = 0; id < 5; ++id) {
+        chunks.insert(id, 10.0f + id, 10.0f, tag(NPCType::Orc));
+    }
+    auto hostile = [&](const ChunkMap::Chunk& chunk) {
+        std::uint32_t around = ChunkMap::neighbourhoodMask(chunk);
+        for (size_t t = 0; t < NPC_TYPE_COUNT; ++t) {
+            if ((chunk.mask >> t & 1) && (hostileMask(static_cast<NPCType>(t)) & around)) return true;
+        }
+        return false;
+    };
+    std::vector<bool> transitions;
+    auto onChange = [&](const ChunkMap::Chunk&, bool asleep) { transitions.push_back(asleep); };
+    
+    for (int t = 0; t < 3; ++t) {
+        EXPECT_FALSE(chunks.find(0, 0)->asleep);
+        chunks.updateSleep(hostile, 3, onChange);
+    }
+    EXPECT_TRUE(chunks.find(0, 0)->asleep);
+    EXPECT_TRUE(chunks.awakeChunks().empty());
+    
+    // Медведь в соседнем чанке будит орков на следующем тике
+    chunks.insert(5, 150.0f, 150.0f, tag(NPCType::Bear));
+    chunks.updateSleep(hostile, 3, onChange);
+    EXPECT_FALSE(chunks.find(0, 0)->asleep);
+    EXPECT_EQ(transitions, (std::vector<bool>{true, false}));
+    EXPECT_EQ(chunks.awakeChunks().size(), 2u);
+    EXPECT_EQ(chunks.find(0, 0)->tagCounts[typeIndex(NPCType::Orc)], 5u);
+    EXPECT_EQ(chunks.neighbourhoodMask(*chunks.find(1, 1)), typeBit(NPCType::Orc) | typeBit(NPCType::Bear));
+}
+
+TEST(UnionFindTest, MergesIslands) {
+    UnionFind<std::uint64_t> islands;
+    islands.add(1);
+    islands.unite(2, 3);
+    islands.unite(3, 4);
+    islands.unite(10, 11);
+    EXPECT_EQ(islands.setCount(), 3u);
+    EXPECT_EQ(islands.find(2), islands.find(4));
+    EXPECT_NE(islands.find(1), islands.find(4));
+    EXPECT_FALSE(islands.unite(4, 2));
+    EXPECT_TRUE(islands.unite(1, 11));
+    EXPECT_EQ(islands.setCount(), 2u);
+}
+
+TEST(SimulationTest, SingleTypeClusterStopsBeingSimulated) {
+    NPCStore npcs;
+    for (int i = 0; i < 300; ++i) {
+        npcs.add(NPCType::Orc, "Orc_" + std::to_string(i),
+                 5000.0f + static_cast<float>(i % 30), 5000.0f + static_cast<float>(i / 30));
+    }
+    // Драка далеко в стороне продолжается
+    npcs.add(NPCType::Knight, "Knight", 100.0f, 100.0f);
+    npcs.add(NPCType::Orc, "Lonely_Orc", 101.0f, 100.0f);
+    JobSystem jobs(2);
+    Simulation simulation(npcs, jobs, 5, 100000, 100000, 10.0f);
+    simulation.setSleepAfter(4);
+    
+    EXPECT_GE(simulation.step().moved, 301u);
+    // Орки, перешедшие в новый чанк, досыпают свои тики простоя там
+    for (int t = 0; t < 8; ++t) {
+        simulation.step();
+    }
+    float x = npcs.getX(0);
+    float y = npcs.getY(0);
+    const TickReport& report = simulation.step();
+    EXPECT_LE(report.moved, 2u);
+    EXPECT_GE(report.sleepingChunks, 1u);
+    EXPECT_EQ(npcs.getX(0), x);
+    EXPECT_EQ(npcs.getY(0), y);
+    EXPECT_GE(report.alive, 300u);
+    EXPECT_EQ(report.typeCounts[typeIndex(NPCType::Orc)] + report.typeCounts[typeIndex(NPCType::Knight)],
+              report.alive);
+}
+
+TEST(ScenarioTest, GeneratesRequestedShapes) {
+    const int count = 900;
+    for (ScenarioKind kind : ScenarioGenerator::all()) {
+        auto spawns = ScenarioGenerator::generate(kind, count, 300, 200, 5);
+        ASSERT_EQ(spawns.size(), static_cast<size_t>(count)) << ScenarioGenerator::name(kind);
+        EXPECT_EQ(ScenarioGenerator::parse(ScenarioGenerator::name(kind)), kind);
+        for (const auto& s : spawns) {
+            EXPECT_GE(s.x, 0.0f);
+            EXPECT_LT(s.x, 300.0f);
+            EXPECT_GE(s.y, 0.0f);
+            EXPECT_LT(s.y, 200.0f);
+        }
+    }
+    
+    auto oneCell = ScenarioGenerator::generate(ScenarioKind::OneCell, count, 300, 200, 5);
+    for (const auto& s : oneCell) {
+        EXPECT_LE(std::abs(s.x - oneCell[0].x), 1.0f);
+        EXPECT_LE(std::abs(s.y - oneCell[0].y), 1.0f);
+    }
+    
+    for (const auto& s : ScenarioGenerator::generate(ScenarioKind::SingleType, count, 300, 200, 5)) {
+        EXPECT_EQ(s.type, NPCType::Orc);
+    }
+    
+    std::array<int, NPC_TYPE_COUNT> perType{};
+    for (const auto& s : ScenarioGenerator::generate(ScenarioKind::Balanced, count, 300, 200, 5)) {
+        ++perType[static_cast<size_t>(s.type)];
+    }
+    for (int n : perType) {
+        EXPECT_EQ(n, count / NPC_TYPE_COUNT);
+    }
+}
+
+TEST(HistogramTest, PercentilesWithinBucketPrecision) {
+    Histogram histogram;
+    for (std::uint64_t v = 1; v <= 100000; ++v) {
+        histogram.record(v);
+    }
+    EXPECT_EQ(histogram.count(), 100000u);
+    EXPECT_EQ(histogram.min(), 1u);
+    EXPECT_EQ(histogram.max(), 100000u);
+    EXPECT_NEAR(histogram.percentile(0.5), 50000.0, 50000.0 / Histogram::SUB_BUCKETS);
+    EXPECT_NEAR(histogram.percentile(0.99), 99000.0, 99000.0 / Histogram::SUB_BUCKETS);
+    EXPECT_EQ(histogram.percentile(1.0), 100000u);
+    
+    // Ячейки идут подряд и покрывают весь диапазон
+    for (size_t b = 1; b < Histogram::BUCKET_COUNT; ++b) {
+        ASSERT_EQ(Histogram::bucketLow(b), Histogram::bucketHigh(b - 1) + 1);
+        ASSERT_EQ(Histogram::bucketOf(Histogram::bucketLow(b)), b);
+    }
+    EXPECT_EQ(Histogram::bucketOf(~std::uint64_t(0)), Histogram::BUCKET_COUNT - 1);
+}
+
+TEST(MetricsTest, MergesThreadLocalDataAndLockStats) {
+    if (!Metrics::COMPILED) GTEST_SKIP() << "built without metrics";
+    Metrics::reset();
+    Metrics::setEnabled(true);
+    
+    InstrumentedMutex mutex(LockId::Print);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&mutex]() {
+            for (int i = 0; i < 1000; ++i) {
+                std::lock_guard<InstrumentedMutex> lock(mutex);
+                Metrics::add(MetricCounter::Kills);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    NPCStore store;
+    for (int i = 0; i < 300; ++i) {
+        store.add(static_cast<NPCType>(i % NPC_TYPE_COUNT), "NPC_" + std::to_string(i), i % 50, i / 50);
+    }
+    JobSystem jobs(2);
+    Simulation simulation(store, jobs, 3, 50, 50, 10.0f);
+    for (int tick = 0; tick < 5; ++tick) {
+        simulation.step();
+    }
+    
+    MetricsSnapshot snapshot = Metrics::snapshot();
+    Metrics::setEnabled(false);
+    // Потоки завершились, их данные сохранились
+    EXPECT_GE(snapshot.counter(MetricCounter::Kills), 4000u);
+    EXPECT_EQ(snapshot.lock(LockId::Print).acquisitions, 4000u);
+    EXPECT_EQ(snapshot.lock(LockId::Print).hold.count(), 4000u);
+    EXPECT_EQ(snapshot.counter(MetricCounter::Ticks), 5u);
+    EXPECT_EQ(snapshot.histogram(MetricHistogram::TickTotal).count(), 5u);
+    EXPECT_EQ(snapshot.histogram(MetricHistogram::BattleQueueDepth).count(), 5u);
+    EXPECT_GT(snapshot.counter(MetricCounter::BattlesResolved), 0u);
+    
+    std::string json = Metrics::toJson(snapshot);
+    EXPECT_NE(json.find("\"tick_move\":{\"unit\":\"ns\",\"count\":5"), std::string::npos);
+    std::string text = Metrics::toPrometheus(snapshot);
+    EXPECT_NE(text.find("# TYPE laba7_tick_phase_seconds histogram"), std::string::npos);
+    EXPECT_NE(text.find("laba7_lock_acquisitions_total{lock=\"print\"} 4000"), std::string::npos);
+    EXPECT_NE(text.find("laba7_tick_phase_seconds_count{phase=\"battle\"} 5"), std::string::npos);
+}
+
+TEST(AllocTrackerTest, CountsByTagAndEnforcesTickBudgets) {
+    if (!AllocTracker::hooked()) GTEST_SKIP() << "operator new hook is not linked";
+    AllocTracker::reset();
+    AllocTracker::setEnabled(true);
+    {
+        ScopedAllocTag tag(AllocTag::Render);
+        std::vector<int> buffer(1000);
+        AllocTracker::nextTick();
+    }
+    AllocReport render = AllocTracker::report();
+    EXPECT_EQ(render.tag(AllocTag::Render).allocations, 1u);
+    EXPECT_EQ(render.tag(AllocTag::Render).bytes, 4000u);
+    EXPECT_EQ(render.tag(AllocTag::Render).liveBytes, 0);
+    EXPECT_EQ(render.tag(AllocTag::Render).peakLiveBytes, 4000);
+    EXPECT_EQ(render.tag(AllocTag::Render).maxTickBytes, 4000u);
+    
+    // Установившиеся тики: буферы фаз уже выросли, задания наследуют тег
+    NPCStore store;
+    for (int i = 0; i < 3000; ++i) {
+        store.add(static_cast<NPCType>(i % NPC_TYPE_COUNT), "NPC_" + std::to_string(i), i % 300, i / 10);
+    }
+    JobSystem jobs(2);
+    Simulation simulation(store, jobs, 11, 300, 300, 10.0f);
+    for (int tick = 0; tick < 30; ++tick) {
+        simulation.step();
+    }
+    AllocTracker::reset();
+    for (int tick = 0; tick < 20; ++tick) {
+        simulation.step();
+        AllocTracker::nextTick();
+    }
+    AllocReport ticks = AllocTracker::report();
+    AllocTracker::setEnabled(false);
+    
+    // Бюджеты: перемещение выделяет только на новые клетки сетки и чанки,
+    // битвы - на задания планировщика, публикация кадра - ничего
+    EXPECT_EQ(ticks.ticks, 20u);
+    EXPECT_LE(ticks.tag(AllocTag::Movement).maxTickAllocations, store.size() / 10) << AllocTracker::format(ticks);
+    EXPECT_LE(ticks.tag(AllocTag::Battle).maxTickAllocations, 64u) << AllocTracker::format(ticks);
+    EXPECT_EQ(ticks.tag(AllocTag::Render).allocations, 0u) << AllocTracker::format(ticks);
+}
+
+static std::vector<std::string> readLines(const std::string& path) {
+    std::ifstream file(path);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line);) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+TEST(FileLoggerTest, GroupCommitsLinesInOrder) {
+    const std::string path = "test_file_logger_" + std::to_string(getpid()) + ".txt";
+    std::remove(path.c_str());
+    {
+        FileLoggerOptions options;
+        options.flushInterval = std::chrono::hours(1);
+        options.sync = SyncPolicy::EveryBatch;
+        FileLogger logger(path, options);
+        // Файл и поток записи появляются с первой строкой
+        EXPECT_FALSE(logger.isOpen());
+        logger.flush();
+        EXPECT_FALSE(std::ifstream(path).good());
+        for (int i = 0; i < 500; ++i) {
+            logger.onBattleResult("battle " + std::to_string(i));
+        }
+        logger.onBattleResult(std::string(1000, 'x'));
+        ASSERT_TRUE(logger.isOpen());
+        logger.flush();
+        
+        FileLoggerStats stats = logger.stats();
+        EXPECT_EQ(stats.logged, 501u);
+        EXPECT_EQ(stats.dropped, 0u);
+        EXPECT_EQ(stats.truncated, 1u);
+        // Одна запись на сотни строк, fsync после каждой записи
+        EXPECT_LE(stats.writes, 2u);
+        EXPECT_EQ(stats.syncs, stats.writes);
+        
+        auto lines = readLines(path);
+        ASSERT_EQ(lines.size(), 501u);
+        EXPECT_EQ(lines[0], "battle 0");
+        EXPECT_EQ(lines[499], "battle 499");
+        EXPECT_EQ(lines[500].size(), FileLogger::MAX_LINE);
+        
+        logger.onBattleResult("after flush");
+    }
+    // Деструктор дописывает остаток
+    EXPECT_EQ(readLines(path).back(), "after flush");
+    std::remove(path.c_str());
+}
+
+TEST(FileLoggerTest, CountsDropsOnOverflow) {
+    const std::string path = "test_file_logger_drops_" + std::to_string(getpid()) + ".txt";
+    std::remove(path.c_str());
+    FileLoggerOptions options;
+    options.capacity = 8;
+    options.flushInterval = std::chrono::hours(1);
+    FileLogger logger(path, options);
+    for (int i = 0; i < 10000; ++i) {
+        logger.onBattleResult("line " + std::to_string(i));
+    }
+    logger.flush();
+    
+    FileLoggerStats stats = logger.stats();
+    EXPECT_EQ(stats.logged + stats.dropped, 10000u);
+    EXPECT_GT(stats.dropped, 0u);
+    EXPECT_EQ(readLines(path).size(), stats.logged);
+    
+    FileLogger missing("no_such_dir/log.txt");
+    EXPECT_FALSE(missing.isOpen());
+    missing.onBattleResult("lost");
+    EXPECT_EQ(missing.stats().dropped, 1u);
+    std::remove(path.c_str());
+}
+
+// Наблюдатель только со строковым интерфейсом
+class TextCollector : public BattleObserver {
+public:
+    std::vector<std::string> lines;
+    void onBattleResult(const std::string& result) override { lines.push_back(result); }
+};
+
+// Наблюдатель, которому текст не нужен: копирует события
+class EventCollector : public BattleObserver {
+public:
+    std::vector<BattleEvent> events;
+    void onBattleEvent(const BattleEvent& event, const NameTable&) override { events.push_back(event); }
+};
+
+TEST(BattleEventTest, SinksFormatOldStrings) {
+    NPCStore store;
+    EntityHandle orc = store.handleOf(store.add(NPCType::Orc, "Grom", 1, 1));
+    EntityHandle bear = store.handleOf(store.add(NPCType::Bear, "Misha", 2, 2));
+    NameTable names;
+    names.set(orc, "Grom");
+    names.set(bear, "Misha");
+    
+    BattleEvent kill;
+    kill.attacker = orc;
+    kill.defender = bear;
+    kill.attackerType = NPCType::Orc;
+    kill.defenderType = NPCType::Bear;
+    EXPECT_EQ(formatBattleEvent(kill, names), "Orc Grom kills Bear Misha");
+    kill.result = BattleResult::DefenderKills;
+    EXPECT_EQ(formatBattleEvent(kill, names), "Bear Misha kills Orc Grom");
+    kill.result = BattleResult::BothDie;
+    EXPECT_EQ(formatBattleEvent(kill, names), "Orc Grom and Bear Misha kill each other");
+    
+    BattleEvent rolled = kill;
+    rolled.result = BattleResult::Defended;
+    rolled.attackRoll = 2;
+    rolled.defenseRoll = 5;
+    EXPECT_EQ(formatBattleEvent(rolled, names), "Battle: Orc Grom [2] vs Bear Misha [5] -> Misha DEFENDED!");
+    rolled.result = BattleResult::AttackerKills;
+    rolled.defender = EntityHandle{7, 0};
+    EXPECT_EQ(formatBattleEvent(rolled, names), "Battle: Orc Grom [2] vs Bear #7 [5] -> #7 KILLED!");
+    
+    // Строковый наблюдатель получает текст через адаптер, файловый лог
+    // собирает его в потоке записи
+    const std::string path = "test_battle_events_" + std::to_string(getpid()) + ".txt";
+    std::remove(path.c_str());
+    {
+        auto text = std::make_shared<TextCollector>();
+        auto file = std::make_shared<FileLogger>(path);
+        BattleNotifier notifier;
+        notifier.setNames(&names);
+        notifier.addObserver(text);
+        notifier.addObserver(file);
+        notifier.notifyObservers(kill);
+        notifier.notifyObservers(rolled);
+        file->flush();
+        
+        ASSERT_EQ(text->lines.size(), 2u);
+        EXPECT_EQ(text->lines[0], "Orc Grom and Bear Misha kill each other");
+        EXPECT_EQ(readLines(path), text->lines);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(BattleEventTest, VisitorDoesNotAllocate) {
+    NPCStore store;
+    for (int i = 0; i < 64; ++i) {
+        store.add(i % 2 ? NPCType::Bear : NPCType::Orc, "NPC_" + std::to_string(i), i, i);
+    }
+    auto collector = std::make_shared<EventCollector>();
+    collector->events.reserve(64);
+    BattleNotifier notifier;
+    notifier.addObserver(collector);
+    BattleVisitor visitor(10.0f, notifier, store);
+    
+    AllocTracker::reset();
+    AllocTracker::setEnabled(true);
+    {
+        ScopedAllocTag tag(AllocTag::Battle);
+        for (NPCStore::Index i = 0; i < 64; i += 2) {
+            visitor.setCurrentAttacker(i);
+            visitor.visit(store.view(i + 1));
+            for (auto index : visitor.markedList()) store.kill(index);
+            visitor.clearMarkedForRemoval();
+        }
+    }
+    AllocReport report = AllocTracker::report();
+    AllocTracker::setEnabled(false);
+    
+    ASSERT_EQ(collector->events.size(), 32u);
+    EXPECT_EQ(collector->events[3].attacker, store.handleOf(6));
+    EXPECT_EQ(collector->events[3].result, BattleResult::AttackerKills);
+    EXPECT_EQ(collector->events[3].x, 7.0f);
+    EXPECT_FALSE(store.isAlive(7));
+    if (AllocTracker::hooked()) {
+        EXPECT_EQ(report.tag(AllocTag::Battle).allocations, 0u) << AllocTracker::format(report);
+        EXPECT_EQ(report.tag(AllocTag::Logging).allocations, 0u) << AllocTracker::format(report);
+    }
+}
+
+TEST(BattleNotifierTest, AsyncKeepsPerObserverOrderAndFlushes) {
+    NameTable names;
+    BattleNotifier notifier;
+    notifier.setNames(&names);
+    std::vector<std::shared_ptr<EventCollector>> collectors;
+    for (int i = 0; i < 3; ++i) {
+        collectors.push_back(std::make_shared<EventCollector>());
+        notifier.addObserver(collectors.back());
+    }
+    auto text = std::make_shared<TextCollector>();
+    
+    NotifierOptions options;
+    options.executors = 2;
+    options.capacity = 16;
+    notifier.startAsync(options);
+    notifier.addObserver(text);
+    EXPECT_TRUE(notifier.isAsync());
+    
+    // Два производителя; у каждого свой диапазон тиков
+    auto produce = [&](std::uint32_t base) {
+        for (std::uint32_t i = 0; i < 500; ++i) {
+            BattleEvent event;
+            event.tick = base + i;
+            notifier.notifyObservers(event);
+        }
+    };
+    std::thread first(produce, 0);
+    std::thread second(produce, 1000);
+    first.join();
+    second.join();
+    notifier.notifyObservers("done");
+    notifier.flush();
+    
+    for (auto& collector : collectors) {
+        ASSERT_EQ(collector->events.size(), 1000u);
+        std::uint32_t lastLow = 0, lastHigh = 1000;
+        bool anyLow = false, anyHigh = false;
+        for (const auto& event : collector->events) {
+            if (event.tick < 1000) {
+                if (anyLow) {
+                    EXPECT_GT(event.tick, lastLow);
+                }
+                lastLow = event.tick;
+                anyLow = true;
+            } else {
+                if (anyHigh) {
+                    EXPECT_GT(event.tick, lastHigh);
+                }
+                lastHigh = event.tick;
+                anyHigh = true;
+            }
+        }
+    }
+    ASSERT_EQ(text->lines.size(), 1001u);
+    EXPECT_EQ(text->lines.back(), "done");
+    
+    NotifierStats stats = notifier.stats();
+    EXPECT_EQ(stats.dropped, 0u);
+    EXPECT_EQ(stats.delivered, stats.queued);
+    EXPECT_LE(stats.maxDepth, 16u);
+    
+    notifier.stopAsync();
+    EXPECT_FALSE(notifier.isAsync());
+    notifier.notifyObservers("sync");
+    EXPECT_EQ(text->lines.back(), "sync");
+}
+
+// Потоки процесса по /proc/self/task
+static size_t threadCount() {
+    size_t count = 0;
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) return 0;
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') ++count;
+    }
+    closedir(dir);
+    return count;
+}
+
+TEST(BattleNotifierTest, StartsExecutorWithFirstSubscription) {
+    size_t before = threadCount();
+    {
+        // Редактор без боев не подписывает логгеры и не держит потоков
+        DungeonEditor editor;
+        EXPECT_EQ(threadCount(), before);
+    }
+    
+    BattleNotifier notifier;
+    notifier.startAsync();
+    EXPECT_TRUE(notifier.isAsync());
+    EXPECT_EQ(threadCount(), before);
+    notifier.notifyObservers(BattleEvent{});
+    notifier.flush();
+    
+    auto collector = std::make_shared<EventCollector>();
+    notifier.addObserver(collector);
+    EXPECT_EQ(threadCount(), before + 1);
+    notifier.notifyObservers(BattleEvent{});
+    notifier.flush();
+    EXPECT_EQ(collector->events.size(), 1u);
+    notifier.stopAsync();
+    EXPECT_EQ(threadCount(), before);
+}
+
+// Наблюдатель, который держит исполнителя, пока его не отпустят
+class GateObserver : public BattleObserver {
+public:
+    std::atomic<bool> open{false};
+    std::atomic<bool> entered{false};
+    std::atomic<int> seen{0};
+    void onBattleEvent(const BattleEvent&, const NameTable&) override {
+        entered = true;
+        while (!open.load()) std::this_thread::yield();
+        seen.fetch_add(1);
+    }
+};
+
+TEST(BattleNotifierTest, BackpressureDropsWhenObserverStalls) {
+    for (auto policy : {NotifyBackpressure::DropNewest, NotifyBackpressure::DropOldest}) {
+        auto gate = std::make_shared<GateObserver>();
+        BattleNotifier notifier;
+        notifier.addObserver(gate);
+        NotifierOptions options;
+        options.capacity = 8;
+        options.backpressure = policy;
+        notifier.startAsync(options);
+        
+        // Медленный наблюдатель не задерживает отправителя
+        for (int i = 0; i < 100; ++i) {
+            notifier.notifyObservers(BattleEvent{});
+        }
+        // ...и подписки: исполнитель рассылает без блокировки подписок
+        while (!gate->entered.load()) std::this_thread::yield();
+        auto late = std::make_shared<EventCollector>();
+        SubscriptionId lateId = notifier.subscribe(late);
+        notifier.unsubscribe(lateId);
+        EXPECT_EQ(notifier.subscriptionCount(), 1u);
+        gate->open = true;
+        notifier.flush();
+        
+        NotifierStats stats = notifier.stats();
+        EXPECT_GT(stats.dropped, 0u);
+        EXPECT_EQ(static_cast<std::uint64_t>(gate->seen.load()) + stats.dropped, 100u);
+        EXPECT_EQ(stats.delivered, static_cast<std::uint64_t>(gate->seen.load()));
+    }
+}
+
+TEST(ConsoleLoggerTest, SummarizesKillsByTypePairAndTopKillers) {
+    NPCStore store;
+    EntityHandle knight = store.handleOf(store.add(NPCType::Knight, "Arthur", 0, 0));
+    EntityHandle bear = store.handleOf(store.add(NPCType::Bear, "Misha", 0, 0));
+    NameTable names;
+    names.set(knight, "Arthur");
+    names.set(bear, "Misha");
+    
+    std::ostringstream out;
+    ConsoleLoggerOptions options;
+    options.mode = ConsoleMode::Summary;
+    options.summaryInterval = std::chrono::hours(1);
+    ConsoleLogger console(options, out);
+    
+    auto battle = [&](EntityHandle attacker, NPCType attackerType, NPCType defenderType, BattleResult result) {
+        BattleEvent event;
+        event.attacker = attacker;
+        event.defender = EntityHandle{100, 0};
+        event.attackerType = attackerType;
+        event.defenderType = defenderType;
+        event.result = result;
+        console.onBattleEvent(event, names);
+    };
+    for (int i = 0; i < 3; ++i) battle(knight, NPCType::Knight, NPCType::Orc, BattleResult::AttackerKills);
+    battle(bear, NPCType::Bear, NPCType::Knight, BattleResult::AttackerKills);
+    battle(bear, NPCType::Bear, NPCType::Knight, BattleResult::Defended);
+    EXPECT_TRUE(out.str().empty());
+    
+    console.flush();
+    std::string text = out.str();
+    EXPECT_NE(text.find("5 fought, 4 kills, 1 defended"), std::string::npos) << text;
+    EXPECT_NE(text.find("kills: Knight>Orc 3, Bear>Knight 1"), std::string::npos) << text;
+    EXPECT_NE(text.find("top killers: Knight Arthur (3), Bear Misha (1)"), std::string::npos) << text;
+    EXPECT_EQ(console.stats().summaries, 1u);
+    EXPECT_EQ(console.stats().printed, 0u);
+}
+
+TEST(ConsoleLoggerTest, VerboseSamplesAndCapsWithExactCounts) {
+    NameTable names;
+    std::ostringstream out;
+    ConsoleLoggerOptions options;
+    options.sampleEvery = 3;
+    options.maxLinesPerSecond = 5;
+    ConsoleLogger console(options, out);
+    for (int i = 0; i < 100; ++i) {
+        console.onBattleEvent(BattleEvent{}, names);
+    }
+    console.flush();
+    
+    // Выборка оставляет 34 события из 100, в секунду помещается 5 строк
+    ConsoleLoggerStats stats = console.stats();
+    EXPECT_EQ(stats.events, 100u);
+    EXPECT_EQ(stats.sampledOut, 66u);
+    EXPECT_EQ(stats.printed, 5u);
+    EXPECT_EQ(stats.rateLimited, 29u);
+    
+    std::string text = out.str();
+    EXPECT_EQ(std::count(text.begin(), text.end(), '\n'), 6);
+    EXPECT_NE(text.find("... 95 battle lines suppressed"), std::string::npos) << text;
+}
+
+TEST(SubscriptionTest, IndexTouchesOnlyMatchingSubscriptions) {
+    // Тысяча наблюдателей за отдельными NPC и тысяча за отдельными клетками
+    std::vector<std::unique_ptr<Subscription>> storage;
+    SubscriptionIndex index;
+    for (std::uint32_t i = 0; i < 1000; ++i) {
+        auto byEntity = std::make_unique<Subscription>();
+        byEntity->filter.entity = EntityHandle{i, 0};
+        auto byRegion = std::make_unique<Subscription>();
+        float x = static_cast<float>(i % 40) * 40.0f;
+        float y = static_cast<float>(i / 40) * 40.0f;
+        byRegion->filter.region = BattleRegion{x, y, x + 10.0f, y + 10.0f};
+        index.add(byEntity.get());
+        index.add(byRegion.get());
+        storage.push_back(std::move(byEntity));
+        storage.push_back(std::move(byRegion));
+    }
+    EXPECT_EQ(index.size(), 2000u);
+    
+    BattleEvent event;
+    event.attacker = EntityHandle{5, 0};
+    event.defender = EntityHandle{5000, 0};
+    event.x = 45.0f;
+    event.y = 85.0f;
+    std::vector<Subscription*> seen;
+    index.forEachMatch(event, [&](Subscription& subscription) { seen.push_back(&subscription); });
+    ASSERT_EQ(seen.size(), 2u);
+    EXPECT_EQ(seen[0], storage[10].get());
+    EXPECT_EQ(seen[1], storage[2 * 81 + 1].get());
+    
+    index.remove(storage[10].get());
+    seen.clear();
+    index.forEachMatch(event, [&](Subscription& subscription) { seen.push_back(&subscription); });
+    EXPECT_EQ(seen.size(), 1u);
+    EXPECT_EQ(index.size(), 1999u);
+}
+
+TEST(SubscriptionTest, FiltersByKindTypeRegionAndEntity) {
+    NPCStore store;
+    EntityHandle orc = store.handleOf(store.add(NPCType::Orc, "Grom", 5, 5));
+    EntityHandle bear = store.handleOf(store.add(NPCType::Bear, "Misha", 5, 5));
+    EntityHandle knight = store.handleOf(store.add(NPCType::Knight, "Arthur", 50, 50));
+    
+    for (bool async : {false, true}) {
+        BattleNotifier notifier;
+        auto all = std::make_shared<EventCollector>();
+        auto kills = std::make_shared<EventCollector>();
+        auto bears = std::make_shared<EventCollector>();
+        auto corner = std::make_shared<EventCollector>();
+        auto watcher = std::make_shared<EventCollector>();
+        auto text = std::make_shared<TextCollector>();
+        
+        SubscriptionId allId = notifier.subscribe(all);
+        BattleFilter killFilter;
+        killFilter.results = resultBit(BattleResult::AttackerKills) | resultBit(BattleResult::BothDie);
+        notifier.subscribe(kills, killFilter);
+        BattleFilter bearFilter;
+        bearFilter.types = typeBit(NPCType::Bear);
+        notifier.subscribe(bears, bearFilter);
+        BattleFilter cornerFilter;
+        cornerFilter.region = BattleRegion{0, 0, 10, 10};
+        cornerFilter.results = resultBit(BattleResult::AttackerKills);
+        SubscriptionId cornerId = notifier.subscribe(corner, cornerFilter);
+        BattleFilter watchFilter;
+        watchFilter.entity = knight;
+        SubscriptionId watchId = notifier.subscribe(watcher, watchFilter);
+        BattleFilter textFilter;
+        textFilter.types = typeBit(NPCType::Orc);
+        notifier.subscribe(text, textFilter);
+        if (async) notifier.startAsync();
+        
+        auto send = [&](EntityHandle attacker, NPCType attackerType, EntityHandle defender, NPCType defenderType,
+                        BattleResult result, float x, float y) {
+            BattleEvent event;
+            event.attacker = attacker;
+            event.defender = defender;
+            event.attackerType = attackerType;
+            event.defenderType = defenderType;
+            event.result = result;
+            event.x = x;
+            event.y = y;
+            notifier.notifyObservers(event);
+        };
+        send(orc, NPCType::Orc, bear, NPCType::Bear, BattleResult::AttackerKills, 5, 5);
+        send(knight, NPCType::Knight, orc, NPCType::Orc, BattleResult::Defended, 5, 5);
+        send(bear, NPCType::Bear, knight, NPCType::Knight, BattleResult::AttackerKills, 50, 50);
+        notifier.notifyObservers("text only");
+        notifier.flush();
+        
+        EXPECT_EQ(all->events.size(), 3u);
+        EXPECT_EQ(kills->events.size(), 2u);
+        EXPECT_EQ(bears->events.size(), 2u);
+        ASSERT_EQ(corner->events.size(), 1u);
+        EXPECT_EQ(corner->events[0].defender, bear);
+        EXPECT_EQ(watcher->events.size(), 2u);
+        // Строковый наблюдатель получает текст подходящих событий, а
+        // текстовые уведомления - только подписки без фильтра
+        ASSERT_EQ(text->lines.size(), 2u);
+        EXPECT_EQ(text->lines[1], "Knight #2 attacks Orc #0: DEFENDED!");
+        
+        EXPECT_EQ(notifier.subscriptionStats(allId).delivered, 4u);
+        EXPECT_EQ(notifier.subscriptionStats(cornerId).delivered, 1u);
+        EXPECT_EQ(notifier.subscriptionStats(cornerId).filtered, 2u);
+        
+        notifier.unsubscribe(watchId);
+        notifier.removeObserver(all);
+        EXPECT_EQ(notifier.subscriptionCount(), 4u);
+        send(knight, NPCType::Knight, orc, NPCType::Orc, BattleResult::AttackerKills, 5, 5);
+        notifier.flush();
+        EXPECT_EQ(all->events.size(), 3u);
+        EXPECT_EQ(watcher->events.size(), 2u);
+        EXPECT_EQ(kills->events.size(), 3u);
+        EXPECT_EQ(corner->events.size(), 2u);
+    }
+}
+
+TEST(SubscriptionTest, FilteredCountsOnlyDispatchedEvents) {
+    BattleNotifier notifier;
+    auto gate = std::make_shared<GateObserver>();
+    auto kills = std::make_shared<EventCollector>();
+    notifier.subscribe(gate);
+    BattleFilter killFilter;
+    killFilter.results = resultBit(BattleResult::AttackerKills);
+    SubscriptionId killId = notifier.subscribe(kills, killFilter);
+    notifier.startAsync();
+    
+    BattleEvent defended;
+    defended.result = BattleResult::Defended;
+    notifier.notifyObservers(defended);
+    while (!gate->entered.load()) std::this_thread::yield();
+    for (int i = 0; i < 4; ++i) {
+        notifier.notifyObservers(defended);
+    }
+    // Исполнитель стоит: события в очереди еще не отсеяны
+    EXPECT_EQ(notifier.subscriptionStats(killId).filtered, 0u);
+    
+    gate->open = true;
+    notifier.flush();
+    EXPECT_EQ(notifier.subscriptionStats(killId).filtered, 5u);
+    
+    // Счет продолжается после перехода в синхронный режим
+    notifier.stopAsync();
+    notifier.notifyObservers(defended);
+    SubscriptionStats stats = notifier.subscriptionStats(killId);
+    EXPECT_EQ(stats.filtered, 6u);
+    EXPECT_EQ(stats.delivered, 0u);
+}
+
+// Тесты двоичного журнала битв
+TEST(BattleLogTest, IndexedQueriesMatchFullScan) {
+    const std::string path = "test_battle_log_" + std::to_string(getpid()) + ".blog";
+    NameTable names;
+    std::vector<EntityHandle> handles;
+    for (std::uint32_t i = 0; i < 6; ++i) {
+        handles.push_back(EntityHandle{i, 1});
+        names.set(handles.back(), "NPC_" + std::to_string(i));
+    }
+    EntityHandle late{6, 2};
+    names.set(late, "Late");
+    auto typeOf = [&](EntityHandle handle) { return static_cast<NPCType>(handle.index % 3); };
+    
+    // 400 боев по 4 на тик; Late сражается только в последних тиках
+    std::vector<BattleEvent> written;
+    for (std::uint32_t k = 0; k < 400; ++k) {
+        BattleEvent event;
+        event.attacker = handles[k % 6];
+        event.defender = k >= 380 ? late : handles[(k + 1) % 6];
+        event.attackerType = typeOf(event.attacker);
+        event.defenderType = typeOf(event.defender);
+        event.result = k % 2 ? BattleResult::Defended : BattleResult::AttackerKills;
+        event.attackRoll = static_cast<std::uint8_t>(1 + k % 6);
+        event.defenseRoll = static_cast<std::uint8_t>(1 + k % 5);
+        event.tick = k / 4;
+        event.x = static_cast<float>(k % 100);
+        event.y = 7.5f;
+        written.push_back(event);
+    }
+    auto same = [](const BattleEvent& a, const BattleEvent& b) {
+        return a.attacker == b.attacker && a.defender == b.defender && a.attackerType == b.attackerType &&
+               a.defenderType == b.defenderType && a.result == b.result && a.attackRoll == b.attackRoll &&
+               a.defenseRoll == b.defenseRoll && a.tick == b.tick && a.x == b.x && a.y == b.y;
+    };
+    
+    {
+        BattleLogWriter writer(path, 16);
+        for (const auto& event : written) writer.onBattleEvent(event, names);
+        writer.close();
+        EXPECT_EQ(writer.stats().events, 400u);
+        EXPECT_EQ(writer.stats().blocks, 25u);
+    }
+    
+    BattleLogReader reader(path);
+    EXPECT_TRUE(reader.isComplete());
+    EXPECT_EQ(reader.blockCount(), 25u);
+    EXPECT_EQ(reader.eventCount(), 400u);
+    EXPECT_EQ(reader.getNames().nameOf(handles[4]), "NPC_4");
+    
+    BattleLogScan everything = reader.query(BattleLogQuery{});
+    ASSERT_EQ(everything.events.size(), written.size());
+    for (size_t i = 0; i < written.size(); ++i) {
+        EXPECT_TRUE(same(everything.events[i], written[i])) << "event " << i;
+    }
+    
+    // Убийства рыцарей в тиках 20..39: читаются только блоки этих тиков
+    BattleLogQuery knights;
+    knights.fromTick = 20;
+    knights.toTick = 39;
+    knights.killerTypes = typeBit(NPCType::Knight);
+    BattleLogScan scan = reader.query(knights);
+    std::vector<BattleEvent> expected;
+    for (const auto& event : written) {
+        if (event.tick >= 20 && event.tick <= 39 && (battle_log::killerTypes(event) & typeBit(NPCType::Knight))) {
+            expected.push_back(event);
+        }
+    }
+    ASSERT_FALSE(expected.empty());
+    ASSERT_EQ(scan.events.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_TRUE(same(scan.events[i], expected[i])) << "event " << i;
+    }
+    EXPECT_EQ(scan.blocksTotal, 25u);
+    EXPECT_EQ(scan.blocksScanned, 5u);
+    
+    // История NPC по имени: Bloom-фильтр отбрасывает блоки без него
+    BattleLogQuery history;
+    history.entities = reader.findByName("Late");
+    ASSERT_EQ(history.entities.size(), 1u);
+    EXPECT_EQ(history.entities[0], late);
+    BattleLogScan lateScan = reader.query(history);
+    EXPECT_EQ(lateScan.events.size(), 20u);
+    EXPECT_LT(lateScan.blocksScanned, 5u);
+    EXPECT_TRUE(reader.findByName("Nobody").empty());
+    
+    std::remove(path.c_str());
+}
+
+TEST(BattleLogTest, UnclosedLogIsReadableFromBlocks) {
+    const std::string path = "test_battle_log_open_" + std::to_string(getpid()) + ".blog";
+    NameTable names;
+    EntityHandle orc{0, 1};
+    EntityHandle bear{1, 1};
+    names.set(orc, "Grom");
+    
+    BattleLogWriter writer(path, 16);
+    for (std::uint32_t k = 0; k < 40; ++k) {
+        BattleEvent event;
+        event.attacker = orc;
+        event.defender = bear;
+        event.attackerType = NPCType::Orc;
+        event.defenderType = NPCType::Bear;
+        event.tick = k;
+        writer.onBattleEvent(event, names);
+    }
+    
+    // Процесс не дошел до close(): на диске только полные блоки
+    {
+        BattleLogReader reader(path);
+        EXPECT_FALSE(reader.isComplete());
+        EXPECT_EQ(reader.blockCount(), 2u);
+        EXPECT_EQ(reader.eventCount(), 32u);
+        BattleLogQuery query;
+        query.fromTick = 30;
+        BattleLogScan scan = reader.query(query);
+        ASSERT_EQ(scan.events.size(), 2u);
+        EXPECT_EQ(scan.events[1].tick, 31u);
+        EXPECT_EQ(scan.blocksScanned, 1u);
+        EXPECT_EQ(reader.getNames().size(), 0u);
+    }
+    
+    writer.close();
+    BattleLogReader reader(path);
+    EXPECT_TRUE(reader.isComplete());
+    EXPECT_EQ(reader.eventCount(), 40u);
+    EXPECT_EQ(reader.getNames().nameOf(orc), "Grom");
+    EXPECT_THROW(BattleLogReader("missing_" + path), std::runtime_error);
+    
+    // Испорченные хвост и байт итога: индекс строится по блокам, строка пропускается
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        std::uint64_t badOffset = 1;
+        file.seekp(-static_cast<std::streamoff>(sizeof(battle_log::Trailer)) + 8, std::ios::end);
+        file.write(reinterpret_cast<const char*>(&badOffset), sizeof(badOffset));
+        // Колонка итогов первого блока из 16 событий: 16 + 488 байт от начала файла
+        file.seekp(16 + 488);
+        file.put(static_cast<char>(200));
+    }
+    BattleLogReader damaged(path);
+    EXPECT_FALSE(damaged.isComplete());
+    EXPECT_EQ(damaged.eventCount(), 40u);
+    BattleLogScan scan = damaged.query(BattleLogQuery{});
+    ASSERT_EQ(scan.events.size(), 39u);
+    EXPECT_EQ(scan.events[0].tick, 1u);
+    
+    std::remove(path.c_str());
+}
+
+TEST(BattleLogTest, WriterStopsAfterWriteError) {
+    // /dev/full отвечает ENOSPC на любую запись
+    BattleLogWriter writer("/dev/full", 4);
+    BattleEvent event;
+    writer.onBattleEvent(event, NameTable{});
+    writer.close();
+    BattleLogStats stats = writer.stats();
+    EXPECT_TRUE(stats.failed);
+    EXPECT_EQ(stats.events, 0u);
+    EXPECT_EQ(stats.blocks, 0u);
+    EXPECT_EQ(stats.bytes, 0u);
+}
+
+// Тесты для пакетных ядер: все реализации должны совпадать со скалярной
+TEST(SimdKernelsTest, AllLevelsAgree) {
+    std::vector<float> xs, ys, dirX, dirY, distance;
+    for (int k = 0; k < 61; ++k) {
+        xs.push_back(static_cast<float>((k * 7) % 30));
+        ys.push_back(static_cast<float>((k * 11) % 30));
+        dirX.push_back(static_cast<float>(k % 3 - 1));
+        dirY.push_back(static_cast<float>((k / 3) % 3 - 1));
+        distance.push_back(k % 2 ? 30.0f : 5.0f);
+    }
+    
+    auto original = SimdKernels::activeLevel();
+    SimdKernels::Level levels[] = {SimdKernels::Level::Scalar, SimdKernels::Level::SSE2,
+                                   SimdKernels::Level::AVX2};
+    
+    SimdKernels::setLevel(SimdKernels::Level::Scalar);
+    auto expectedMask = SimdKernels::withinRadiusMask(15, 15, xs.data(), ys.data(), xs.size(), 10);
+    auto expectedX = xs, expectedY = ys;
+    SimdKernels::moveBatch(expectedX.data(), expectedY.data(), dirX.data(), dirY.data(),
+                           distance.data(), xs.size(), 30, 30);
+    EXPECT_NE(expectedMask, 0u);
+    
+    for (auto level : levels) {
+        SimdKernels::setLevel(level);
+        EXPECT_EQ(SimdKernels::withinRadiusMask(15, 15, xs.data(), ys.data(), xs.size(), 10),
+                  expectedMask);
+        
+        auto movedX = xs, movedY = ys;
+        SimdKernels::moveBatch(movedX.data(), movedY.data(), dirX.data(), dirY.data(),
+                               distance.data(), xs.size(), 30, 30);
+        EXPECT_EQ(movedX, expectedX);
+        EXPECT_EQ(movedY, expectedY);
+    }
+    SimdKernels::setLevel(original);
+}
+
+TEST(SimdKernelsTest, MoveAllMatchesNPCMove) {
+    NPCStore store;
+    Orc orc("Orc1", 95, 3);
+    Knight knight("Knight1", 50, 50);
+    store.add(orc);
+    store.add(knight);
+    
+    float dirX[] = {1, -1};
+    float dirY[] = {-1, 1};
+    store.moveAll(dirX, dirY, 100, 100);
+    orc.move(1, -1, 100, 100);
+    knight.move(-1, 1, 100, 100);
+    
+    EXPECT_EQ(store.view(0).getPosition(), orc.getPosition());
+    EXPECT_EQ(store.view(1).getPosition(), knight.getPosition());
+}
+
 // Тесты для GameManager
 TEST(GameManagerTest, Initialization) {
     // Просто проверяем, что можно создать GameManager
@@ -132,6 +1809,70 @@ TEST(GameManagerTest, Initialization) {
     });
 }
 
+TEST(GameManagerTest, HeadlessRunIsReproducible) {
+    GameConfig config;
+    config.headless = true;
+    config.tickCount = 200;
+    config.npcCount = 300;
+    config.seed = 7;
+    config.sharedSnapshot = false;
+    
+    config.workerCount = 1;
+    RunReport first = GameManager(config).run();
+    config.workerCount = 3;
+    RunReport second = GameManager(config).run();
+    
+    EXPECT_EQ(first.ticks, 200u);
+    EXPECT_DOUBLE_EQ(first.simulatedSeconds, 20.0);
+    EXPECT_GT(first.ticksPerSecond, 0.0);
+    EXPECT_GT(first.kills, 0u);
+    EXPECT_EQ(second.kills, first.kills);
+    EXPECT_EQ(second.alive, first.alive);
+    EXPECT_EQ(second.battles, first.battles);
+    EXPECT_GT(first.battles, 0u);
+    EXPECT_GE(first.tickP99Ms, first.tickP50Ms);
+}
+
+TEST(GameConfigTest, ParsesCommandLine) {
+    const char* args[] = {"laba7", "--headless", "--duration", "5", "--tick-rate", "60",
+                          "--seed", "42", "--no-shm"};
+    GameConfig config = GameConfig::fromArgs(9, args);
+    EXPECT_TRUE(config.headless);
+    EXPECT_FALSE(config.sharedSnapshot);
+    EXPECT_EQ(config.seed, 42u);
+    EXPECT_EQ(config.totalTicks(), 300u);
+    
+    const char* ticks[] = {"laba7", "--ticks", "1000", "--duration", "5"};
+    EXPECT_EQ(GameConfig::fromArgs(5, ticks).totalTicks(), 1000u);
+    
+    const char* bad[] = {"laba7", "--ticks", "ten"};
+    EXPECT_THROW(GameConfig::fromArgs(3, bad), std::invalid_argument);
+    const char* unknown[] = {"laba7", "--fast"};
+    EXPECT_THROW(GameConfig::fromArgs(2, unknown), std::invalid_argument);
+    
+    const char* scenario[] = {"laba7", "--scenario", "one-cell"};
+    EXPECT_EQ(GameConfig::fromArgs(3, scenario).scenario, ScenarioKind::OneCell);
+    const char* badScenario[] = {"laba7", "--scenario", "spiral"};
+    EXPECT_THROW(GameConfig::fromArgs(3, badScenario), std::invalid_argument);
+    
+    EXPECT_FALSE(config.verboseBattles);
+    const char* battles[] = {"laba7", "--battle-log", "verbose", "--battle-sample", "10", "--battle-rate", "50"};
+    GameConfig verbose = GameConfig::fromArgs(7, battles);
+    EXPECT_TRUE(verbose.verboseBattles);
+    EXPECT_EQ(verbose.battleSample, 10u);
+    EXPECT_EQ(verbose.battleRate, 50u);
+    const char* noSample[] = {"laba7", "--battle-sample", "0"};
+    EXPECT_THROW(GameConfig::fromArgs(3, noSample), std::invalid_argument);
+    const char* shm[] = {"laba7", "--shm-name", "/laba7_second"};
+    EXPECT_EQ(GameConfig::fromArgs(3, shm).shmName, "/laba7_second");
+    const char* badShm[] = {"laba7", "--shm-name", "laba7"};
+    EXPECT_THROW(GameConfig::fromArgs(3, badShm), std::invalid_argument);
+    const char* record[] = {"laba7", "--headless", "--battle-record", "battles.blog"};
+    EXPECT_EQ(GameConfig::fromArgs(4, record).battleRecordPath, "battles.blog");
+    const char* noRecord[] = {"laba7", "--battle-record"};
+    EXPECT_THROW(GameConfig::fromArgs(2, noRecord), std::invalid_argument);
+}
+
 // Тесты многопоточности
 TEST(ThreadTest, ThreadCreation) {
     // Простая проверка работы потоков
@@ -0,0 +1,130 @@
+#include "battle_log.h"
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+// Запросы к двоичному журналу битв (laba7 --battle-record FILE):
+//   battle_log_query FILE --killer Knight --from 100 --to 200
+//   battle_log_query FILE --npc NPC_42
+// Индекс журнала отбрасывает блоки вне диапазона тиков, без нужных итогов
+// и типов и без искомого NPC; читаются только оставшиеся
+namespace {
+
+struct QueryArgs {
+    std::string path;
+    BattleLogQuery query;
+    std::string npc;
+    bool countOnly = false;
+    size_t limit = 0;                   // 0 - все строки
+};
+
+const char* USAGE =
+    "Usage: battle_log_query FILE [options]\n"
+    "  --from TICK         first tick (inclusive)\n"
+    "  --to TICK           last tick (inclusive)\n"
+    "  --killer TYPE       kills made by Orc, Knight or Bear\n"
+    "  --result KIND       kills, defended or all (default)\n"
+    "  --npc NAME          battles of the named NPC\n"
+    "  --limit N           print at most N battles\n"
+    "  --count             print only the totals\n";
+
+std::uint32_t parseTick(const std::string& value) {
+    size_t used = 0;
+    unsigned long long tick = std::stoull(value, &used);
+    if (used != value.size() || tick > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::invalid_argument("invalid tick '" + value + "'");
+    }
+    return static_cast<std::uint32_t>(tick);
+}
+
+QueryArgs parseArgs(int argc, char** argv) {
+    QueryArgs args;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--count") {
+            args.countOnly = true;
+            continue;
+        }
+        if (arg.rfind("--", 0) != 0) {
+            if (!args.path.empty()) throw std::invalid_argument("unexpected argument " + arg);
+            args.path = arg;
+            continue;
+        }
+        static const char* VALUED[] = {"--from", "--to", "--killer", "--result", "--npc", "--limit"};
+        if (std::find(std::begin(VALUED), std::end(VALUED), arg) == std::end(VALUED)) {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+        if (i + 1 >= argc) throw std::invalid_argument("missing value for " + arg);
+        std::string value = argv[++i];
+        if (arg == "--from") {
+            args.query.fromTick = parseTick(value);
+        } else if (arg == "--to") {
+            args.query.toTick = parseTick(value);
+        } else if (arg == "--killer") {
+            NPCType type;
+            if (!parseNPCType(value, type)) throw std::invalid_argument("unknown NPC type '" + value + "'");
+            args.query.killerTypes = typeBit(type);
+        } else if (arg == "--result") {
+            if (value == "kills") {
+                args.query.results = ALL_BATTLE_RESULTS & ~resultBit(BattleResult::Defended);
+            } else if (value == "defended") {
+                args.query.results = resultBit(BattleResult::Defended);
+            } else if (value != "all") {
+                throw std::invalid_argument("unknown result kind '" + value + "'");
+            }
+        } else if (arg == "--npc") {
+            args.npc = value;
+        } else {
+            args.limit = static_cast<size_t>(std::stoull(value));
+        }
+    }
+    if (args.path.empty()) throw std::invalid_argument("missing battle log file");
+    return args;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    QueryArgs args;
+    try {
+        args = parseArgs(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n" << USAGE;
+        return 2;
+    }
+
+    try {
+        BattleLogReader reader(args.path);
+        if (!reader.isComplete()) {
+            std::cerr << "Warning: " << args.path << " has no valid index (not closed?); rebuilt from blocks, no names"
+                      << std::endl;
+        }
+        if (!args.npc.empty()) {
+            args.query.entities = reader.findByName(args.npc);
+            if (args.query.entities.empty()) {
+                std::cerr << "Error: no NPC named " << args.npc << " in " << args.path << std::endl;
+                return 1;
+            }
+        }
+
+        BattleLogScan scan = reader.query(args.query);
+        if (!args.countOnly) {
+            std::string line;
+            size_t shown = args.limit ? std::min(args.limit, scan.events.size()) : scan.events.size();
+            for (size_t i = 0; i < shown; ++i) {
+                line = "tick " + std::to_string(scan.events[i].tick) + ": ";
+                appendBattleEvent(line, scan.events[i], reader.getNames());
+                std::cout << line << "\n";
+            }
+        }
+        std::cout << scan.events.size() << " battles; scanned " << scan.blocksScanned << " of "
+                  << scan.blocksTotal << " blocks (" << reader.eventCount() << " battles in log)" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,252 @@
+#include "game_manager.h"
+#include "scenario.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <csignal>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Замер целой симуляции: для каждого сценария, числа NPC и числа потоков
+// GameManager идет headless заданное число тиков. Каждый запуск - в
+// отдельном процессе, чтобы пиковый RSS относился только к нему.
+// Результат - CSV в stdout или в файл --out.
+// В one-cell все NPC в одной клетке: поиск пар проверяет каждую пару, и
+// время тика растет как n^2 (20k NPC - около секунды на тик). Поэтому
+// one-cell больше --one-cell-max NPC не запускается, а любой запуск
+// ограничен --max-seconds и, если задано, --max-memory-mb. Такие запуски
+// дают строку CSV со status skipped, timeout или out_of_memory
+namespace {
+
+struct HarnessConfig {
+    std::vector<ScenarioKind> scenarios = ScenarioGenerator::all();
+    std::vector<long> sizes = {1000, 10000, 100000, 1000000};
+    std::vector<long> threads = {1, 2, 4};
+    std::uint64_t ticks = 100;
+    double density = 0.005;             // NPC на единицу площади
+    std::uint64_t seed = 42;
+    std::string out;
+    long oneCellMax = 10000;            // больше NPC в one-cell - строка skipped
+    long maxSeconds = 600;              // на запуск; 0 - без ограничения
+    long maxMemoryMb = 0;               // адресное пространство запуска; 0 - без ограничения
+};
+
+// Код выхода дочернего процесса, когда не хватило памяти
+constexpr int EXIT_OUT_OF_MEMORY = 3;
+
+const char* CSV_HEADER =
+    "scenario,npcs,threads,map_size,ticks,wall_s,ticks_per_sec,tick_p50_ms,tick_p99_ms,"
+    "battles,battles_per_sec,kills,alive,peak_rss_kb,status";
+
+// Строка запуска без замеров
+std::string statusRow(ScenarioKind scenario, long npcs, long threads, int mapSize, const std::string& status) {
+    return ScenarioGenerator::name(scenario) + ',' + std::to_string(npcs) + ',' + std::to_string(threads) + ',' +
+           std::to_string(mapSize) + ",,,,,,,,,," + status;
+}
+
+std::vector<std::string> splitList(const std::string& value) {
+    std::vector<std::string> items;
+    std::stringstream stream(value);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    if (items.empty()) throw std::invalid_argument("empty list");
+    return items;
+}
+
+std::vector<long> parseNumbers(const std::string& value) {
+    std::vector<long> numbers;
+    for (const auto& item : splitList(value)) {
+        long number = std::stol(item);
+        if (number <= 0) throw std::invalid_argument("expected positive numbers, got '" + item + "'");
+        numbers.push_back(number);
+    }
+    return numbers;
+}
+
+HarnessConfig parseArgs(int argc, char** argv) {
+    HarnessConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) throw std::invalid_argument("missing value for " + arg);
+        std::string value = argv[++i];
+        if (arg == "--scenarios") {
+            config.scenarios.clear();
+            for (const auto& name : splitList(value)) {
+                auto kind = ScenarioGenerator::parse(name);
+                if (!kind) throw std::invalid_argument("unknown scenario '" + name + "'");
+                config.scenarios.push_back(*kind);
+            }
+        } else if (arg == "--sizes") {
+            config.sizes = parseNumbers(value);
+        } else if (arg == "--threads") {
+            config.threads = parseNumbers(value);
+        } else if (arg == "--ticks") {
+            config.ticks = std::stoull(value);
+        } else if (arg == "--density") {
+            config.density = std::stod(value);
+            if (config.density <= 0.0) throw std::invalid_argument("--density must be positive");
+        } else if (arg == "--seed") {
+            config.seed = std::stoull(value);
+        } else if (arg == "--out") {
+            config.out = value;
+        } else if (arg == "--one-cell-max") {
+            config.oneCellMax = std::stol(value);
+        } else if (arg == "--max-seconds") {
+            config.maxSeconds = std::stol(value);
+        } else if (arg == "--max-memory-mb") {
+            config.maxMemoryMb = std::stol(value);
+        } else {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+    if (config.oneCellMax < 0 || config.maxSeconds < 0 || config.maxMemoryMb < 0) {
+        throw std::invalid_argument("limits must not be negative");
+    }
+    return config;
+}
+
+// Один запуск в дочернем процессе; строка CSV возвращается через pipe.
+// Превысивший время запуск снимается по SIGALRM, памяти - по bad_alloc
+std::string runOne(ScenarioKind scenario, long npcs, long threads, int mapSize,
+                   const HarnessConfig& harness) {
+    int fds[2];
+    if (pipe(fds) != 0) throw std::runtime_error("pipe failed");
+
+    pid_t pid = fork();
+    if (pid < 0) throw std::runtime_error("fork failed");
+    if (pid == 0) {
+        close(fds[0]);
+        if (harness.maxMemoryMb > 0) {
+            rlimit limit{};
+            limit.rlim_cur = limit.rlim_max = static_cast<rlim_t>(harness.maxMemoryMb) * 1024 * 1024;
+            setrlimit(RLIMIT_AS, &limit);
+        }
+        if (harness.maxSeconds > 0) alarm(static_cast<unsigned>(harness.maxSeconds));
+        std::ostringstream line;
+        try {
+            GameConfig config;
+            config.mapWidth = mapSize;
+            config.mapHeight = mapSize;
+            config.npcCount = static_cast<int>(npcs);
+            config.scenario = scenario;
+            config.tickCount = harness.ticks;
+            config.headless = true;
+            config.workerCount = static_cast<size_t>(threads);
+            config.seed = harness.seed;
+            config.sharedSnapshot = false;
+
+            std::ostringstream silent;
+            std::streambuf* saved = std::cout.rdbuf(silent.rdbuf());
+            RunReport report;
+            {
+                GameManager game(config);
+                report = game.run();
+            }
+            std::cout.rdbuf(saved);
+
+            rusage usage{};
+            getrusage(RUSAGE_SELF, &usage);
+            double battlesPerSecond = report.wallSeconds > 0 ? report.battles / report.wallSeconds : 0.0;
+            line << ScenarioGenerator::name(scenario) << ',' << npcs << ',' << threads << ','
+                 << mapSize << ',' << report.ticks << ',' << std::fixed << std::setprecision(4)
+                 << report.wallSeconds << ',' << std::setprecision(2) << report.ticksPerSecond << ','
+                 << std::setprecision(4) << report.tickP50Ms << ',' << report.tickP99Ms << ','
+                 << report.battles << ',' << std::setprecision(1) << battlesPerSecond << ','
+                 << report.kills << ',' << report.alive << ',' << usage.ru_maxrss << ",ok";
+        } catch (const std::bad_alloc&) {
+            _exit(EXIT_OUT_OF_MEMORY);
+        } catch (const std::exception& e) {
+            std::cerr << "Run failed: " << e.what() << std::endl;
+            _exit(1);
+        }
+        std::string text = line.str();
+        ssize_t written = write(fds[1], text.data(), text.size());
+        close(fds[1]);
+        _exit(written == static_cast<ssize_t>(text.size()) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    std::string text;
+    char buffer[512];
+    ssize_t n;
+    while ((n = read(fds[0], buffer, sizeof(buffer))) > 0) {
+        text.append(buffer, static_cast<size_t>(n));
+    }
+    close(fds[0]);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM) {
+        return statusRow(scenario, npcs, threads, mapSize, "timeout");
+    }
+    // Нехватка памяти в рабочем потоке завершает процесс через abort
+    if ((WIFEXITED(status) && WEXITSTATUS(status) == EXIT_OUT_OF_MEMORY) ||
+        (harness.maxMemoryMb > 0 && WIFSIGNALED(status) &&
+         (WTERMSIG(status) == SIGABRT || WTERMSIG(status) == SIGKILL))) {
+        return statusRow(scenario, npcs, threads, mapSize, "out_of_memory");
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || text.empty()) {
+        throw std::runtime_error("run " + ScenarioGenerator::name(scenario) + " " +
+                                 std::to_string(npcs) + " failed");
+    }
+    return text;
+}
+
+}  // namespace
+
+// Использование: scaling_harness [--scenarios uniform,clusters,...]
+//   [--sizes 1000,10000,...] [--threads 1,2,4] [--ticks N] [--density D]
+//   [--seed S] [--out results.csv] [--one-cell-max N] [--max-seconds S]
+//   [--max-memory-mb M]
+int main(int argc, char** argv) {
+    HarnessConfig harness;
+    try {
+        harness = parseArgs(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if (!harness.out.empty()) {
+        file.open(harness.out);
+        if (!file) {
+            std::cerr << "Error: cannot open " << harness.out << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& csv = harness.out.empty() ? std::cout : file;
+    csv << CSV_HEADER << std::endl;
+
+    int failures = 0;
+    for (ScenarioKind scenario : harness.scenarios) {
+        for (long npcs : harness.sizes) {
+            // Сторона карты держит плотность постоянной
+            int mapSize = std::max(1, static_cast<int>(std::lround(std::sqrt(npcs / harness.density))));
+            for (long threads : harness.threads) {
+                if (scenario == ScenarioKind::OneCell && npcs > harness.oneCellMax) {
+                    csv << statusRow(scenario, npcs, threads, mapSize, "skipped") << std::endl;
+                    continue;
+                }
+                try {
+                    csv << runOne(scenario, npcs, threads, mapSize, harness) << std::endl;
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: " << e.what() << std::endl;
+                    ++failures;
+                }
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#include "shared_snapshot.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+// Просмотрщик снимка мира: раз в секунду печатает частоту кадров,
+// задержку кадра относительно публикации и счетчики живых NPC.
+// Использование: world_viewer [имя сегмента] [секунды, 0 - бесконечно]
+int main(int argc, char** argv) {
+    std::string name = argc > 1 ? argv[1] : shared_snapshot::DEFAULT_NAME;
+    int seconds = argc > 2 ? std::atoi(argv[2]) : 0;
+
+    try {
+        SharedSnapshotReader reader(name);
+        std::cout << "Reading " << name << " (capacity " << reader.getCapacity() << ")" << std::endl;
+
+        using Clock = std::chrono::steady_clock;
+        constexpr auto POLL_INTERVAL = std::chrono::milliseconds(5);
+        SnapshotFrame frame;
+        std::uint64_t lastSequence = reader.sequence();
+        std::uint64_t lastTick = 0;
+        auto start = Clock::now();
+        auto windowStart = start;
+        size_t frames = 0, retries = 0;
+        double stalenessSum = 0.0, stalenessMax = 0.0;
+
+        while (seconds <= 0 || Clock::now() - start < std::chrono::seconds(seconds)) {
+            std::uint64_t sequence = reader.sequence();
+            if (sequence != lastSequence && !(sequence & 1)) {
+                lastSequence = sequence;
+                retries += reader.read(frame);
+                if (frame.tick != lastTick) {
+                    lastTick = frame.tick;
+                    ++frames;
+                    auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        Clock::now().time_since_epoch()).count();
+                    double staleness = (now - static_cast<std::int64_t>(frame.publishNanos)) * 1e-6;
+                    stalenessSum += staleness;
+                    stalenessMax = std::max(stalenessMax, staleness);
+                }
+            }
+
+            auto now = Clock::now();
+            double window = std::chrono::duration<double>(now - windowStart).count();
+            if (window >= 1.0) {
+                std::cout << std::fixed << std::setprecision(2)
+                          << "tick " << frame.tick
+                          << "  fps " << frames / window
+                          << "  staleness avg " << (frames ? stalenessSum / frames : 0.0)
+                          << " ms, max " << stalenessMax << " ms"
+                          << "  alive " << frame.aliveCount << "/" << frame.totalCount;
+                for (size_t t = 0; t < NPC_TYPE_COUNT; ++t) {
+                    std::cout << (t ? ", " : "  (") << NPC_TRAITS[t].name << " " << frame.typeCounts[t];
+                }
+                std::cout << ")  retries " << retries << std::endl;
+
+                windowStart = now;
+                frames = retries = 0;
+                stalenessSum = stalenessMax = 0.0;
+            }
+            std::this_thread::sleep_for(POLL_INTERVAL);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}